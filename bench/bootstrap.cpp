@@ -0,0 +1,66 @@
+// Time taken by the bootstrap intervals of the summary over a large number of
+// results, on one thread and on one per core.
+//
+// make bench CXXFLAGS=-O2 && ./build/bench/bootstrap [result count]
+
+#include "bootstrap.hpp"
+#include "result_store.hpp"
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+template <class F> double time_ms(F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void report(std::string_view name, double ms, const bootstrap_summary &b) {
+  std::cout << std::setw(12) << std::left << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1) << ms
+            << " ms  score " << std::setprecision(4) << b.p1_score.estimate
+            << " [" << b.p1_score.low << ", " << b.p1_score.high
+            << "], point difference " << b.point_difference.estimate << " ["
+            << b.point_difference.low << ", " << b.point_difference.high
+            << "]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  const size_t count = argc > 1 ? std::stoul(argv[1]) : 100'000;
+
+  // Bimodal point differences: p1 wins narrowly or loses heavily. Each seed is
+  // played twice, as side-swapped games would be.
+  std::mt19937 rng{42};
+  std::bernoulli_distribution p1_wins{0.55};
+  std::uniform_int_distribution<int> narrow{1, 10};
+  std::uniform_int_distribution<int> heavy{20, 60};
+  result_store store;
+  store.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const int loser = 10;
+    const bool win = p1_wins(rng);
+    run_result r{.output_file = "",
+                 .p1_score = win ? loser + narrow(rng) : loser,
+                 .p2_score = win ? loser : loser + heavy(rng),
+                 .seed = std::to_string(i / 2 + 1000000)};
+    store.push_back((uint32_t)i, r);
+  }
+
+  bootstrap_summary b;
+  {
+    thread_pool pool{1};
+    report("1 thread", time_ms([&] { b = bootstrap(store, pool); }), b);
+  }
+  thread_pool pool;
+  std::string name = std::to_string(pool.size()) + " threads";
+  report(name, time_ms([&] { b = bootstrap(store, pool); }), b);
+}
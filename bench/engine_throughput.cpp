@@ -0,0 +1,64 @@
+// Games per second of `engine` and `parallel_engine` with a referee that
+// answers immediately, i.e. the overhead of launching games and collecting
+// their results. The parallel engine should scale with the I/O threads as long
+// as there are cores left for the referees.
+//
+// make bench CXXFLAGS=-O2 && ./build/bench/engine_throughput [games] [slots]
+
+#include "engine.hpp"
+#include "parallel_engine.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+dpsg::posix::process_t instant_referee(const game_t &, game_id) {
+  static const char *const args[] = {"echo", "1", "0", "seed=1", nullptr};
+  return dpsg::posix::run_external("echo", args);
+}
+
+template <class Engine> double measure(Engine &games, int game_count) {
+  size_t completed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < game_count; ++i) {
+    games.submit(game_t{.player1 = "", .player2 = "", .referee = ""},
+                 [&](game_id, const game_t &, run_result &) { completed++; });
+  }
+  games.run();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (completed != (size_t)game_count ||
+      games.statistics().player1_victory != (size_t)game_count) {
+    std::cerr << "Lost games: " << completed << '/' << game_count << std::endl;
+    exit(1);
+  }
+  return game_count / elapsed.count();
+}
+
+void report(std::string_view name, double games_per_second) {
+  std::cout << std::setw(24) << std::left << name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(0)
+            << games_per_second << " games/s" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  int game_count = argc > 1 ? std::stoi(argv[1]) : 5000;
+  int slots = argc > 2 ? std::stoi(argv[2]) : 64;
+
+  std::cout << game_count << " games, " << slots << " slots, "
+            << std::thread::hardware_concurrency() << " cores" << std::endl;
+  {
+    engine games{slots, instant_referee};
+    report("engine", measure(games, game_count));
+  }
+  for (unsigned threads : {1u, 2u, 4u, 8u}) {
+    parallel_engine games{slots, threads, instant_referee};
+    report("parallel_engine x" + std::to_string(threads),
+           measure(games, game_count));
+  }
+}
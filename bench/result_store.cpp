@@ -0,0 +1,139 @@
+// Compares the summary of a large number of results stored in a
+// `result_store` to the same computation over a `std::vector<run_result>`, as
+// `presenter::print_summary` used to do it.
+//
+// make bench CXXFLAGS=-O2 && ./build/bench/result_store [result count]
+
+#include "result_store.hpp"
+#include "statistics.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct legacy_summary {
+  std::vector<std::string> errors[2];
+  double point_difference_avg[2] = {0, 0};
+  double deviation[2] = {0, 0};
+  size_t draws = 0;
+};
+
+legacy_summary summarize(const std::vector<run_result> &results) {
+  legacy_summary r;
+  std::vector<int> scores[2]{};
+
+  for (auto &result : results) {
+    if (result.has_error(run_result::error::p1_error)) {
+      r.errors[0].push_back(result.seed);
+    }
+    if (result.has_error(run_result::error::p2_error)) {
+      r.errors[1].push_back(result.seed);
+    }
+
+    if (!result.has_error()) {
+      if (result.winner() == run_result::winner::p1) {
+        auto score = result.p1_score - result.p2_score;
+        r.point_difference_avg[0] = statistics_t::moving_average(
+            r.point_difference_avg[0], score, scores[0].size());
+        scores[0].push_back(score);
+      } else if (result.winner() == run_result::winner::p2) {
+        auto score = result.p2_score - result.p1_score;
+        r.point_difference_avg[1] = statistics_t::moving_average(
+            r.point_difference_avg[1], score, scores[1].size());
+        scores[1].push_back(score);
+      } else {
+        r.draws++;
+      }
+    }
+  }
+
+  for (int x = 0; x < 2; ++x) {
+    r.deviation[x] = statistics_t::standard_deviation(std::span{scores[x]},
+                                                      r.point_difference_avg[x]);
+  }
+  return r;
+}
+
+template <class F> double time_ms(F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  const size_t count = argc > 1 ? std::stoul(argv[1]) : 500'000;
+  constexpr int repetitions = 10;
+
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<int> score{0, 100};
+  std::uniform_int_distribution<int> error{0, 99};
+  // Seeds repeat, as they do when the same seed set is replayed
+  std::uniform_int_distribution<int> seed{0, (int)(count / 4)};
+
+  std::vector<run_result> generated;
+  generated.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    run_result r{.output_file = "output-1700000000000-" + std::to_string(i) +
+                                ".json",
+                 .p1_score = score(rng),
+                 .p2_score = score(rng),
+                 .seed = std::to_string(seed(rng) * 7919ull + 1000000)};
+    if (error(rng) == 0) {
+      r.p1_score = -1;
+    }
+    generated.push_back(std::move(r));
+  }
+
+  std::vector<run_result> results;
+  result_store store{"output-1700000000000-"};
+  const auto vector_fill = time_ms([&] {
+    results.reserve(count);
+    for (auto &r : generated) {
+      results.push_back(r);
+    }
+  });
+  const auto store_fill = time_ms([&] {
+    store.reserve(count);
+    for (size_t i = 0; i < generated.size(); ++i) {
+      store.push_back((uint32_t)i, generated[i]);
+    }
+  });
+
+  double checksum = 0;
+  const auto vector_summary = time_ms([&] {
+    for (int i = 0; i < repetitions; ++i) {
+      auto s = summarize(results);
+      checksum += s.point_difference_avg[0] + (double)s.errors[0].size();
+    }
+  }) / repetitions;
+  const auto store_summary = time_ms([&] {
+    for (int i = 0; i < repetitions; ++i) {
+      auto s = store.summarize();
+      checksum += s.point_difference_avg[0] + (double)s.errors[0];
+    }
+  }) / repetitions;
+
+  const auto legacy = summarize(results);
+  const auto columnar = store.summarize();
+
+  std::cout << count << " results, " << store.seed_count()
+            << " distinct seeds\n"
+            << "                     fill (ms)   summary (ms)\n"
+            << "vector<run_result>  " << std::setw(10) << vector_fill << "  "
+            << std::setw(13) << vector_summary << '\n'
+            << "result_store        " << std::setw(10) << store_fill << "  "
+            << std::setw(13) << store_summary << '\n'
+            << "p1 point difference: " << legacy.point_difference_avg[0]
+            << " / " << columnar.point_difference_avg[0]
+            << ", deviation: " << legacy.deviation[0] << " / "
+            << columnar.point_difference_deviation[0] << '\n'
+            << "(checksum " << checksum << ")" << std::endl;
+}
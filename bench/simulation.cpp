@@ -0,0 +1,93 @@
+// Games per second replayed by `runner simulate`, i.e. simulated_engine driven
+// by the driver of the runner, and a check that the driver keeps the deadline
+// of --budget ... --at-deadline kill, with and without early stopping.
+//
+// make bench CXXFLAGS=-O2 && ./build/bench/simulation [games] [slots]
+
+#include "run_driver.hpp"
+#include "simulation.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+std::chrono::nanoseconds now_of(const simulated_engine &games) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double, std::milli>(games.now_ms()));
+}
+
+// Virtual time taken by a run of `trace` on `slots` slots
+double simulate_ms(const std::vector<trace_game> &trace, int slots,
+                   run_driver<simulated_engine>::settings s,
+                   bool early_stop) {
+  simulated_engine games{slots, trace};
+  run_driver driver{
+      games, s, [&games] { return now_of(games); },
+      [&](int n) {
+        game_t g;
+        g.seed = trace[(size_t)n % trace.size()].seed;
+        games.submit(std::move(g), nullptr);
+      },
+      [](int) -> std::optional<double> { return std::nullopt; }};
+  std::function<bool()> stop;
+  if (early_stop) {
+    stop = [] { return false; };
+  }
+  driver.run(stop);
+  return games.now_ms();
+}
+
+// Games of a first wave that don't fit in the budget have to be killed at the
+// deadline, whatever `stop` is
+void check_deadline() {
+  const std::vector<trace_game> trace{
+      {.seed = "x", .p1_score = 1, .p2_score = 1, .ms = 17000},
+      {.seed = "x", .p1_score = 1, .p2_score = 1, .ms = 1000},
+      {.seed = "y", .p1_score = 1, .p2_score = 1, .ms = 8000},
+      {.seed = "z", .p1_score = 1, .p2_score = 1, .ms = 8000},
+  };
+  for (bool early_stop : {false, true}) {
+    const double ms = simulate_ms(
+        trace, 1,
+        {.games = statistics_t::unbounded, .budget = 10s,
+         .kill_at_deadline = true},
+        early_stop);
+    if (ms != 10000) {
+      std::cerr << "Deadline of 10s missed "
+                << (early_stop ? "with" : "without")
+                << " early stopping: " << ms << "ms" << std::endl;
+      exit(1);
+    }
+  }
+}
+
+} // namespace
+
+int main(int argc, const char **argv) {
+  int game_count = argc > 1 ? std::stoi(argv[1]) : 1000000;
+  int slots = argc > 2 ? std::stoi(argv[2]) : 64;
+
+  check_deadline();
+
+  std::mt19937 random{42};
+  std::lognormal_distribution<double> duration{8, 0.5};
+  std::vector<trace_game> trace(10000);
+  for (size_t i = 0; i < trace.size(); ++i) {
+    trace[i] = {.seed = std::to_string(i), .p1_score = 1, .p2_score = 0,
+                .ms = duration(random)};
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  simulate_ms(trace, slots, {.games = game_count}, false);
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << game_count << " games, " << slots << " slots: " << std::fixed
+            << std::setprecision(0) << game_count / elapsed.count()
+            << " games/s" << std::endl;
+}
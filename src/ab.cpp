@@ -0,0 +1,202 @@
+#include "ab.hpp"
+#include "pairs.hpp"
+#include "statistics.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+namespace {
+// Seeds between two progress lines
+constexpr int report_interval = 10;
+} // namespace
+
+double paired_difference::moments::variance(int n) const {
+  if (n < 2) {
+    return 0;
+  }
+  return std::max(0.0, (sum_squares - sum * sum / n) / (n - 1));
+}
+
+void paired_difference::add(double a, double b) {
+  _n++;
+  _better += a > b;
+  _worse += a < b;
+  _a.add(a);
+  _b.add(b);
+  _difference.add(a - b);
+}
+
+double paired_difference::mean() const {
+  return _n == 0 ? 0 : _difference.sum / _n;
+}
+
+double paired_difference::standard_error() const {
+  if (_n < 2) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return std::sqrt(_difference.variance(_n) / _n);
+}
+
+std::pair<double, double> paired_difference::interval(double z) const {
+  const double half = z * standard_error();
+  return {std::max(-1.0, mean() - half), std::min(1.0, mean() + half)};
+}
+
+double paired_difference::unpaired_standard_error() const {
+  if (_n < 2) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return std::sqrt((_a.variance(_n) + _b.variance(_n)) / _n);
+}
+
+double paired_difference::sign_test() const {
+  const int m = _better + _worse;
+  const int k = std::min(_better, _worse);
+  // Binomial tail in logarithms, for thousands of seeds
+  double tail = 0;
+  for (int i = 0; i <= k; ++i) {
+    tail += std::exp(std::lgamma(m + 1.0) - std::lgamma(i + 1.0) -
+                     std::lgamma(m - i + 1.0) - m * std::log(2.0));
+  }
+  return std::min(1.0, 2 * tail);
+}
+
+namespace {
+std::string percent(double x, bool sign) {
+  std::ostringstream s;
+  s << std::fixed << std::setprecision(1)
+    << (sign ? std::showpos : std::noshowpos) << 100 * x << '%';
+  return s.str();
+}
+
+void print_difference(const paired_difference &d) {
+  const auto [low, high] = d.interval();
+  std::cout << "A - B " << dpsg::vt100::yellow << percent(d.mean(), true)
+            << dpsg::vt100::reset << " [" << percent(low, true) << ", "
+            << percent(high, true) << "], sign test p = "
+            << std::setprecision(3) << d.sign_test() << std::setprecision(6);
+}
+
+void print_bot(char name, std::string_view command, const statistics_t &s) {
+  const auto [low, high] = s.p1_score_interval();
+  std::cout << dpsg::vt100::cyan << name << dpsg::vt100::reset << ' '
+            << percent(s.p1_score_share(), false) << " [" << percent(low, false)
+            << ", " << percent(high, false) << "]  " << s.player1_victory
+            << " wins, " << s.draws << " draws, " << s.player2_victory
+            << " losses";
+  if (s.player1_errors > 0) {
+    std::cout << ", " << dpsg::vt100::red << s.player1_errors << " errors"
+              << dpsg::vt100::reset;
+  }
+  std::cout << "  " << command << '\n';
+}
+} // namespace
+
+int run_ab(int argc, const char **argv) {
+  using namespace dpsg;
+  auto opts = parse_options(argc, argv);
+  const auto &bots = opts.arguments;
+  if (bots.size() != 2 || opts.p2.empty() || opts.referee.empty()) {
+    std::cerr << "Usage: runner ab -2 <opponent> -r <referee> "
+                 "[-c <max games>] [options] <A> <B>\n"
+                 "  -c defaults to every seed played once, 4 games per seed"
+              << std::endl;
+    return 1;
+  }
+
+  const std::string opponent{opts.p2};
+  const auto read = read_pair_seeds(opts, 4, 4);
+  if (!read) {
+    return 1;
+  }
+  const auto &seeds = *read;
+
+  paired_difference difference;
+  // Results of each bot against the opponent, the bot as player 1
+  statistics_t stats[2];
+
+  size_t played = 0;
+  size_t started = 0;
+
+  const auto on_seed = [&](double a, double b) {
+    difference.add(a, b);
+    if (difference.seeds() % report_interval != 0) {
+      return;
+    }
+    std::cout << vt100::cyan << "Seed " << std::setw(4) << difference.seeds()
+              << vt100::reset << " (" << played << " games) ";
+    print_difference(difference);
+    std::cout << std::endl;
+  };
+
+  with_pair_engine(opts, [&](auto &games) {
+    // Both bots play both seats of the seed, interleaved so that they share
+    // the conditions of the machine
+    const auto start_seed = [&] {
+      const auto &seed = seeds[started++ % seeds.size()];
+      auto scores = std::make_shared<std::pair<double, double>>(0, 0);
+      auto remaining = std::make_shared<int>(2);
+      for (int bot = 0; bot < 2; ++bot) {
+        submit_pair(
+            games, std::string{bots[bot]}, opponent, opts.referee, seed,
+            [=, &on_seed](double score) {
+              (bot == 0 ? scores->first : scores->second) = score;
+              if (--*remaining == 0) {
+                on_seed(scores->first, scores->second);
+              }
+            },
+            [=, &played, &stats](game_id, int seat, run_result &r) {
+              played++;
+              auto mine = r;
+              if (seat == 1) {
+                std::swap(mine.p1_score, mine.p2_score);
+              }
+              aggregate(mine, stats[bot]);
+            });
+      }
+    };
+
+    const auto refill = [&] {
+      while ((int)games.pending() < games.slot_count() &&
+             (started + 1) * 4 <= (size_t)opts.process_count) {
+        start_seed();
+      }
+    };
+
+    refill();
+    while (!games.idle()) {
+      games.poll();
+      refill();
+    }
+  });
+
+  std::cout << '\n';
+  print_bot('A', bots[0], stats[0]);
+  print_bot('B', bots[1], stats[1]);
+  print_difference(difference);
+  std::cout << " over " << difference.seeds() << " seeds (" << played
+            << " games)\n"
+            << "A better on " << difference.better() << " seeds, worse on "
+            << difference.worse() << ", same on " << difference.ties() << '\n';
+  const double paired = difference.standard_error();
+  const double unpaired = difference.unpaired_standard_error();
+  if (std::isfinite(paired) && paired > 0 && std::isfinite(unpaired)) {
+    // Games scale the variance down, not the standard error
+    const double games_ratio = unpaired * unpaired / (paired * paired);
+    std::cout << vt100::faint << "Standard error " << percent(paired, false)
+              << ", " << percent(unpaired, false)
+              << " with two separate runs, which would need "
+              << std::setprecision(3) << games_ratio
+              << "x the games to be as precise" << std::setprecision(6)
+              << vt100::reset << '\n';
+  }
+  std::cout << std::flush;
+  return 0;
+}
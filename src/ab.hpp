@@ -0,0 +1,56 @@
+#ifndef HEADER_GUARD_DPSG_AB_HPP
+#define HEADER_GUARD_DPSG_AB_HPP
+
+#include <utility>
+
+// Difference between two bots A and B playing a common opponent on the same
+// seeds, seed by seed. Each bot scores the average points of its side-swapped
+// pair on the seed (0 to 1), and only the difference of the two scores is
+// averaged, so that how hard each seed is cancels out instead of adding to
+// the variance as with two separate runs.
+class paired_difference {
+public:
+  void add(double a, double b);
+
+  int seeds() const { return _n; }
+  // Seeds on which A scored more, less, as much as B
+  int better() const { return _better; }
+  int worse() const { return _worse; }
+  int ties() const { return _n - _better - _worse; }
+
+  // Mean of the differences A - B and its normal interval at `z` standard
+  // errors
+  double mean() const;
+  double standard_error() const;
+  std::pair<double, double> interval(double z = 1.96) const;
+
+  // Standard error of the same difference measured by two runs on different
+  // seeds, estimated from the scores of each bot
+  double unpaired_standard_error() const;
+
+  // Two-sided p-value of the sign test: odds of the seeds splitting between A
+  // and B at least this unevenly if neither were better, ties left out
+  double sign_test() const;
+
+private:
+  struct moments {
+    double sum = 0;
+    double sum_squares = 0;
+    void add(double x) {
+      sum += x;
+      sum_squares += x * x;
+    }
+    double variance(int n) const;
+  };
+
+  int _n = 0;
+  int _better = 0;
+  int _worse = 0;
+  moments _a, _b, _difference;
+};
+
+// Entry point of `runner ab -2 <opponent> -r <referee> [options] <A> <B>`,
+// argv[0] being "ab".
+int run_ab(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_AB_HPP
@@ -0,0 +1,299 @@
+#include "bisect.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <string>
+
+namespace {
+constexpr double confidence = 0.95;
+
+double entropy(double p) {
+  if (p <= 0 || p >= 1) {
+    return 0;
+  }
+  return -p * std::log2(p) - (1 - p) * std::log2(1 - p);
+}
+} // namespace
+
+bisection::bisection(size_t build_count) : _builds(build_count) {}
+
+void bisection::add(size_t build, double score) { _builds[build].add(score); }
+
+double bisection::mean(size_t build) const { return _builds[build].mean(); }
+
+double bisection::standard_error(size_t build) const {
+  return _builds[build].standard_error();
+}
+
+double bisection::gap_z() const {
+  const size_t last = size() - 1;
+  if (pairs(0) == 0 || pairs(last) == 0) {
+    return 0;
+  }
+  return (mean(0) - mean(last)) /
+         std::hypot(standard_error(0), standard_error(last));
+}
+
+bool bisection::anchored() const {
+  return pairs(0) >= anchor_pairs && pairs(size() - 1) >= anchor_pairs &&
+         gap_z() >= anchor_z;
+}
+
+double bisection::threshold() const {
+  return (mean(0) + mean(size() - 1)) / 2;
+}
+
+double bisection::probability_bad(size_t build) const {
+  if (build == 0) {
+    return 0;
+  }
+  if (build == size() - 1) {
+    return 1;
+  }
+  if (pairs(build) == 0) {
+    return 0.5;
+  }
+  const double z = (mean(build) - threshold()) / standard_error(build);
+  return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+std::vector<double> bisection::posterior() const {
+  const size_t n = size();
+  std::vector<double> log_p(n, -std::numeric_limits<double>::infinity());
+  if (n < 2) {
+    return std::vector<double>(n, 0);
+  }
+
+  // First bad build k: the middle builds before k are good, the others bad
+  std::vector<double> log_good(n), log_bad(n);
+  for (size_t i = 1; i + 1 < n; ++i) {
+    const double b = std::clamp(probability_bad(i), 1e-12, 1 - 1e-12);
+    log_good[i] = std::log(1 - b);
+    log_bad[i] = std::log(b);
+  }
+  double bad_suffix = 0;
+  for (size_t i = 1; i + 1 < n; ++i) {
+    bad_suffix += log_bad[i];
+  }
+  double good_prefix = 0;
+  for (size_t k = 1; k < n; ++k) {
+    log_p[k] = good_prefix + bad_suffix;
+    good_prefix += log_good[k];
+    bad_suffix -= log_bad[k];
+  }
+
+  const double top = *std::max_element(log_p.begin() + 1, log_p.end());
+  std::vector<double> p(n, 0);
+  double total = 0;
+  for (size_t k = 1; k < n; ++k) {
+    p[k] = std::exp(log_p[k] - top);
+    total += p[k];
+  }
+  for (auto &x : p) {
+    x /= total;
+  }
+  return p;
+}
+
+size_t bisection::most_likely() const {
+  auto p = posterior();
+  return std::max_element(p.begin(), p.end()) - p.begin();
+}
+
+bisection::interval bisection::credible(double mass) const {
+  auto p = posterior();
+  interval r{most_likely(), most_likely(), 0};
+  r.mass = p[r.first];
+  while (r.mass < mass && (r.first > 1 || r.last + 1 < p.size())) {
+    const double before = r.first > 1 ? p[r.first - 1] : -1;
+    const double after = r.last + 1 < p.size() ? p[r.last + 1] : -1;
+    if (before >= after) {
+      r.mass += p[--r.first];
+    } else {
+      r.mass += p[++r.last];
+    }
+  }
+  return r;
+}
+
+std::optional<size_t>
+bisection::next(const std::vector<int> &in_flight,
+                const std::vector<bool> &available) const {
+  const size_t last = size() - 1;
+
+  // Until the ends are known apart, nothing can be said of the middle
+  if (!anchored()) {
+    const auto load = [&](size_t b) { return pairs(b) + in_flight[b]; };
+    if (available[0] && (!available[last] || load(0) <= load(last))) {
+      return 0;
+    }
+    if (available[last]) {
+      return last;
+    }
+    return std::nullopt;
+  }
+
+  // Expected split of the posterior by the build's judgement, discounted by
+  // how settled that judgement already is and by the pairs already on their
+  // way
+  auto p = posterior();
+  std::optional<size_t> best;
+  double best_score = 0;
+  double cumulative = 0;
+  for (size_t i = 1; i < last; ++i) {
+    cumulative += p[i];
+    if (!available[i]) {
+      continue;
+    }
+    const double score = entropy(cumulative) * entropy(probability_bad(i)) /
+                         (1 + in_flight[i]);
+    if (score > best_score) {
+      best_score = score;
+      best = i;
+    }
+  }
+  return best;
+}
+
+namespace {
+void print_builds(const bisection &b,
+                  const std::vector<std::string_view> &builds) {
+  using namespace dpsg;
+  const auto p = b.posterior();
+  const auto best = b.most_likely();
+  for (size_t i = 0; i < builds.size(); ++i) {
+    std::cout << (i == best ? vt100::red : vt100::reset) << std::setw(4) << i
+              << vt100::reset << "  " << std::setw(5) << b.pairs(i)
+              << " pairs  ";
+    if (b.pairs(i) > 0) {
+      std::cout << std::fixed << std::setprecision(3) << b.mean(i) << " ± "
+                << std::min(1.96 * b.standard_error(i), 1.0);
+    } else {
+      std::cout << "    -        ";
+    }
+    std::cout << "  first bad " << std::setw(5) << std::setprecision(1)
+              << 100 * p[i] << "%  " << builds[i] << std::defaultfloat
+              << std::setprecision(6) << '\n';
+  }
+}
+} // namespace
+
+int run_bisect(int argc, const char **argv) {
+  using namespace dpsg;
+  auto opts = parse_options(argc, argv);
+  const auto &builds = opts.arguments;
+  if (builds.size() < 3 || opts.referee.empty()) {
+    std::cerr << "Usage: runner bisect [-2 <baseline>] -r <referee> "
+                 "[-c <max games>] [options] <good build> <builds...> <bad "
+                 "build>\n"
+                 "  -c defaults to every build playing every seed"
+              << std::endl;
+    return 1;
+  }
+
+  // Without a baseline, the builds play the first (good) one
+  const std::string baseline{opts.p2.empty() ? builds.front() : opts.p2};
+  const auto read = read_pair_seeds(opts, 2 * builds.size(), 2);
+  if (!read) {
+    return 1;
+  }
+  const auto &seeds = *read;
+  const size_t exhaustive = 2 * builds.size() * seeds.size();
+
+  bisection estimate{builds.size()};
+  std::vector<int> in_flight(builds.size(), 0);
+  // Pairs started by each build, which is also the index of its next seed:
+  // all builds play the same seeds in the same order
+  std::vector<size_t> started(builds.size(), 0);
+  std::vector<bool> available(builds.size(), true);
+
+  size_t played = 0;
+  size_t submitted = 0;
+
+  const auto done = [&] {
+    if (estimate.anchored()) {
+      return estimate.posterior()[estimate.most_likely()] >= confidence;
+    }
+    // Both ends played all their seeds without showing a regression
+    return !available.front() && !available.back() && in_flight.front() == 0 &&
+           in_flight.back() == 0;
+  };
+
+  const auto on_pair = [&](size_t build, double score) {
+    in_flight[build]--;
+    estimate.add(build, score);
+
+    std::cout << vt100::cyan << "Pair " << std::setw(5) << played / 2
+              << vt100::reset << " build " << std::setw(3) << build
+              << " scored " << std::setw(4) << score;
+    if (estimate.anchored()) {
+      const auto best = estimate.most_likely();
+      std::cout << ", first bad build " << best << " ("
+                << std::setprecision(3) << 100 * estimate.posterior()[best]
+                << std::setprecision(6) << "%)";
+    } else {
+      std::cout << ", ends " << std::setprecision(3) << estimate.gap_z()
+                << std::setprecision(6) << " standard errors apart";
+    }
+    std::cout << std::endl;
+  };
+
+  with_pair_engine(opts, [&](auto &games) {
+    const auto start_pair = [&](size_t build) {
+      const auto &seed = seeds[started[build]++];
+      if (started[build] == seeds.size()) {
+        available[build] = false;
+      }
+      in_flight[build]++;
+      submit_pair(
+          games, std::string{builds[build]}, baseline, opts.referee, seed,
+          [&on_pair, build](double score) { on_pair(build, score); },
+          [&played](game_id, int, run_result &) { played++; });
+      submitted += 2;
+    };
+
+    // Pairs are handed out one at a time from the current estimate, so that
+    // the slots always go to the builds that matter the most right now
+    const auto refill = [&] {
+      while ((int)games.pending() < games.slot_count() &&
+             submitted + 2 <= (size_t)opts.process_count && !done()) {
+        auto build = estimate.next(in_flight, available);
+        if (!build) {
+          break;
+        }
+        start_pair(*build);
+      }
+    };
+
+    refill();
+    while (!games.idle()) {
+      games.poll();
+      refill();
+    }
+  });
+
+  std::cout << '\n';
+  print_builds(estimate, builds);
+  std::cout << '\n' << played << " games played, evaluating every build on "
+            << seeds.size() << " seeds would take " << exhaustive << std::endl;
+
+  if (!estimate.anchored()) {
+    std::cout << vt100::yellow << "No regression found" << vt100::reset
+              << ": the last build isn't clearly worse than the first ("
+              << std::setprecision(3) << estimate.gap_z()
+              << " standard errors, " << bisection::anchor_z << " needed)"
+              << std::endl;
+    return 1;
+  }
+  const auto best = estimate.most_likely();
+  const auto range = estimate.credible(confidence);
+  std::cout << vt100::green << "First bad build" << vt100::reset << ": " << best
+            << " (" << builds[best] << "), " << std::setprecision(3)
+            << 100 * estimate.posterior()[best] << "% likely, "
+            << 100 * range.mass << "% within builds " << range.first << " to "
+            << range.last << std::endl;
+  return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef HEADER_GUARD_DPSG_BISECT_HPP
+#define HEADER_GUARD_DPSG_BISECT_HPP
+
+#include "pairs.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+// Where does a regression start in an ordered list of builds? Each build plays
+// side-swapped pairs against a baseline, scoring the average points of the
+// pair (0 to 1). The first build is taken as good and the last one as bad, and
+// the builds before the first bad one are assumed to play like the first, the
+// ones after like the last.
+//
+// A build is judged bad when its score is below the midpoint between the two
+// ends, with a normal approximation of its mean. The posterior over the first
+// bad build follows from these judgements (uniform prior), and pairs go to the
+// builds whose judgement would split the remaining probability best, like a
+// probabilistic binary search.
+class bisection {
+public:
+  // Pairs each end plays before the middle builds are looked at
+  constexpr static inline int anchor_pairs = 4;
+  // How many standard errors apart the two ends must be for the regression to
+  // be considered real
+  constexpr static inline double anchor_z = 2.5;
+
+  explicit bisection(size_t build_count);
+
+  void add(size_t build, double score);
+
+  size_t size() const { return _builds.size(); }
+  int pairs(size_t build) const { return _builds[build].n; }
+  double mean(size_t build) const;
+  double standard_error(size_t build) const;
+
+  // Whether the ends are known apart, the last one being worse
+  bool anchored() const;
+  // How many standard errors the first build is above the last one
+  double gap_z() const;
+  double threshold() const;
+  // Probability that a build plays like the last one
+  double probability_bad(size_t build) const;
+
+  // Probability of each build being the first bad one, 0 for the first build
+  std::vector<double> posterior() const;
+  size_t most_likely() const;
+
+  // Smallest run of builds around the most likely one holding at least
+  // `mass` of the posterior
+  struct interval {
+    size_t first;
+    size_t last;
+    double mass;
+  };
+  interval credible(double mass) const;
+
+  // Build which should play the next pair. `in_flight` counts the pairs being
+  // played for each build, and builds for which `available` is false are
+  // skipped. Nothing when no build can play.
+  std::optional<size_t> next(const std::vector<int> &in_flight,
+                             const std::vector<bool> &available) const;
+
+private:
+  std::vector<pair_scores> _builds;
+};
+
+// Entry point of `runner bisect <builds...> <options...>`, argv[0] being
+// "bisect".
+int run_bisect(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_BISECT_HPP
@@ -0,0 +1,241 @@
+#include "bootstrap.hpp"
+#include "result_store.hpp"
+#include "statistics.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// Draws made at once by the resampling kernel: the indices are computed in a
+// loop without dependencies, then the columns gathered
+constexpr size_t draw_block = 512;
+// Resamples per task, so that the threads share the work evenly
+constexpr size_t resamples_per_task = 64;
+
+// Counter-based generator: the n-th draw doesn't depend on the previous ones
+constexpr uint64_t splitmix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+// Sums over the games of each resampled unit, column-wise
+struct units {
+  std::vector<int32_t> games;
+  // Half points of player 1: 2 for a win, 1 for a draw
+  std::vector<int32_t> half_points;
+  // Games without errors, and their point difference
+  std::vector<int32_t> valid;
+  std::vector<int64_t> difference;
+
+  size_t size() const { return games.size(); }
+  void add(size_t unit, uint8_t outcome, int32_t p1, int32_t p2) {
+    if (unit == size()) {
+      games.push_back(0);
+      half_points.push_back(0);
+      valid.push_back(0);
+      difference.push_back(0);
+    }
+    games[unit]++;
+    const bool error = (outcome & result_store::both_error) != 0;
+    if (!error) {
+      half_points[unit] += outcome == result_store::p1_wins ? 2
+                           : outcome == result_store::draw  ? 1
+                                                            : 0;
+      valid[unit]++;
+      difference[unit] += (int64_t)p1 - p2;
+    } else if ((outcome & result_store::both_error) ==
+               result_store::both_error) {
+      half_points[unit] += 1;
+    } else if (outcome & result_store::p2_error) {
+      half_points[unit] += 2;
+    }
+  }
+};
+
+struct totals {
+  int64_t games = 0;
+  int64_t half_points = 0;
+  int64_t valid = 0;
+  int64_t difference = 0;
+
+  double score() const { return (double)half_points / (2.0 * (double)games); }
+  double mean_difference() const {
+    return valid == 0 ? std::numeric_limits<double>::quiet_NaN()
+                      : (double)difference / (double)valid;
+  }
+};
+
+totals resample(const units &u, uint64_t key) {
+  const size_t n = u.size();
+  uint32_t index[draw_block];
+  totals t;
+  for (size_t start = 0; start < n; start += draw_block) {
+    const size_t count = std::min(draw_block, n - start);
+    for (size_t i = 0; i < count; ++i) {
+      // Multiply-shift maps the 32 high bits to [0, n)
+      index[i] = (uint32_t)(((splitmix(key + start + i) >> 32) * n) >> 32);
+    }
+    for (size_t i = 0; i < count; ++i) {
+      t.games += u.games[index[i]];
+      t.half_points += u.half_points[index[i]];
+      t.valid += u.valid[index[i]];
+      t.difference += u.difference[index[i]];
+    }
+  }
+  return t;
+}
+
+// BCa interval from the bootstrap replicates and the leave-one-out estimates
+bootstrap_interval bca(double estimate, std::vector<double> &replicates,
+                       const std::vector<double> &jackknife,
+                       double confidence) {
+  bootstrap_interval r{.estimate = estimate, .low = estimate, .high = estimate};
+  std::erase_if(replicates, [](double x) { return std::isnan(x); });
+  if (replicates.empty()) {
+    return r;
+  }
+  std::sort(replicates.begin(), replicates.end());
+  const double b = (double)replicates.size();
+
+  // Bias: how far the median of the replicates is from the estimate
+  const auto below =
+      std::lower_bound(replicates.begin(), replicates.end(), estimate) -
+      replicates.begin();
+  const auto equal =
+      std::upper_bound(replicates.begin(), replicates.end(), estimate) -
+      replicates.begin() - below;
+  const double z0 = normal_quantile(std::clamp(
+      ((double)below + (double)equal / 2) / b, 0.5 / b, 1 - 0.5 / b));
+
+  // Acceleration: skewness of the influence of each unit
+  double mean = 0;
+  size_t count = 0;
+  for (double x : jackknife) {
+    if (!std::isnan(x)) {
+      mean += x;
+      count++;
+    }
+  }
+  mean /= (double)std::max<size_t>(count, 1);
+  double squares = 0, cubes = 0;
+  for (double x : jackknife) {
+    if (!std::isnan(x)) {
+      const double d = mean - x;
+      squares += d * d;
+      cubes += d * d * d;
+    }
+  }
+  const double a =
+      squares > 0 ? cubes / (6 * std::pow(squares, 1.5)) : 0.0;
+
+  const auto percentile = [&](double q) {
+    const double z = normal_quantile(q);
+    const double adjusted = normal_cdf(z0 + (z0 + z) / (1 - a * (z0 + z)));
+    const auto idx =
+        (size_t)std::clamp(adjusted * (b - 1) + 0.5, 0.0, b - 1);
+    return replicates[idx];
+  };
+  const double alpha = (1 - confidence) / 2;
+  r.low = percentile(alpha);
+  r.high = percentile(1 - alpha);
+  return r;
+}
+} // namespace
+
+double elo_difference(double score) {
+  // Certain wins or losses have no finite Elo difference
+  score = std::clamp(score, 1e-3, 1 - 1e-3);
+  return -400 * std::log10(1 / score - 1);
+}
+
+bootstrap_summary bootstrap(const result_store &results, thread_pool &pool,
+                            size_t resamples, double confidence,
+                            uint64_t random_seed) {
+  bootstrap_summary summary;
+  summary.resamples = resamples;
+  summary.confidence = confidence;
+  if (results.size() == 0 || resamples == 0) {
+    return summary;
+  }
+
+  // Games on the same seed are resampled together, games without a seed
+  // alone
+  std::vector<uint32_t> games_per_seed(results.seed_count(), 0);
+  for (size_t i = 0; i < results.size(); ++i) {
+    if (!results.seed(i).empty()) {
+      summary.paired |= ++games_per_seed[results.seed_id(i)] > 1;
+    }
+  }
+  units u;
+  std::vector<uint32_t> unit_of_seed(results.seed_count(), UINT32_MAX);
+  for (size_t i = 0; i < results.size(); ++i) {
+    size_t unit = u.size();
+    if (summary.paired && !results.seed(i).empty()) {
+      auto &known = unit_of_seed[results.seed_id(i)];
+      if (known == UINT32_MAX) {
+        known = (uint32_t)unit;
+      }
+      unit = known;
+    }
+    u.add(unit, results.get_outcome(i), results.p1_score(i),
+          results.p2_score(i));
+  }
+  summary.units = u.size();
+
+  totals all;
+  for (size_t i = 0; i < u.size(); ++i) {
+    all.games += u.games[i];
+    all.half_points += u.half_points[i];
+    all.valid += u.valid[i];
+    all.difference += u.difference[i];
+  }
+
+  std::vector<double> scores(resamples), differences(resamples);
+  for (size_t first = 0; first < resamples; first += resamples_per_task) {
+    pool.submit([&, first] {
+      const size_t last = std::min(first + resamples_per_task, resamples);
+      for (size_t r = first; r < last; ++r) {
+        const auto t = resample(u, splitmix(random_seed ^ splitmix(r)));
+        scores[r] = t.score();
+        differences[r] = t.mean_difference();
+      }
+    });
+  }
+
+  // Leave-one-out estimates, for the acceleration
+  std::vector<double> jackknife_scores(u.size()),
+      jackknife_differences(u.size());
+  for (size_t i = 0; i < u.size(); ++i) {
+    totals t{
+        .games = all.games - u.games[i],
+        .half_points = all.half_points - u.half_points[i],
+        .valid = all.valid - u.valid[i],
+        .difference = all.difference - u.difference[i],
+    };
+    jackknife_scores[i] =
+        t.games == 0 ? std::numeric_limits<double>::quiet_NaN() : t.score();
+    jackknife_differences[i] = t.mean_difference();
+  }
+  pool.wait();
+
+  summary.p1_score = bca(all.score(), scores, jackknife_scores, confidence);
+  // The interval of a monotonic transformation is the transformation of the
+  // interval
+  summary.elo = bootstrap_interval{
+      .estimate = elo_difference(summary.p1_score.estimate),
+      .low = elo_difference(summary.p1_score.low),
+      .high = elo_difference(summary.p1_score.high),
+  };
+  if (all.valid > 0) {
+    summary.point_difference = bca(all.mean_difference(), differences,
+                                   jackknife_differences, confidence);
+  } else {
+    summary.point_difference.estimate =
+        std::numeric_limits<double>::quiet_NaN();
+  }
+  return summary;
+}
@@ -0,0 +1,53 @@
+#ifndef HEADER_GUARD_DPSG_BOOTSTRAP_HPP
+#define HEADER_GUARD_DPSG_BOOTSTRAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class result_store;
+class thread_pool;
+
+// Confidence interval of a statistic, from its bootstrap distribution
+struct bootstrap_interval {
+  double estimate = 0;
+  double low = 0;
+  double high = 0;
+};
+
+// Confidence intervals of the results of a run, which make no assumption on
+// the shape of their distribution (point differences are skewed and bimodal,
+// mean ± standard deviation says little about them).
+//
+// The games are resampled with replacement, or the seeds with all their games
+// when seeds were played several times (e.g. side-swapped), since games on the
+// same seed aren't independent. The intervals are BCa (bias-corrected and
+// accelerated) percentile intervals.
+struct bootstrap_summary {
+  // Games or seeds resampled
+  size_t units = 0;
+  bool paired = false;
+  size_t resamples = 0;
+  double confidence = 0;
+
+  // Points of player 1 per game: 1 for a win, 0.5 for a draw
+  bootstrap_interval p1_score;
+  // Elo difference of player 1 over player 2, from its score
+  bootstrap_interval elo;
+  // Mean of p1 - p2 points, over the games without errors. Not computed
+  // (estimate NaN) when there are none.
+  bootstrap_interval point_difference;
+};
+
+constexpr size_t default_resamples = 2000;
+
+// Runs the resamples on `pool`. Nothing is computed without results.
+bootstrap_summary bootstrap(const result_store &results, thread_pool &pool,
+                            size_t resamples = default_resamples,
+                            double confidence = 0.95,
+                            uint64_t random_seed = 0x5eed);
+
+// Elo difference matching an expected score
+double elo_difference(double score);
+
+#endif // HEADER_GUARD_DPSG_BOOTSTRAP_HPP
@@ -0,0 +1,204 @@
+#include "cgroup.hpp"
+#include "posix.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace {
+namespace fs = std::filesystem;
+using namespace dpsg::posix;
+
+bool write_file(const fs::path &path, std::string_view content) {
+  int fd = native::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return false;
+  }
+  auto r = write((fd_t)fd, content.data(), content.size());
+  native::close(fd);
+  return r.is_value();
+}
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in{path};
+  std::ostringstream s;
+  s << in.rdbuf();
+  return s.str();
+}
+
+// Mount point of the unified hierarchy, empty if there is none
+fs::path unified_mount() {
+  for (const char *candidate : {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"}) {
+    if (fs::exists(fs::path{candidate} / "cgroup.controllers")) {
+      return candidate;
+    }
+  }
+  return {};
+}
+
+// Path of our own cgroup, relative to the mount point
+fs::path own_cgroup() {
+  std::ifstream in{"/proc/self/cgroup"};
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.starts_with("0::")) {
+      return fs::path{line.substr(3)}.relative_path();
+    }
+  }
+  return {};
+}
+
+bool has_controller(std::string_view controllers, std::string_view name) {
+  std::istringstream s{std::string{controllers}};
+  std::string c;
+  while (s >> c) {
+    if (c == name) {
+      return true;
+    }
+  }
+  return false;
+}
+} // namespace
+
+cgroup_manager::cgroup_manager(const resource_limits &limits)
+    : _limits(limits) {
+  auto mount = unified_mount();
+  if (mount.empty()) {
+    return;
+  }
+  auto dir = mount / own_cgroup();
+
+  std::string enable;
+  const auto available = read_file(dir / "cgroup.controllers");
+  for (auto [name, needed] : {std::pair{"memory", true},
+                              {"cpu", limits.cpu_max > 0},
+                              {"pids", limits.pids_max > 0}}) {
+    if (has_controller(available, name)) {
+      enable += std::string{"+"} + name + ' ';
+    } else if (needed) {
+      return;
+    }
+  }
+  if (enable.empty()) {
+    return;
+  }
+
+  if (!write_file(dir / "cgroup.subtree_control", enable)) {
+    // We are probably in the way: get out, and try again
+    auto self = dir / ("runner-" + std::to_string((uint64_t)dpsg::posix::getpid()));
+    std::error_code ec;
+    if (!fs::create_directory(self, ec) ||
+        !write_file(self / "cgroup.procs", "0")) {
+      fs::remove(self, ec);
+      return;
+    }
+    if (!write_file(dir / "cgroup.subtree_control", enable)) {
+      write_file(dir / "cgroup.procs", "0");
+      fs::remove(self, ec);
+      return;
+    }
+    _self_leaf = self;
+  }
+  _base = dir;
+}
+
+cgroup_manager::~cgroup_manager() {
+  _remove_stale();
+  if (!_self_leaf.empty()) {
+    write_file(_base / "cgroup.procs", "0");
+    std::error_code ec;
+    fs::remove(_self_leaf, ec);
+  }
+}
+
+fs::path cgroup_manager::_leaf(game_id id) const {
+  return _base / ("game-" + std::to_string((uint64_t)dpsg::posix::getpid()) + '-' +
+                  std::to_string(id));
+}
+
+std::string cgroup_manager::prepare(game_id id) {
+  auto leaf = _leaf(id);
+  std::error_code ec;
+  fs::create_directory(leaf, ec);
+
+  if (_limits.memory_max > 0) {
+    write_file(leaf / "memory.max", std::to_string(_limits.memory_max));
+    // Keep runaway bots from pushing the other games into swap
+    write_file(leaf / "memory.swap.max", "0");
+  }
+  if (_limits.cpu_max > 0) {
+    constexpr uint64_t period = 100000;
+    auto quota = std::max<uint64_t>(1000, (uint64_t)(_limits.cpu_max * period));
+    write_file(leaf / "cpu.max",
+               std::to_string(quota) + ' ' + std::to_string(period));
+  }
+  if (_limits.pids_max > 0) {
+    write_file(leaf / "pids.max", std::to_string(_limits.pids_max));
+  }
+  return leaf / "cgroup.procs";
+}
+
+resource_usage cgroup_manager::release(game_id id) {
+  auto leaf = _leaf(id);
+  resource_usage usage;
+
+  std::istringstream cpu{read_file(leaf / "cpu.stat")};
+  std::string key;
+  uint64_t value;
+  while (cpu >> key >> value) {
+    if (key == "usage_usec") {
+      usage.cpu_usec = value;
+      break;
+    }
+  }
+  std::istringstream{read_file(leaf / "memory.peak")} >> usage.memory_peak;
+
+  // Bots ignoring the referee's termination request are still in there
+  write_file(leaf / "cgroup.kill", "1");
+  _stale.push_back(leaf);
+  _remove_stale();
+  return usage;
+}
+
+void cgroup_manager::_remove_stale() {
+  std::erase_if(_stale, [](const fs::path &leaf) {
+    std::error_code ec;
+    return fs::remove(leaf, ec) || ec == std::errc::no_such_file_or_directory;
+  });
+}
+
+void join_cgroup(const char *procs_path) {
+  int fd = native::open(procs_path, O_WRONLY | O_CLOEXEC);
+  if (fd == -1 || native::write(fd, "0", 1) != 1) {
+    constexpr char msg[] = "Failed to join the game's cgroup\n";
+    native::write(STDERR_FILENO, msg, sizeof(msg) - 1);
+  }
+  native::close(fd);
+}
+
+void apply_rlimits(const resource_limits &limits) {
+  if (limits.memory_max > 0) {
+    struct rlimit l {
+      limits.memory_max, limits.memory_max
+    };
+    native::setrlimit(RLIMIT_AS, &l);
+  }
+}
+
+resource_usage usage_from(const struct rusage &usage) {
+  const auto usec = [](const timeval &t) {
+    return (uint64_t)t.tv_sec * 1000000 + (uint64_t)t.tv_usec;
+  };
+  return resource_usage{
+      .cpu_usec = usec(usage.ru_utime) + usec(usage.ru_stime),
+      .memory_peak = (uint64_t)usage.ru_maxrss * 1024,
+  };
+}
+
+void resource_statistics::add(const resource_usage &usage) {
+  games++;
+  cpu_usec_total += usage.cpu_usec;
+  cpu_usec_max = std::max(cpu_usec_max, usage.cpu_usec);
+  memory_peak_total += usage.memory_peak;
+  memory_peak_max = std::max(memory_peak_max, usage.memory_peak);
+}
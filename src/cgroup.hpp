@@ -0,0 +1,86 @@
+#ifndef HEADER_GUARD_DPSG_CGROUP_HPP
+#define HEADER_GUARD_DPSG_CGROUP_HPP
+
+#include "engine.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Limits applied to each game (the referee and the bots it spawns).
+struct resource_limits {
+  // Bytes, 0 for no limit
+  uint64_t memory_max = 0;
+  // Fraction of a CPU, 0 for no limit
+  double cpu_max = 0;
+  // Number of processes and threads, 0 for no limit
+  uint64_t pids_max = 0;
+
+  bool any() const { return memory_max > 0 || cpu_max > 0 || pids_max > 0; }
+};
+
+struct resource_usage {
+  uint64_t cpu_usec = 0;
+  uint64_t memory_peak = 0;
+};
+
+// Puts each game in its own leaf of the cgroup v2 hierarchy, under the cgroup
+// the runner was started in (which must be delegated to the user, e.g. with
+// `systemd-run --user --scope -p Delegate=yes runner ...`).
+//
+// As a cgroup can't both contain processes and distribute resources to its
+// children, the runner moves itself to a leaf of its own if needed.
+class cgroup_manager {
+public:
+  explicit cgroup_manager(const resource_limits &limits);
+  cgroup_manager(const cgroup_manager &) = delete;
+  cgroup_manager &operator=(const cgroup_manager &) = delete;
+  ~cgroup_manager();
+
+  bool available() const { return !_base.empty(); }
+
+  // Creates the leaf of a game and returns the path of its cgroup.procs, to
+  // which the child process writes itself (see `join_cgroup`).
+  std::string prepare(game_id id);
+
+  // Reads the resource usage of the game, kills what's left of it and
+  // removes its leaf.
+  resource_usage release(game_id id);
+
+private:
+  std::filesystem::path _leaf(game_id id) const;
+  void _remove_stale();
+
+  resource_limits _limits;
+  std::filesystem::path _base;
+  // Leaf the runner moved itself to, if it had to
+  std::filesystem::path _self_leaf;
+  std::vector<std::filesystem::path> _stale;
+};
+
+// Moves the calling process to the cgroup whose cgroup.procs is given.
+// Async-signal-safe, to be called between fork and exec.
+void join_cgroup(const char *procs_path);
+
+// Fallback when cgroups are unavailable: limits the calling process with
+// setrlimit, the memory limit bounding its address space. Only meant for the
+// bots (see `runner proxy --memory-max`): a JVM reserves far more address
+// space than it uses, and wouldn't start. Async-signal-safe.
+void apply_rlimits(const resource_limits &limits);
+
+resource_usage usage_from(const struct rusage &usage);
+
+struct resource_statistics {
+  size_t games = 0;
+  uint64_t cpu_usec_total = 0;
+  uint64_t cpu_usec_max = 0;
+  uint64_t memory_peak_total = 0;
+  uint64_t memory_peak_max = 0;
+  // Whether the figures come from cgroups, or from getrusage
+  bool from_cgroups = false;
+
+  void add(const resource_usage &usage);
+};
+
+#endif // HEADER_GUARD_DPSG_CGROUP_HPP
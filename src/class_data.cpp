@@ -0,0 +1,104 @@
+#include "class_data.hpp"
+#include "hash.hpp"
+#include "posix.hpp"
+
+#include <charconv>
+#include <cstdio>
+
+namespace {
+namespace fs = std::filesystem;
+using namespace dpsg::posix;
+
+// Output of `java -version`, empty when java can't be run
+std::string java_version() {
+  const char *args[] = {"sh", "-c", "exec java -version 2>&1", nullptr};
+  auto p = run_external("sh", args);
+  native::close((int)p.stdin);
+  native::close((int)p.stderr);
+
+  std::string output;
+  char buffer[512];
+  while (true) {
+    auto r = read(p.stdout, buffer, sizeof(buffer));
+    if (r.is_error() || r.value() == 0) {
+      break;
+    }
+    output.append(buffer, r.value());
+  }
+  native::close((int)p.stdout);
+  int status;
+  native::waitpid((int)p.pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? output : "";
+}
+
+// Major version from `java -version`: `version "17.0.2"` is 17, `version
+// "1.8.0_292"` is 8.
+int java_major_version(std::string_view version) {
+  auto start = version.find("version \"");
+  if (start == std::string_view::npos) {
+    return 0;
+  }
+  version = version.substr(start + 9);
+  int major = 0;
+  auto r = std::from_chars(version.data(), version.data() + version.size(),
+                           major);
+  if (major == 1 && r.ptr < version.data() + version.size() && *r.ptr == '.') {
+    std::from_chars(r.ptr + 1, version.data() + version.size(), major);
+  }
+  return major;
+}
+
+} // namespace
+
+class_data_archive::class_data_archive(const fs::path &jar) {
+  mapped_file content{jar.c_str()};
+  if (!content.is_open()) {
+    return;
+  }
+  auto version = java_version();
+  if (java_major_version(version) < 13) {
+    return;
+  }
+
+  char key[17];
+  std::snprintf(
+      key, sizeof(key), "%016llx",
+      (unsigned long long)dpsg::fnv1a(version, dpsg::fnv1a(content.view())));
+  _path = jar;
+  _path += std::string{"."} + key + ".jsa";
+  _temporary = _path;
+  _temporary += "." + std::to_string((uint64_t)dpsg::posix::getpid()) + ".tmp";
+  _state = fs::exists(_path) ? state::ready : state::missing;
+}
+
+std::string class_data_archive::flag_for(game_id id) {
+  auto current = _state.load();
+  if (current == state::ready) {
+    return "-XX:SharedArchiveFile=" + _path.string();
+  }
+  std::lock_guard lock{_mutex};
+  _cold.insert(id);
+  if (current == state::missing &&
+      _state.compare_exchange_strong(current, state::creating)) {
+    _creator = id;
+    return "-XX:ArchiveClassesAtExit=" + _temporary.string();
+  }
+  return "";
+}
+
+void class_data_archive::release(game_id id) {
+  std::lock_guard lock{_mutex};
+  _cold.erase(id);
+  if (_state.load() != state::creating || id != _creator) {
+    return;
+  }
+  // Another runner may have created it in the meantime, either will do
+  std::error_code ec;
+  fs::rename(_temporary, _path, ec);
+  _state = ec ? state::disabled : state::ready;
+}
+
+bool class_data_archive::used_by(game_id id) const {
+  std::lock_guard lock{_mutex};
+  return _state.load() != state::disabled && !_cold.contains(id);
+}
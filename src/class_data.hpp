@@ -0,0 +1,66 @@
+#ifndef HEADER_GUARD_DPSG_CLASS_DATA_HPP
+#define HEADER_GUARD_DPSG_CLASS_DATA_HPP
+
+#include "engine.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+// AppCDS archive of the classes loaded by a referee jar, sparing the JVM of
+// every later game most of the class loading and verification.
+//
+// The archive is cached next to the jar, named after a hash of the jar and of
+// the output of `java -version`. When it doesn't exist yet, the first game
+// launched creates it (`-XX:ArchiveClassesAtExit`) and the games launched once
+// its referee exited use it (`-XX:SharedArchiveFile`).
+class class_data_archive {
+public:
+  // Disabled when the JVM is too old for dynamic archives (JDK 13)
+  explicit class_data_archive(const std::filesystem::path &jar);
+  class_data_archive(const class_data_archive &) = delete;
+  class_data_archive &operator=(const class_data_archive &) = delete;
+
+  bool enabled() const { return _state.load() != state::disabled; }
+  const std::filesystem::path &path() const { return _path; }
+
+  // JVM flag to add to the command of game `id`, possibly empty. Thread-safe.
+  std::string flag_for(game_id id);
+
+  // To be called once the referee of game `id` exited.
+  void release(game_id id);
+
+  // Whether game `id` ran with the archive
+  bool used_by(game_id id) const;
+
+private:
+  enum class state { missing, creating, ready, disabled };
+
+  std::filesystem::path _path;
+  std::filesystem::path _temporary;
+  std::atomic<state> _state = state::disabled;
+  game_id _creator = 0;
+
+  mutable std::mutex _mutex;
+  // Games launched without the archive
+  std::unordered_set<game_id> _cold;
+};
+
+// Durations of the games with and without the class data archive.
+struct class_data_statistics {
+  std::filesystem::path archive;
+  size_t games[2] = {0, 0};
+  double total_ms[2] = {0, 0};
+
+  void add(bool with_archive, double duration_ms) {
+    games[with_archive]++;
+    total_ms[with_archive] += duration_ms;
+  }
+  double average_ms(bool with_archive) const {
+    return games[with_archive] == 0 ? 0 : total_ms[with_archive] / games[with_archive];
+  }
+};
+
+#endif // HEADER_GUARD_DPSG_CLASS_DATA_HPP
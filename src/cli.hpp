@@ -29,5 +29,75 @@ inline integer_parse_result parse_unsigned_int(std::string_view str) {
   return integer_parse_result{r};
 }
 
+using size_parse_result = dpsg::integer_result<int64_t, parse_error>;
+
+// Parses a size in bytes, with an optional binary suffix: 512M, 2G...
+inline size_parse_result parse_size(std::string_view str) {
+  int64_t multiplier = 1;
+  if (!str.empty()) {
+    switch (str.back()) {
+    case 'k':
+    case 'K':
+      multiplier = 1ll << 10;
+      break;
+    case 'm':
+    case 'M':
+      multiplier = 1ll << 20;
+      break;
+    case 'g':
+    case 'G':
+      multiplier = 1ll << 30;
+      break;
+    }
+    if (multiplier != 1) {
+      str.remove_suffix(1);
+    }
+  }
+  auto r = parse_unsigned_int(str);
+  if (r.is_error()) {
+    return size_parse_result(r.error());
+  }
+  return size_parse_result{(int64_t)r.value() * multiplier};
+}
+
+using duration_parse_result = dpsg::integer_result<int64_t, parse_error>;
+
+// Parses a duration in seconds: 90, 90s, 20m, 1h30m...
+inline duration_parse_result parse_duration(std::string_view str) {
+  if (str.empty()) {
+    return duration_parse_result(parse_error::empty_string);
+  }
+  int64_t total = 0;
+  while (!str.empty()) {
+    size_t digits = 0;
+    while (digits < str.size() && isdigit(str[digits])) {
+      digits++;
+    }
+    auto r = parse_unsigned_int(str.substr(0, digits));
+    if (r.is_error()) {
+      return duration_parse_result(r.error());
+    }
+    str.remove_prefix(digits);
+    int64_t unit = 1;
+    if (!str.empty()) {
+      switch (str.front()) {
+      case 'h':
+        unit = 3600;
+        break;
+      case 'm':
+        unit = 60;
+        break;
+      case 's':
+        break;
+      default:
+        return duration_parse_result(parse_error::invalid_character);
+      }
+      str.remove_prefix(1);
+    }
+    total += r.value() * unit;
+  }
+  return duration_parse_result{total};
+}
+
 } // namespace cli
 #endif // HEADER_GUARD_DPSG_CLI_HPP
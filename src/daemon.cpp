@@ -0,0 +1,443 @@
+#include "daemon.hpp"
+#include "daemon_protocol.hpp"
+#include "engine.hpp"
+#include "options.hpp"
+#include "runner.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+
+using namespace dpsg::posix;
+
+namespace {
+namespace fs = std::filesystem;
+namespace vt100 = dpsg::vt100;
+
+// How often exited referees are looked for while games run
+constexpr std::chrono::milliseconds reap_interval{20};
+
+// Exits the program unless `directory` is a directory of the user that no
+// one else can enter, creating it when missing: in /tmp, anyone could have
+// made it first
+void make_private_directory(const fs::path &directory) {
+  if (native::mkdir(directory.c_str(), 0700) == -1 && errno != EEXIST) {
+    std::cerr << "Cannot create " << directory << ": " << std::strerror(errno)
+              << std::endl;
+    exit(1);
+  }
+  struct stat st;
+  if (native::lstat(directory.c_str(), &st) == -1 || !S_ISDIR(st.st_mode) ||
+      st.st_uid != native::getuid() || (st.st_mode & 077) != 0) {
+    std::cerr << directory
+              << " must be a directory of the user, closed to the others"
+              << std::endl;
+    exit(1);
+  }
+}
+
+struct job {
+  fd_t socket;
+  message_stream input;
+  // Messages the client hasn't taken yet: a client that stops reading
+  // mustn't hold up the others
+  std::string output;
+  // Until the job message arrives, the job has no games
+  bool started = false;
+  fs::path directory;
+  // The runner of the daemon, in the directory of the client
+  runner launcher;
+  // Games not submitted to the engine yet, with the id the client gave them
+  std::deque<std::pair<game_id, game_t>> queue;
+  // Client id of the games without a result yet, by engine id
+  std::unordered_map<game_id, game_id> running;
+  // Games launched whose referee hasn't exited yet
+  size_t unfinished = 0;
+  // When the job last got a slot, to break ties
+  uint64_t served = 0;
+  size_t games = 0;
+  // The client is gone, the job stays until its referees exit
+  bool closed = false;
+};
+
+class server {
+public:
+  // With `private_directory`, the directory of the socket is created if
+  // need be, and must be the user's alone
+  server(const option_t &opts, fs::path path, bool private_directory);
+  server(const server &) = delete;
+  server &operator=(const server &) = delete;
+  ~server();
+
+  void run();
+
+private:
+  void _accept();
+  void _receive(uint64_t id, job &j);
+  void _start(uint64_t id, job &j, std::string_view directory);
+  void _queue(job &j, message_reader &fields);
+  void _cancel(job &j);
+  void _cancel(job &j, game_id client_id);
+  void _close(uint64_t id, job &j);
+  void _schedule();
+  void _send(job &j, const message_writer &message);
+  void _flush(job &j);
+
+  runner _base;
+  bool _class_data_sharing;
+  // Kept between jobs, by referee
+  std::map<fs::path, std::shared_ptr<class_data_archive>> _archives;
+
+  engine _games;
+  int _listener = -1;
+  fs::path _path;
+
+  std::map<uint64_t, job> _jobs;
+  uint64_t _next_job = 0;
+  // Job and client id of the games launched or about to be, until they exit
+  std::unordered_map<game_id, std::pair<uint64_t, game_id>> _owners;
+  uint64_t _launches = 0;
+};
+
+server::server(const option_t &opts, fs::path path, bool private_directory)
+    : _base(make_runner(opts)), _class_data_sharing(opts.class_data_sharing),
+      _games{opts.parallel_processes,
+             [this](const game_t &game, game_id id) {
+               return _jobs.at(_owners.at(id).first).launcher(game, id);
+             }},
+      _path(std::move(path)) {
+  native::sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (_path.native().size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path too long: " << _path << std::endl;
+    exit(1);
+  }
+  std::strcpy(address.sun_path, _path.c_str());
+  const auto *a = reinterpret_cast<const sockaddr *>(&address);
+  if (private_directory) {
+    make_private_directory(_path.parent_path());
+  }
+
+  _listener = native::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (_listener == -1) {
+    perror("Failed to create the socket");
+    exit(1);
+  }
+  // A socket left by a daemon that was killed is replaced, a live one isn't
+  if (native::bind(_listener, a, sizeof(address)) == -1 &&
+      errno == EADDRINUSE) {
+    int probe = native::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    const bool alive = native::connect(probe, a, sizeof(address)) == 0;
+    native::close(probe);
+    if (alive) {
+      std::cerr << "A daemon is already listening on " << _path << std::endl;
+      exit(1);
+    }
+    native::unlink(_path.c_str());
+    if (native::bind(_listener, a, sizeof(address)) == -1) {
+      perror("Failed to bind the socket");
+      exit(1);
+    }
+  }
+  if (native::listen(_listener, 16) == -1) {
+    perror("Failed to listen on the socket");
+    exit(1);
+  }
+
+  _games.on_launch([this](game_id id, const game_t &) {
+    auto &[job_id, client_id] = _owners.at(id);
+    auto &j = _jobs.at(job_id);
+    j.unfinished++;
+    _send(j, message_writer{daemon_message::launched}.integer(client_id));
+  });
+  _games.on_exit([this](game_id id, const struct rusage &usage) {
+    auto owner = _owners.extract(id);
+    auto &j = _jobs.at(owner.mapped().first);
+    j.unfinished--;
+    const auto used = j.launcher.release(id, usage);
+    _send(j, message_writer{daemon_message::exited}
+                 .integer(owner.mapped().second)
+                 .integer(used.cpu_usec)
+                 .integer(used.memory_peak));
+  });
+}
+
+server::~server() {
+  native::close(_listener);
+  native::unlink(_path.c_str());
+}
+
+void server::_send(job &j, const message_writer &message) {
+  if (!j.closed) {
+    message.append_to(j.output);
+    _flush(j);
+  }
+}
+
+// What doesn't fit in the socket is sent when it becomes writable again
+void server::_flush(job &j) {
+  size_t sent = 0;
+  while (sent < j.output.size()) {
+    auto w = write(j.socket, j.output.data() + sent, j.output.size() - sent);
+    if (w.is_error()) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // A client that went away is noticed when reading from it
+      break;
+    }
+    sent += w.value();
+  }
+  j.output.erase(0, sent);
+}
+
+void server::_accept() {
+  int client = native::accept4(_listener, nullptr, nullptr,
+                               SOCK_CLOEXEC | SOCK_NONBLOCK);
+  if (client == -1) {
+    return;
+  }
+  // Games run whatever commands the client sends, with the rights of the
+  // daemon: only its user may send them
+  native::ucred peer{};
+  socklen_t size = sizeof(peer);
+  if (native::getsockopt(client, SOL_SOCKET, SO_PEERCRED, &peer, &size) ==
+          -1 ||
+      peer.uid != native::getuid()) {
+    std::cerr << vt100::red << "Refused a client of user " << peer.uid
+              << vt100::reset << std::endl;
+    native::close(client);
+    return;
+  }
+  _jobs[_next_job++].socket = (fd_t)client;
+}
+
+void server::_start(uint64_t id, job &j, std::string_view directory) {
+  j.started = true;
+  j.directory = directory;
+  j.launcher = _base;
+  j.launcher.working_directory = j.directory;
+  _send(j, message_writer{daemon_message::welcome}.integer(
+               (uint64_t)_games.slot_count()));
+  std::cout << vt100::cyan << "Job " << id << vt100::reset << " started in "
+            << j.directory.string() << std::endl;
+}
+
+void server::_queue(job &j, message_reader &fields) {
+  const auto client_id = (game_id)fields.integer();
+  game_t game;
+  game.player1 = fields.string();
+  game.player2 = fields.string();
+  game.referee = fields.string();
+  game.seed = fields.string();
+  game.output_file = fields.string();
+
+  // The first referee of the job picks its archive
+  if (_class_data_sharing && !j.launcher.class_data && j.games == 0 &&
+      !game.referee.ends_with(".so")) {
+    auto &archive =
+        _archives[(j.directory / game.referee).lexically_normal()];
+    if (!archive) {
+      archive = std::make_shared<class_data_archive>(j.directory /
+                                                     game.referee);
+    }
+    j.launcher.class_data = archive;
+  }
+  j.games++;
+  j.queue.emplace_back(client_id, std::move(game));
+}
+
+void server::_cancel(job &j) {
+  j.queue.clear();
+  for (auto &[engine_id, client_id] : j.running) {
+    if (!_games.cancel(engine_id)) {
+      _owners.erase(engine_id);
+    }
+  }
+  j.running.clear();
+}
+
+void server::_cancel(job &j, game_id client_id) {
+  std::erase_if(j.queue,
+                [client_id](auto &game) { return game.first == client_id; });
+  auto it =
+      std::find_if(j.running.begin(), j.running.end(),
+                   [client_id](auto &g) { return g.second == client_id; });
+  if (it == j.running.end()) {
+    return;
+  }
+  if (!_games.cancel(it->first)) {
+    _owners.erase(it->first);
+  }
+  j.running.erase(it);
+}
+
+void server::_close(uint64_t id, job &j) {
+  _cancel(j);
+  j.closed = true;
+  native::close((int)j.socket);
+  if (j.started) {
+    std::cout << vt100::cyan << "Job " << id << vt100::reset << " done, "
+              << j.games << " games" << std::endl;
+  }
+}
+
+void server::_receive(uint64_t id, job &j) {
+  if (!j.input.receive(j.socket)) {
+    _close(id, j);
+    return;
+  }
+  while (auto message = j.input.next()) {
+    message_reader fields{message->second};
+    switch (message->first) {
+    case daemon_message::job:
+      _start(id, j, fields.string());
+      break;
+    case daemon_message::game:
+      if (j.started) {
+        _queue(j, fields);
+      }
+      break;
+    case daemon_message::cancel:
+      _cancel(j);
+      break;
+    case daemon_message::cancel_game:
+      _cancel(j, (game_id)fields.integer());
+      break;
+    default:
+      // Not a client
+      _close(id, j);
+      return;
+    }
+  }
+}
+
+// A free slot goes to the job with the fewest games in flight
+void server::_schedule() {
+  while ((int)(_games.in_flight() + _games.pending()) < _games.slot_count()) {
+    job *next = nullptr;
+    uint64_t next_id = 0;
+    for (auto &[id, j] : _jobs) {
+      if (j.closed || j.queue.empty()) {
+        continue;
+      }
+      if (next == nullptr || j.running.size() < next->running.size() ||
+          (j.running.size() == next->running.size() &&
+           j.served < next->served)) {
+        next = &j;
+        next_id = id;
+      }
+    }
+    if (next == nullptr) {
+      return;
+    }
+    auto [client_id, game] = std::move(next->queue.front());
+    next->queue.pop_front();
+    next->served = ++_launches;
+    const auto engine_id =
+        _games.submit(std::move(game), [this](game_id id, const game_t &,
+                                              run_result &result) {
+          auto &j = _jobs.at(_owners.at(id).first);
+          auto client_id = j.running.extract(id);
+          if (client_id.empty()) {
+            return;
+          }
+          _send(j, message_writer{daemon_message::result}
+                       .integer(client_id.mapped())
+                       .signed_integer(result.p1_score)
+                       .signed_integer(result.p2_score)
+                       .string(result.seed)
+                       .integer((uint64_t)result.duration.count()));
+        });
+    _owners[engine_id] = {next_id, client_id};
+    next->running[engine_id] = client_id;
+  }
+}
+
+void server::run() {
+  std::cout << "Listening on " << _path.string() << ", "
+            << _games.slot_count() << " slots" << std::endl;
+  for (;;) {
+    std::vector<dpsg::posix::pollfd> fds;
+    fds.emplace_back((fd_t)_listener, poll_event_t::read_ready);
+    std::vector<uint64_t> polled;
+    for (auto &[id, j] : _jobs) {
+      if (!j.closed) {
+        fds.emplace_back(j.socket, j.output.empty()
+                                       ? poll_event_t::read_ready
+                                       : poll_event_t::read_ready |
+                                             poll_event_t::write_ready);
+        polled.push_back(id);
+      }
+    }
+    for (auto fd : _games.descriptors()) {
+      fds.emplace_back(fd, poll_event_t::read_ready);
+    }
+
+    // The engine only notices that referees exited when polled
+    const auto timeout =
+        _owners.empty() ? std::chrono::milliseconds(-1) : reap_interval;
+    auto r = ::dpsg::posix::poll(std::span{fds}, timeout);
+    if (r.is_error() && r.error() != poll_error::interrupted &&
+        r.error() != poll_error::again) {
+      perror("Poll failed");
+      exit(1);
+    }
+    if (r.is_value()) {
+      if (fds[0].revents != 0) {
+        _accept();
+      }
+      for (size_t i = 0; i < polled.size(); ++i) {
+        auto &j = _jobs.at(polled[i]);
+        if ((fds[i + 1].revents & POLLOUT) != 0) {
+          _flush(j);
+        }
+        if ((fds[i + 1].revents & ~POLLOUT) != 0) {
+          _receive(polled[i], j);
+        }
+      }
+    }
+
+    // Finished games free slots for the next ones
+    do {
+      _schedule();
+    } while (_games.poll(std::chrono::milliseconds(0)) > 0);
+
+    std::erase_if(_jobs, [](auto &j) {
+      return j.second.closed && j.second.unfinished == 0;
+    });
+  }
+}
+} // namespace
+
+int run_daemon(int argc, const char **argv) {
+  auto opts = parse_options(argc, argv);
+  if (!opts.arguments.empty()) {
+    std::cerr << "Expected option, got '" << opts.arguments[0] << "'"
+              << std::endl;
+    return 1;
+  }
+  if (opts.parallel_processes <= 0) {
+    std::cerr << "-p must be > 0" << std::endl;
+    return 1;
+  }
+  if (opts.measure_latency || !opts.record.empty() || !opts.profile.empty()) {
+    std::cerr << "-L, --record and --profile are options of the clients"
+              << std::endl;
+    return 1;
+  }
+  // Clients going away mid-message shouldn't take the daemon with them
+  ::signal(SIGPIPE, SIG_IGN);
+
+  server s{opts,
+           opts.socket.empty() ? default_daemon_socket()
+                               : fs::path{opts.socket},
+           opts.socket.empty()};
+  s.run();
+  return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef HEADER_GUARD_DPSG_DAEMON_HPP
+#define HEADER_GUARD_DPSG_DAEMON_HPP
+
+// `runner daemon [-p <slots>] [--socket <path>] [limits, JVM options]`
+//
+// One process owning the game slots of the machine, for several people (or
+// runs) sharing it: `runner --daemon ...` sends its games to the daemon
+// instead of playing them itself (see remote_engine.hpp). Each client is a
+// job, and a freed slot goes to the job with the fewest games running, the
+// one served least recently on ties: with N jobs, each gets about 1/N of the
+// slots whatever it submitted.
+//
+// The games are started in the directory of their client, with the
+// environment of the daemon. What is worth keeping warm between jobs stays
+// in the daemon: the class data archive of each referee, the cgroup
+// hierarchy. Resource limits (--memory-max...) and JVM options are those of
+// the daemon.
+int run_daemon(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_DAEMON_HPP
@@ -0,0 +1,105 @@
+#include "daemon_protocol.hpp"
+#include "varint.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+
+using namespace dpsg::posix;
+
+message_writer::message_writer(daemon_message type) {
+  _fields.push_back((char)type);
+}
+
+message_writer &message_writer::integer(uint64_t x) {
+  dpsg::put_varint(_fields, x);
+  return *this;
+}
+
+message_writer &message_writer::signed_integer(int64_t x) {
+  return integer(((uint64_t)x << 1) ^ (uint64_t)(x >> 63));
+}
+
+message_writer &message_writer::string(std::string_view s) {
+  integer(s.size());
+  _fields.append(s);
+  return *this;
+}
+
+void message_writer::append_to(std::string &out) const {
+  dpsg::put_varint(out, _fields.size());
+  out += _fields;
+}
+
+bool message_writer::send(fd_t socket) const {
+  std::string message;
+  append_to(message);
+  std::string_view data = message;
+  while (!data.empty()) {
+    auto w =
+        native::send((int)socket, data.data(), data.size(), MSG_NOSIGNAL);
+    if (w == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data.remove_prefix((size_t)w);
+  }
+  return true;
+}
+
+uint64_t message_reader::integer() {
+  return dpsg::get_varint(_fields).value_or(0);
+}
+
+int64_t message_reader::signed_integer() {
+  const auto x = integer();
+  return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+}
+
+std::string_view message_reader::string() {
+  const auto size = std::min<uint64_t>(integer(), _fields.size());
+  const auto s = _fields.substr(0, size);
+  _fields.remove_prefix(size);
+  return s;
+}
+
+bool message_stream::receive(fd_t socket) {
+  char buffer[4096];
+  for (;;) {
+    auto r = read(socket, buffer);
+    if (r.is_error() && errno == EINTR) {
+      continue;
+    }
+    if (r.is_error() && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    }
+    if (r.is_error() || r.value() == 0) {
+      return false;
+    }
+    _buffer.append(buffer, r.value());
+    return true;
+  }
+}
+
+std::optional<std::pair<daemon_message, std::string>> message_stream::next() {
+  std::string_view data = _buffer;
+  auto size = dpsg::get_varint(data);
+  if (!size || *size > data.size() || *size == 0) {
+    return std::nullopt;
+  }
+  std::pair message{(daemon_message)data[0],
+                    std::string{data.substr(1, *size - 1)}};
+  _buffer.erase(0, _buffer.size() - data.size() + *size);
+  return message;
+}
+
+std::filesystem::path default_daemon_socket() {
+  if (const char *runtime = std::getenv("XDG_RUNTIME_DIR");
+      runtime != nullptr && *runtime != '\0') {
+    return std::filesystem::path{runtime} / "cg-runner.sock";
+  }
+  return std::filesystem::path{"/tmp/cg-runner-" +
+                               std::to_string(native::getuid())} /
+         "daemon.sock";
+}
@@ -0,0 +1,84 @@
+#ifndef HEADER_GUARD_DPSG_DAEMON_PROTOCOL_HPP
+#define HEADER_GUARD_DPSG_DAEMON_PROTOCOL_HPP
+
+#include "posix.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Messages between `runner daemon` (see daemon.hpp) and its clients, over a
+// unix socket. A message is its size, its type and its fields: integers as
+// LEB128 varints (zigzag encoded when signed), strings as their size followed
+// by their bytes.
+enum class daemon_message : uint8_t {
+  // Client, once connected: working directory of the games
+  job = 1,
+  // Client: id, player 1, player 2, referee, seed, output file
+  game,
+  // Client: drops the games not launched yet and kills the others
+  cancel,
+  // Daemon, answering `job`: slot count
+  welcome,
+  // Daemon: id
+  launched,
+  // Daemon: id, scores of player 1 and 2, seed, duration in nanoseconds
+  result,
+  // Daemon: id, CPU time in microseconds, memory peak in bytes
+  exited,
+  // Client: id, cancels that game alone
+  cancel_game,
+};
+
+class message_writer {
+public:
+  explicit message_writer(daemon_message type);
+
+  message_writer &integer(uint64_t x);
+  message_writer &signed_integer(int64_t x);
+  message_writer &string(std::string_view s);
+
+  // False when the connection is lost, which doesn't raise SIGPIPE
+  bool send(dpsg::posix::fd_t socket) const;
+  // Appends the message as sent, for sockets written without blocking
+  void append_to(std::string &out) const;
+
+private:
+  std::string _fields;
+};
+
+// Fields of a received message, in the order they were written. Missing
+// fields read as 0 or empty.
+class message_reader {
+public:
+  explicit message_reader(std::string_view fields) : _fields(fields) {}
+
+  uint64_t integer();
+  int64_t signed_integer();
+  std::string_view string();
+
+private:
+  std::string_view _fields;
+};
+
+// Splits what is read from a socket into messages
+class message_stream {
+public:
+  // Reads what is available, false once the connection is closed. Nothing
+  // available on a non-blocking socket isn't an error.
+  bool receive(dpsg::posix::fd_t socket);
+  // Type and fields of the next complete message
+  std::optional<std::pair<daemon_message, std::string>> next();
+
+private:
+  std::string _buffer;
+};
+
+// $XDG_RUNTIME_DIR/cg-runner.sock, or /tmp/cg-runner-<uid>/daemon.sock, in a
+// directory only its user can enter
+std::filesystem::path default_daemon_socket();
+
+#endif // HEADER_GUARD_DPSG_DAEMON_PROTOCOL_HPP
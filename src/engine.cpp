@@ -0,0 +1,235 @@
+#include "engine.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <istream>
+#include <mutex>
+
+using namespace dpsg::posix;
+
+namespace {
+// Beyond that many games in flight, the others aren't killed on interruption
+constexpr size_t tracked_capacity = 4096;
+std::atomic<int> tracked_games[tracked_capacity];
+std::once_flag interruption_handled;
+
+void kill_tracked_games(int signal) {
+  for (auto &pid : tracked_games) {
+    const int p = pid.load(std::memory_order_relaxed);
+    if (p > 0) {
+      kill_game((dpsg::posix::pid_t)p);
+    }
+  }
+  ::signal(signal, SIG_DFL);
+  native::raise(signal);
+}
+
+void handle_interruption() {
+  for (int signal : {SIGINT, SIGTERM, SIGHUP}) {
+    struct sigaction current {};
+    native::sigaction(signal, nullptr, &current);
+    if (current.sa_handler != SIG_DFL) {
+      continue;
+    }
+    struct sigaction action {};
+    action.sa_handler = kill_tracked_games;
+    native::sigaction(signal, &action, nullptr);
+  }
+}
+} // namespace
+
+void kill_game(dpsg::posix::pid_t pid) {
+  if (native::kill(-(int)pid, SIGKILL) == -1) {
+    native::kill((int)pid, SIGKILL);
+  }
+}
+
+void track_game(dpsg::posix::pid_t pid) {
+  std::call_once(interruption_handled, handle_interruption);
+  for (auto &slot : tracked_games) {
+    int empty = 0;
+    if (slot.compare_exchange_strong(empty, (int)pid,
+                                     std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+void untrack_game(dpsg::posix::pid_t pid) {
+  for (auto &slot : tracked_games) {
+    int expected = (int)pid;
+    if (slot.compare_exchange_strong(expected, 0,
+                                     std::memory_order_relaxed)) {
+      return;
+    }
+  }
+}
+
+void parse_result(fd_t referee_output, run_result &result) {
+  std::string seed;
+
+  fd_streambuf buf{referee_output};
+  std::istream out{&buf};
+  out >> result.p1_score >> result.p2_score >> seed;
+
+  auto eq = seed.find('=');
+  result.seed = std::string_view{seed}.substr(eq + 1);
+}
+
+engine::engine(int slot_count, launcher launch)
+    : _slot_count(slot_count), _launch(std::move(launch)) {
+  _active.reserve(slot_count);
+}
+
+engine::~engine() {
+  for (auto &s : _active) {
+    native::close((int)s.process.stdout);
+    native::close((int)s.process.stdin);
+    native::close((int)s.process.stderr);
+  }
+}
+
+game_id engine::submit(game_t game, callback on_done) {
+  auto id = _next_id++;
+  _pending.push_back({id, std::move(game), std::move(on_done)});
+  return id;
+}
+
+std::vector<fd_t> engine::descriptors() const {
+  std::vector<fd_t> fds;
+  fds.reserve(_active.size());
+  for (auto &s : _active) {
+    fds.push_back(s.process.stdout);
+  }
+  return fds;
+}
+
+void engine::_fill_slots() {
+  while ((int)_active.size() < _slot_count && !_pending.empty()) {
+    auto &g = _pending.front();
+    auto started = monotonic_now();
+    auto process = _launch(g.game, g.id);
+    track_game(process.pid);
+    if (_on_launch) {
+      _on_launch(g.id, g.game);
+    }
+    _active.push_back({std::move(g), process, started});
+    _pending.pop_front();
+  }
+}
+
+void engine::_reap(int options) {
+  std::erase_if(_exiting, [this, options](auto &exiting) {
+    int status;
+    struct rusage usage {};
+    if (native::wait4((int)exiting.first, &status, options, &usage) == 0) {
+      return false;
+    }
+    untrack_game(exiting.first);
+    if (_on_exit) {
+      _on_exit(exiting.second, usage);
+    }
+    return true;
+  });
+}
+
+size_t engine::poll(std::chrono::milliseconds timeout) {
+  _fill_slots();
+  _reap();
+  if (_active.empty()) {
+    return 0;
+  }
+
+  std::vector<dpsg::posix::pollfd> pollfds;
+  pollfds.reserve(_active.size());
+  for (auto &s : _active) {
+    pollfds.emplace_back(s.process.stdout, poll_event_t::read_ready);
+  }
+
+  auto r = ::dpsg::posix::poll(std::span{pollfds}, timeout);
+  if (r.is_error()) {
+    auto e = r.error();
+    if (e == poll_error::interrupted || e == poll_error::again) {
+      return 0;
+    }
+    perror("Poll failed");
+    exit(1);
+  }
+
+  // Finished games leave their slot before their callback runs, so that
+  // callbacks are free to submit new games
+  std::vector<std::pair<pending_game, run_result>> finished;
+  for (size_t idx = pollfds.size(); idx-- > 0;) {
+    if (pollfds[idx].revents == 0) {
+      continue;
+    }
+    auto &s = _active[idx];
+    run_result result{};
+    result.output_file = s.game.game.output_file;
+    parse_result(s.process.stdout, result);
+    result.duration = monotonic_now() - s.started;
+    aggregate(result, _statistics);
+
+    native::close((int)s.process.stdout);
+    native::close((int)s.process.stdin);
+    native::close((int)s.process.stderr);
+    _exiting.emplace_back(s.process.pid, s.game.id);
+
+    finished.emplace_back(std::move(s.game), std::move(result));
+    _active.erase(_active.begin() + idx);
+  }
+
+  // Report in launch order
+  for (auto it = finished.rbegin(); it != finished.rend(); ++it) {
+    if (it->first.on_done) {
+      it->first.on_done(it->first.id, it->first.game, it->second);
+    }
+  }
+
+  _fill_slots();
+  _reap();
+  return finished.size();
+}
+
+void engine::run() {
+  while (!idle()) {
+    poll();
+  }
+  _reap(0);
+}
+
+void engine::cancel() {
+  _pending.clear();
+  for (auto &s : _active) {
+    kill_game(s.process.pid);
+    native::close((int)s.process.stdout);
+    native::close((int)s.process.stdin);
+    native::close((int)s.process.stderr);
+    _exiting.emplace_back(s.process.pid, s.game.id);
+  }
+  _active.clear();
+}
+
+void engine::game_awaiter::await_suspend(std::coroutine_handle<> h) {
+  owner.submit(std::move(game),
+               [this, h](game_id, const game_t &, run_result &r) {
+                 result = std::move(r);
+                 h.resume();
+               });
+}
+
+bool engine::cancel(game_id id) {
+  std::erase_if(_pending, [id](auto &g) { return g.id == id; });
+  auto it = std::find_if(_active.begin(), _active.end(),
+                         [id](auto &s) { return s.game.id == id; });
+  if (it == _active.end()) {
+    return false;
+  }
+  kill_game(it->process.pid);
+  native::close((int)it->process.stdout);
+  native::close((int)it->process.stdin);
+  native::close((int)it->process.stderr);
+  _exiting.emplace_back(it->process.pid, id);
+  _active.erase(it);
+  return true;
+}
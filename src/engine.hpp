@@ -0,0 +1,164 @@
+#ifndef HEADER_GUARD_DPSG_ENGINE_HPP
+#define HEADER_GUARD_DPSG_ENGINE_HPP
+
+#include "posix.hpp"
+#include "statistics.hpp"
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+using game_id = uint32_t;
+
+// Description of a game to play.
+struct game_t {
+  std::string player1;
+  std::string player2;
+  std::string referee;
+  // Empty to let the referee pick one
+  std::string seed = "";
+  // Empty to disable the game log
+  std::string output_file = "";
+};
+
+// Runs games in child processes, at most `slot_count` at a time.
+//
+// The engine doesn't own a thread: callers submit games, then drive it by
+// calling `poll` (or `run`), which launches pending games into free slots and
+// invokes the completion callbacks of finished ones. Callbacks may submit new
+// games.
+//
+//   engine e{4, make_runner(opts)};
+//   e.submit(game, [](game_id id, const game_t &g, run_result &r) { ... });
+//   e.run();
+class engine {
+public:
+  using callback = std::function<void(game_id, const game_t &, run_result &)>;
+  // Starts the referee of a game and returns its process. Its standard output
+  // must eventually provide "<p1 score> <p2 score> seed=<seed>".
+  using launcher = std::function<dpsg::posix::process_t(const game_t &, game_id)>;
+
+  engine(int slot_count, launcher launch);
+  engine(const engine &) = delete;
+  engine &operator=(const engine &) = delete;
+  ~engine();
+
+  game_id submit(game_t game, callback on_done);
+
+  // Called whenever a game is handed to a slot.
+  void on_launch(std::function<void(game_id, const game_t &)> f) {
+    _on_launch = std::move(f);
+  }
+
+  // Called once the referee of a finished game has exited, with its resource
+  // usage (which includes the players it waited for).
+  void on_exit(std::function<void(game_id, const struct rusage &)> f) {
+    _on_exit = std::move(f);
+  }
+
+  // Launches what can be launched and waits up to `timeout` for games to
+  // finish. Returns the number of games that completed.
+  size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+  // Polls until every submitted game has completed.
+  void run();
+
+  // Kills the referees of the games in flight and drops the pending games,
+  // without calling their completion callbacks. The killed referees still go
+  // through `on_exit`.
+  void cancel();
+  // Same for game `id` alone. Returns whether it was in flight, and will go
+  // through `on_exit`.
+  bool cancel(game_id id);
+
+  size_t pending() const { return _pending.size(); }
+  size_t in_flight() const { return _active.size(); }
+  bool idle() const { return _pending.empty() && _active.empty(); }
+  int slot_count() const { return _slot_count; }
+
+  // Results of the games completed so far.
+  const statistics_t &statistics() const { return _statistics; }
+  void reset_statistics() { _statistics = {}; }
+
+  // File descriptors that become readable when a game in flight finishes, for
+  // callers integrating the engine in their own event loop.
+  std::vector<dpsg::posix::fd_t> descriptors() const;
+
+  // Awaitable playing a game, for use in coroutines. The coroutine resumes
+  // from inside `poll`.
+  //
+  //   detached_task evaluate(engine &e, game_t g) {
+  //     run_result r = co_await e.play(std::move(g));
+  //     ...
+  //   }
+  struct game_awaiter {
+    engine &owner;
+    game_t game;
+    run_result result{};
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h);
+    run_result await_resume() { return std::move(result); }
+  };
+  game_awaiter play(game_t game) { return game_awaiter{*this, std::move(game)}; }
+
+private:
+  struct pending_game {
+    game_id id;
+    game_t game;
+    callback on_done;
+  };
+  struct slot {
+    pending_game game;
+    dpsg::posix::process_t process;
+    std::chrono::nanoseconds started;
+  };
+
+  void _fill_slots();
+  void _reap(int options = WNOHANG);
+
+  int _slot_count;
+  launcher _launch;
+  std::function<void(game_id, const game_t &)> _on_launch;
+  std::function<void(game_id, const struct rusage &)> _on_exit;
+  game_id _next_id = 0;
+  std::deque<pending_game> _pending;
+  std::vector<slot> _active;
+  statistics_t _statistics;
+  // Referees that reported their result but haven't exited yet
+  std::vector<std::pair<dpsg::posix::pid_t, game_id>> _exiting;
+};
+
+// Reads the result printed by a referee on its standard output.
+void parse_result(dpsg::posix::fd_t referee_output, run_result &result);
+
+// Games run in a process group of their own (see runner.hpp), which the bots
+// started by the referee join, so that a cancelled game is killed whole: the
+// referee alone would leave its bots running, often spinning on a closed
+// stdin. Kills the group led by `pid`, or `pid` alone when it leads none
+// (not yet, or started by another launcher). Async-signal-safe.
+void kill_game(dpsg::posix::pid_t pid);
+
+// The process groups of the games don't get the signals of the terminal:
+// those of the games in flight are tracked by the engines and killed when the
+// program is interrupted (SIGINT, SIGTERM, SIGHUP), unless it handles these
+// signals itself.
+void track_game(dpsg::posix::pid_t pid);
+void untrack_game(dpsg::posix::pid_t pid);
+
+// Minimal coroutine type for fire-and-forget coroutines awaiting games.
+struct detached_task {
+  struct promise_type {
+    detached_task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+#endif // HEADER_GUARD_DPSG_ENGINE_HPP
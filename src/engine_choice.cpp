@@ -0,0 +1,30 @@
+#include "engine_choice.hpp"
+
+#include <iostream>
+
+bool check_engine_options(option_t &opts) {
+  if (!opts.daemon) {
+    return true;
+  }
+  if (opts.measure_latency || !opts.record.empty() || !opts.profile.empty() ||
+      referee_plugin::is_plugin(opts.referee)) {
+    std::cerr << "-L, --record, --profile and referee plugins can't be used "
+                 "with --daemon"
+              << std::endl;
+    return false;
+  }
+  if (opts.memory_max > 0 || opts.cpu_max > 0 || opts.pids_max > 0) {
+    std::cerr << "With --daemon, the resource limits are those of the daemon"
+              << std::endl;
+    return false;
+  }
+  if (!opts.preload.empty()) {
+    std::cerr << "With --daemon, the players get the files preloaded by the "
+                 "daemon"
+              << std::endl;
+    return false;
+  }
+  // The daemon keeps the archive of the referee
+  opts.class_data_sharing = false;
+  return true;
+}
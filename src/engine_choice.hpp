@@ -0,0 +1,45 @@
+#ifndef HEADER_GUARD_DPSG_ENGINE_CHOICE_HPP
+#define HEADER_GUARD_DPSG_ENGINE_CHOICE_HPP
+
+#include "daemon_protocol.hpp"
+#include "engine.hpp"
+#include "options.hpp"
+#include "parallel_engine.hpp"
+#include "plugin_engine.hpp"
+#include "remote_engine.hpp"
+#include "runner.hpp"
+
+#include <functional>
+#include <string>
+
+// False, with a message on stderr, when options can't be used with the engine
+// the others ask for (--daemon). Must be called before making the runner.
+bool check_engine_options(option_t &opts);
+
+// Calls `play(games)` with the engine the options ask for: the daemon's
+// (--daemon), the referee plugin's (a .so referee), else a single thread
+// launching the games or --io-threads of them.
+template <class F>
+void with_engine(const option_t &opts, runner &runner, F &&play) {
+  if (opts.daemon) {
+    remote_engine games{opts.socket.empty() ? default_daemon_socket()
+                                            : opts.socket};
+    play(games);
+  } else if (referee_plugin::is_plugin(opts.referee)) {
+    referee_plugin referee{std::string{opts.referee}};
+    plugin_engine games{opts.parallel_processes, referee,
+                        [&runner](const game_t &g, game_id id, int player) {
+                          return runner.spawn_player(g, id, player);
+                        }};
+    play(games);
+  } else if (opts.io_threads == 1) {
+    engine games{opts.parallel_processes, std::cref(runner)};
+    play(games);
+  } else {
+    parallel_engine games{opts.parallel_processes,
+                          (unsigned)opts.io_threads, std::cref(runner)};
+    play(games);
+  }
+}
+
+#endif // HEADER_GUARD_DPSG_ENGINE_CHOICE_HPP
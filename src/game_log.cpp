@@ -0,0 +1,395 @@
+#include "game_log.hpp"
+#include "options.hpp"
+#include "posix.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <span>
+#include <thread>
+
+namespace {
+
+// Position of a value in the document: key in the enclosing object, or index
+// in the enclosing array (key empty).
+struct path_element {
+  std::string_view key;
+  int index;
+};
+using json_path = std::span<const path_element>;
+
+// Single pass, callback based JSON parser. Strings are handed out raw, escape
+// sequences included. The handler provides:
+//   void on_string(json_path, std::string_view raw);
+//   void on_array_end(json_path, int element_count);
+template <class Handler> class json_scanner {
+  const char *_p;
+  const char *_end;
+  std::vector<path_element> _path;
+  Handler &_handler;
+
+  constexpr static int max_depth = 64;
+
+  void _skip_whitespace() {
+    while (_p < _end && (*_p == ' ' || *_p == '\n' || *_p == '\r' || *_p == '\t'))
+      ++_p;
+  }
+
+  bool _literal(std::string_view lit) {
+    if ((size_t)(_end - _p) < lit.size() || std::string_view{_p, lit.size()} != lit)
+      return false;
+    _p += lit.size();
+    return true;
+  }
+
+  bool _string(std::string_view &out) {
+    if (_p >= _end || *_p != '"')
+      return false;
+    const char *begin = ++_p;
+    while (_p < _end && *_p != '"') {
+      _p += *_p == '\\' ? 2 : 1;
+    }
+    if (_p >= _end)
+      return false;
+    out = {begin, (size_t)(_p - begin)};
+    ++_p;
+    return true;
+  }
+
+  bool _number() {
+    const char *begin = _p;
+    while (_p < _end && (std::isdigit((unsigned char)*_p) || *_p == '-' ||
+                         *_p == '+' || *_p == '.' || *_p == 'e' || *_p == 'E'))
+      ++_p;
+    return _p != begin;
+  }
+
+  bool _value() {
+    _skip_whitespace();
+    if (_p >= _end || _path.size() > max_depth)
+      return false;
+    switch (*_p) {
+    case '{': {
+      ++_p;
+      _skip_whitespace();
+      if (_p < _end && *_p == '}') {
+        ++_p;
+        return true;
+      }
+      while (true) {
+        _skip_whitespace();
+        std::string_view key;
+        if (!_string(key))
+          return false;
+        _skip_whitespace();
+        if (_p >= _end || *_p++ != ':')
+          return false;
+        _path.push_back({key, -1});
+        bool ok = _value();
+        _path.pop_back();
+        if (!ok)
+          return false;
+        _skip_whitespace();
+        if (_p >= _end)
+          return false;
+        if (*_p == '}') {
+          ++_p;
+          return true;
+        }
+        if (*_p++ != ',')
+          return false;
+      }
+    }
+    case '[': {
+      ++_p;
+      int count = 0;
+      _skip_whitespace();
+      if (_p < _end && *_p == ']') {
+        ++_p;
+        _handler.on_array_end(json_path{_path}, 0);
+        return true;
+      }
+      while (true) {
+        _path.push_back({{}, count});
+        bool ok = _value();
+        _path.pop_back();
+        if (!ok)
+          return false;
+        ++count;
+        _skip_whitespace();
+        if (_p >= _end)
+          return false;
+        if (*_p == ']') {
+          ++_p;
+          _handler.on_array_end(json_path{_path}, count);
+          return true;
+        }
+        if (*_p++ != ',')
+          return false;
+      }
+    }
+    case '"': {
+      std::string_view s;
+      if (!_string(s))
+        return false;
+      _handler.on_string(json_path{_path}, s);
+      return true;
+    }
+    case 't':
+      return _literal("true");
+    case 'f':
+      return _literal("false");
+    case 'n':
+      return _literal("null");
+    default:
+      return _number();
+    }
+  }
+
+public:
+  json_scanner(std::string_view text, Handler &handler)
+      : _p(text.data()), _end(text.data() + text.size()), _handler(handler) {
+    _path.reserve(16);
+  }
+
+  bool scan() {
+    if (!_value())
+      return false;
+    _skip_whitespace();
+    return _p == _end;
+  }
+};
+
+bool contains_nocase(std::string_view haystack, std::string_view needle) {
+  return std::search(haystack.begin(), haystack.end(), needle.begin(),
+                     needle.end(), [](char a, char b) {
+                       return std::tolower((unsigned char)a) == b;
+                     }) != haystack.end();
+}
+
+std::string clean_message(std::string_view raw) {
+  constexpr size_t max_length = 80;
+  std::string r;
+  for (size_t i = 0; i < raw.size() && r.size() < max_length; ++i) {
+    if (raw[i] == '\\' && i + 1 < raw.size()) {
+      ++i;
+      r += raw[i] == 'n' || raw[i] == 't' ? ' ' : raw[i];
+    } else {
+      r += raw[i];
+    }
+  }
+  while (!r.empty() && r.back() == ' ') {
+    r.pop_back();
+  }
+  return r;
+}
+
+// Fills game_metrics from the "summaries" (one entry per turn) and "views"
+// arrays of CodinGame referee logs. Referees report timeouts and
+// deactivations in the summary of the turn they happen, with $<n> standing
+// for player n.
+struct metrics_handler {
+  game_metrics &metrics;
+  int views = 0;
+
+  static bool is(json_path path, std::string_view key) {
+    return !path.empty() && path[0].key == key;
+  }
+
+  void on_string(json_path path, std::string_view raw) {
+    if (path.size() != 2 || !is(path, "summaries") || raw.empty()) {
+      return;
+    }
+    const int turn = path[1].index;
+    metrics.summarized_turns++;
+
+    for (int x = 0; x < 2; ++x) {
+      auto &fault = metrics.faults[x];
+      const char marker[] = {'$', (char)('0' + x), 0};
+      if (fault.kind != game_metrics::fault_kind::none ||
+          raw.find(marker) == std::string_view::npos) {
+        continue;
+      }
+      if (contains_nocase(raw, "timeout") || contains_nocase(raw, "timed out") ||
+          contains_nocase(raw, "in time")) {
+        fault.kind = game_metrics::fault_kind::timeout;
+      } else if (contains_nocase(raw, "deactivat") ||
+                 contains_nocase(raw, "invalid") ||
+                 contains_nocase(raw, "crash") ||
+                 contains_nocase(raw, "disqualif")) {
+        fault.kind = game_metrics::fault_kind::deactivated;
+      } else {
+        continue;
+      }
+      fault.turn = turn;
+      fault.message = clean_message(raw);
+    }
+  }
+
+  void on_array_end(json_path path, int count) {
+    if (path.size() != 1) {
+      return;
+    }
+    if (is(path, "summaries")) {
+      metrics.turns = count;
+    } else if (is(path, "views")) {
+      views = count;
+    }
+  }
+};
+
+} // namespace
+
+bool extract_metrics(std::string_view log, game_metrics &metrics) {
+  metrics = game_metrics{};
+  metrics_handler handler{metrics};
+  json_scanner scanner{log, handler};
+  if (!scanner.scan()) {
+    return false;
+  }
+  if (metrics.turns == 0) {
+    metrics.turns = handler.views;
+  }
+  return true;
+}
+
+void log_statistics::add(std::string_view log, const game_metrics &metrics) {
+  min_turns = logs == 0 ? metrics.turns : std::min(min_turns, metrics.turns);
+  max_turns = logs == 0 ? metrics.turns : std::max(max_turns, metrics.turns);
+  logs++;
+  turns += metrics.turns;
+  summarized_turns += metrics.summarized_turns;
+  for (int x = 0; x < 2; ++x) {
+    auto &f = metrics.faults[x];
+    if (f.kind == game_metrics::fault_kind::none) {
+      continue;
+    }
+    (f.kind == game_metrics::fault_kind::timeout ? timeouts : deactivations)[x]++;
+    fault_turns[x] += f.turn;
+    if (examples.size() < max_examples) {
+      examples.push_back({std::string{log}, x, f});
+    }
+  }
+}
+
+void log_statistics::merge(const log_statistics &other) {
+  if (other.logs > 0) {
+    min_turns = logs == 0 ? other.min_turns : std::min(min_turns, other.min_turns);
+    max_turns = logs == 0 ? other.max_turns : std::max(max_turns, other.max_turns);
+  }
+  logs += other.logs;
+  unreadable += other.unreadable;
+  turns += other.turns;
+  summarized_turns += other.summarized_turns;
+  for (int x = 0; x < 2; ++x) {
+    timeouts[x] += other.timeouts[x];
+    deactivations[x] += other.deactivations[x];
+    fault_turns[x] += other.fault_turns[x];
+  }
+  const size_t kept =
+      std::min(other.examples.size(), max_examples - examples.size());
+  examples.insert(examples.end(), other.examples.begin(),
+                  other.examples.begin() + (ptrdiff_t)kept);
+}
+
+void print_log_statistics(std::ostream &out, const log_statistics &stats) {
+  using namespace dpsg::vt100;
+  out << "Game logs: " << stats.logs << " analyzed";
+  if (stats.unreadable > 0) {
+    out << red << " (" << stats.unreadable << " unreadable)" << reset;
+  }
+  out << ", turns avg " << stats.average_turns() << " (min " << stats.min_turns
+      << ", max " << stats.max_turns << ")" << std::endl;
+
+  for (int x = 0; x < 2; ++x) {
+    const auto faults = stats.timeouts[x] + stats.deactivations[x];
+    if (faults == 0) {
+      continue;
+    }
+    out << (x == 0 ? yellow : cyan) << "Player " << (x + 1) << reset << ": "
+        << red << stats.timeouts[x] << " timeouts, " << stats.deactivations[x]
+        << " deactivations" << reset << " (avg turn "
+        << (double)stats.fault_turns[x] / (double)faults << ')' << std::endl;
+  }
+  for (auto &e : stats.examples) {
+    out << "  " << e.log << ": player " << (e.player + 1) << " turn "
+        << e.fault.turn << ": " << e.fault.message << std::endl;
+  }
+}
+
+void log_analyzer::submit(std::filesystem::path log) {
+  _pool.submit([this, log = std::move(log)] {
+    using namespace std::chrono_literals;
+    constexpr int attempts = 20;
+    constexpr auto retry_delay = 50ms;
+
+    game_metrics metrics;
+    bool ok = false;
+    for (int attempt = 0; attempt < attempts && !ok; ++attempt) {
+      if (attempt > 0) {
+        std::this_thread::sleep_for(retry_delay);
+      }
+      dpsg::posix::mapped_file file{log.c_str()};
+      ok = file.is_open() && extract_metrics(file.view(), metrics);
+    }
+
+    std::lock_guard lock{_mutex};
+    if (ok) {
+      _stats.add(log.string(), metrics);
+    } else {
+      _stats.unreadable++;
+    }
+  });
+}
+
+void log_analyzer::add(std::string_view log, const game_metrics *metrics) {
+  std::lock_guard lock{_mutex};
+  if (metrics != nullptr) {
+    _stats.add(log, *metrics);
+  } else {
+    _stats.unreadable++;
+  }
+}
+
+const log_statistics &log_analyzer::finish() {
+  _pool.wait();
+  return _stats;
+}
+
+int run_analyze(int argc, const char **argv) {
+  auto opts = parse_options(argc, argv);
+  if (opts.arguments.empty()) {
+    std::cerr << "Usage: runner analyze [-j threads] <logs...>" << std::endl;
+    return 1;
+  }
+  const auto &logs = opts.arguments;
+
+  // Each worker merges into its own statistics, the lock is only taken once
+  // per worker at the end
+  thread_pool pool{(unsigned)opts.threads};
+  std::mutex mutex;
+  log_statistics total;
+  const size_t chunk = (logs.size() + pool.size() - 1) / pool.size();
+  for (size_t begin = 0; begin < logs.size(); begin += chunk) {
+    size_t end = std::min(logs.size(), begin + chunk);
+    pool.submit([&, begin, end] {
+      log_statistics local;
+      for (size_t i = begin; i < end; ++i) {
+        dpsg::posix::mapped_file file{logs[i].data()};
+        game_metrics metrics;
+        if (file.is_open() && extract_metrics(file.view(), metrics)) {
+          local.add(logs[i], metrics);
+        } else {
+          local.unreadable++;
+        }
+      }
+      std::lock_guard lock{mutex};
+      total.merge(local);
+    });
+  }
+  pool.wait();
+
+  print_log_statistics(std::cout, total);
+  return total.unreadable == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#ifndef HEADER_GUARD_DPSG_GAME_LOG_HPP
+#define HEADER_GUARD_DPSG_GAME_LOG_HPP
+
+#include "thread_pool.hpp"
+
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Figures extracted from the JSON log written by a referee (-l).
+struct game_metrics {
+  enum class fault_kind {
+    none = 0,
+    timeout,
+    // Crash, invalid output, or any other reason for the referee to
+    // deactivate the player
+    deactivated,
+  };
+  struct fault {
+    fault_kind kind = fault_kind::none;
+    int turn = -1;
+    std::string message;
+  };
+
+  int turns = 0;
+  // Turns with a non-empty game summary
+  int summarized_turns = 0;
+  fault faults[2];
+};
+
+// Extracts the metrics of a log, in a single pass and without building a
+// document tree. Returns false if the log is not valid JSON, which happens
+// when reading a log that is still being written.
+bool extract_metrics(std::string_view log, game_metrics &metrics);
+
+// Aggregated metrics of many logs.
+struct log_statistics {
+  size_t logs = 0;
+  size_t unreadable = 0;
+  size_t turns = 0;
+  int min_turns = 0;
+  int max_turns = 0;
+  size_t summarized_turns = 0;
+  size_t timeouts[2] = {0, 0};
+  size_t deactivations[2] = {0, 0};
+  // Sum of the turns at which faults happened, for averages
+  size_t fault_turns[2] = {0, 0};
+  // A few examples of faults: (log, turn, message)
+  constexpr static inline size_t max_examples = 10;
+  struct example {
+    std::string log;
+    int player;
+    game_metrics::fault fault;
+  };
+  std::vector<example> examples;
+
+  void add(std::string_view log, const game_metrics &metrics);
+  void merge(const log_statistics &other);
+
+  double average_turns() const {
+    return logs == 0 ? 0 : (double)turns / (double)logs;
+  }
+};
+
+void print_log_statistics(std::ostream &out, const log_statistics &stats);
+
+// Parses logs on a thread pool as they are handed over, merging their metrics
+// into `stats()`.
+class log_analyzer {
+public:
+  explicit log_analyzer(unsigned thread_count = 0) : _pool(thread_count) {}
+
+  // The log may still be being written by the referee: parsing is retried a
+  // few times before giving up.
+  void submit(std::filesystem::path log);
+
+  // Adds metrics extracted elsewhere, null for an unreadable log. Thread-safe.
+  void add(std::string_view log, const game_metrics *metrics);
+
+  // Waits for every submitted log to be processed.
+  const log_statistics &finish();
+
+  const log_statistics &stats() const { return _stats; }
+
+private:
+  std::mutex _mutex;
+  log_statistics _stats;
+  thread_pool _pool;
+};
+
+// Entry point of `runner analyze <logs...>`, argv[0] being "analyze".
+int run_analyze(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_GAME_LOG_HPP
@@ -0,0 +1,18 @@
+#ifndef HEADER_GUARD_DPSG_HASH_HPP
+#define HEADER_GUARD_DPSG_HASH_HPP
+
+#include <cstdint>
+#include <string_view>
+
+namespace dpsg {
+// 64 bits FNV-1a, for cache keys that must stay the same across runs
+inline uint64_t fnv1a(std::string_view data,
+                      uint64_t hash = 0xcbf29ce484222325) {
+  for (unsigned char c : data) {
+    hash = (hash ^ c) * 0x100000001b3;
+  }
+  return hash;
+}
+} // namespace dpsg
+
+#endif // HEADER_GUARD_DPSG_HASH_HPP
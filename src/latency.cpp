@@ -0,0 +1,61 @@
+#include "latency.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+bool latency_statistics::add(int x, const std::filesystem::path &latency_file) {
+  std::ifstream in{latency_file, std::ios::binary};
+  if (!in) {
+    return false;
+  }
+
+  uint32_t sample;
+  bool first = true;
+  while (in.read(reinterpret_cast<char *>(&sample), sizeof(sample))) {
+    if (first) {
+      first_turn[x].push_back(sample);
+      first = false;
+    } else {
+      turns[x].push_back(sample);
+    }
+  }
+  return true;
+}
+
+latency_statistics::percentiles
+latency_statistics::compute(std::vector<uint32_t> samples) {
+  percentiles r{.count = samples.size()};
+  if (samples.empty()) {
+    return r;
+  }
+
+  const auto nth = [&](double q) {
+    auto idx = (size_t)(q * (double)(samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return samples[idx];
+  };
+  r.p50 = nth(0.5);
+  r.p99 = nth(0.99);
+  r.max = *std::max_element(samples.begin(), samples.end());
+  return r;
+}
+
+std::filesystem::path latency_file(const std::filesystem::path &directory,
+                                   int run_count, int player) {
+  return directory /
+         (std::to_string(run_count) + '-' + std::to_string(player + 1) + ".lat");
+}
+
+void latency_collector::collect(int run_count) {
+  for (int player = 0; player < 2; ++player) {
+    auto path = latency_file(_directory, run_count, player);
+    if (stats.add(player, path)) {
+      std::filesystem::remove(path);
+    }
+  }
+}
+
+void latency_collector::cleanup() {
+  std::error_code ignored;
+  std::filesystem::remove_all(_directory, ignored);
+}
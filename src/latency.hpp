@@ -0,0 +1,55 @@
+#ifndef HEADER_GUARD_DPSG_LATENCY_HPP
+#define HEADER_GUARD_DPSG_LATENCY_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+// Per-turn response times of both players, in microseconds, as reported by
+// the proxies standing between the referee and the bots (see proxy.hpp).
+struct latency_statistics {
+  struct percentiles {
+    uint32_t p50 = 0;
+    uint32_t p99 = 0;
+    uint32_t max = 0;
+    size_t count = 0;
+  };
+
+  std::vector<uint32_t> first_turn[2];
+  std::vector<uint32_t> turns[2];
+
+  // Adds the content of a latency file to the statistics of player `x`.
+  // Returns false if the file doesn't exist.
+  bool add(int x, const std::filesystem::path &latency_file);
+
+  static percentiles compute(std::vector<uint32_t> samples);
+
+  bool empty() const {
+    return first_turn[0].empty() && first_turn[1].empty();
+  }
+};
+
+// Path of the file in which the proxy of `player` (0 or 1) writes the response
+// times of the game `run_count`.
+std::filesystem::path latency_file(const std::filesystem::path &directory,
+                                   int run_count, int player);
+
+// Feeds the latency files written by the proxies into `latency_statistics`.
+class latency_collector {
+  std::filesystem::path _directory;
+
+public:
+  latency_statistics stats;
+
+  explicit latency_collector(std::filesystem::path directory)
+      : _directory(std::move(directory)) {}
+
+  // Must be called once the referee has reported the result of the game: by
+  // then the proxies have measured every turn.
+  void collect(int run_count);
+
+  // Removes the temporary directory holding the latency files.
+  void cleanup();
+};
+
+#endif // HEADER_GUARD_DPSG_LATENCY_HPP
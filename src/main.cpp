@@ -1,63 +1,111 @@
+#include "ab.hpp"
+#include "bisect.hpp"
+#include "bootstrap.hpp"
 #include "cli.hpp"
+#include "daemon.hpp"
+#include "engine.hpp"
+#include "engine_choice.hpp"
+#include "game_log.hpp"
+#include "latency.hpp"
 #include "options.hpp"
-#include "posix.hpp"
 #include "presentation.hpp"
+#include "proxy.hpp"
+#include "race.hpp"
+#include "replay.hpp"
+#include "result_store.hpp"
+#include "run_driver.hpp"
 #include "runner.hpp"
+#include "schedule.hpp"
+#include "scratch_logs.hpp"
+#include "shard.hpp"
+#include "simulation.hpp"
 #include "statistics.hpp"
+#include "thread_pool.hpp"
+#include "throughput.hpp"
+#include "tuning.hpp"
 #include "vt100.hpp"
+#include "watch.hpp"
 
 #include <chrono>
+#include <fstream>
+#include <limits>
+#include <optional>
 
-template <class F>
-dpsg::posix::poll_error
-poll_one_each(const std::span<dpsg::posix::process_t> &ps,
-              dpsg::posix::poll_event_t ev, F &&func) {
-
-  using namespace dpsg;
-  using namespace dpsg::posix;
-  std::vector<pollfd> pollfds;
-  pollfds.reserve(ps.size());
-  for (auto proc : ps) {
-    pollfds.emplace_back(proc.stdout, ev);
-  }
-  auto s = ps.size();
-  size_t n = 0;
-  while (n < s) {
-    auto r = poll(std::span{pollfds});
-    if (r.is_error()) {
-      auto e = r.error();
-      if (e == poll_error::interrupted || e == poll_error::again) {
-        continue;
-      }
-      return e;
-    }
-
-    for (size_t idx = 0; idx < pollfds.size(); ++idx) {
-      if (pollfds[idx].revents == 0)
-        continue;
-      n++;
-      pollfds[idx].invalidate();
-      if constexpr (std::is_invocable_v<F, process_t &, size_t>) {
-        func(ps[idx], idx);
-      } else {
-        func(ps[idx]);
-      }
-    }
-  }
-
-  return poll_error::success;
-}
+// How often a run checks for changes of the players with --watch
+constexpr std::chrono::milliseconds watch_interval{100};
 
 int main(int argc, const char **argv) {
   using namespace dpsg::vt100;
   using namespace dpsg;
+  if (argc > 1 && std::string_view{argv[1]} == "proxy") {
+    return run_proxy(argc - 2, argv + 2);
+  }
+  // Subcommands parse their options themselves, their name taking the place
+  // of the program name
+  if (argc > 1 && std::string_view{argv[1]} == "tune") {
+    return run_tuning(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string_view{argv[1]} == "bisect") {
+    return run_bisect(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string_view{argv[1]} == "ab") {
+    return run_ab(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string_view{argv[1]} == "race") {
+    return run_race(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string_view{argv[1]} == "analyze") {
+    return run_analyze(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string_view{argv[1]} == "replay") {
+    return run_replay(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string_view{argv[1]} == "merge") {
+    return run_merge(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string_view{argv[1]} == "simulate") {
+    return run_simulation(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string_view{argv[1]} == "daemon") {
+    return run_daemon(argc - 1, argv + 1);
+  }
   auto opts = parse_options(argc, argv);
 
+  if (!opts.arguments.empty()) {
+    std::cerr << "Expected option, got '" << opts.arguments[0] << "'"
+              << std::endl;
+    exit(1);
+  }
   if (opts.process_count <= 0) {
     std::cerr << "-c must be > 0" << std::endl;
     exit(1);
   }
-  if (opts.process_count >= 1000) {
+  // --shard: the run plays its share of the -c games, on seeds of its own
+  std::vector<std::string> seeds;
+  if (!opts.seed_file.empty()) {
+    seeds = read_seed_file(opts.seed_file);
+  }
+  const int run_games = opts.process_count;
+  if (opts.shard_count > 0) {
+    seeds = shard_seeds(seeds, opts.process_count, opts.shard_index,
+                        opts.shard_count);
+    if (seeds.empty()) {
+      std::cerr << "Shard " << opts.shard_index << '/' << opts.shard_count
+                << " has none of the " << opts.process_count << " games"
+                << std::endl;
+      exit(1);
+    }
+    opts.process_count = (int)seeds.size();
+  }
+  // With a time budget, -c only caps the number of games, and nothing does
+  // without it (but for shards, whose -c is split between them)
+  if (opts.budget > 0 && !opts.process_count_given && opts.shard_count == 0) {
+    opts.process_count = statistics_t::unbounded;
+  }
+  const bool unbounded = opts.process_count == statistics_t::unbounded;
+  // Shards are how runs too long for a single machine get played
+  if (opts.process_count >= 1000 && opts.budget == 0 &&
+      opts.shard_count == 0) {
     std::cerr << "Keep the process count (-c) < 1000 please" << std::endl;
     exit(1);
   }
@@ -65,6 +113,16 @@ int main(int argc, const char **argv) {
     std::cerr << "-p must be > 0" << std::endl;
     exit(1);
   }
+  if (opts.analyze_logs && !opts.generate_output) {
+    std::cerr << "-A needs the game logs, it can't be used with -G"
+              << std::endl;
+    exit(1);
+  }
+  if (!opts.keep.empty() && !opts.generate_output) {
+    std::cerr << "--keep selects game logs, it can't be used with -G"
+              << std::endl;
+    exit(1);
+  }
   if (opts.p1.empty() || opts.p2.empty() || opts.referee.empty()) {
     std::cerr
         << "You must specify commands for player 1, player 2 and the referee!"
@@ -72,64 +130,310 @@ int main(int argc, const char **argv) {
     exit(1);
   }
 
+  if (opts.watch && (opts.analyze_logs || opts.measure_latency)) {
+    std::cerr << "-A and -L can't be used with --watch" << std::endl;
+    exit(1);
+  }
+
+  if (!check_engine_options(opts)) {
+    exit(1);
+  }
+
+  // --watch: the evaluation starts over whenever a player's executable
+  // changes, the runner and its caches staying warm
+  std::optional<file_watcher> watcher;
+  if (opts.watch) {
+    std::vector<std::filesystem::path> executables;
+    for (auto command : {opts.p1, opts.p2}) {
+      auto executable = command_executable(command);
+      if (executable.empty()) {
+        std::cerr << "--watch: cannot find the executable of '" << command
+                  << "'" << std::endl;
+        exit(1);
+      }
+      executables.push_back(std::move(executable));
+    }
+    watcher.emplace(executables);
+  }
+
   statistics_t stats{.total_games = opts.process_count};
   auto runner = make_runner(opts);
+  latency_collector latencies{runner.latency_directory};
 
-  auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
-                 std::chrono::system_clock::now().time_since_epoch())
-                 .count();
-  auto timestamp = std::to_string(now);
+  const auto timestamped_prefix = [] {
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    return "output-" + std::to_string(now) + '-';
+  };
+  auto output_prefix = timestamped_prefix();
   auto output_file = [&](int x) {
-    return "output-" + timestamp + '-' + std::to_string(x) + ".json";
+    return output_prefix + std::to_string(x) + ".json";
   };
 
-  int left_to_run = opts.process_count;
-  auto current_offset = 0;
+  std::optional<log_analyzer> logs;
+  if (opts.analyze_logs) {
+    logs.emplace(opts.threads);
+  }
 
-  std::vector<dpsg::posix::process_t> processes;
-  processes.reserve(opts.parallel_processes);
-  std::vector<run_result> results;
-  results.reserve(opts.parallel_processes);
+  // Logs go to tmpfs first when only some of them are kept
+  std::optional<scratch_logs> scratch;
+  if (!opts.keep.empty()) {
+    scratch.emplace(keep_policy::parse(opts.keep), logs ? &*logs : nullptr);
+  }
+  const auto log_file = [&](int x) {
+    return scratch ? scratch->scratch_path(output_file(x)) : output_file(x);
+  };
+
+  result_store store{output_prefix};
+  if (!unbounded) {
+    store.reserve(opts.process_count);
+  }
   presenter p{std::cout};
 
-  while (left_to_run > 0) {
-    int batch_size = std::min(left_to_run, opts.parallel_processes);
+  resource_statistics resources{.from_cgroups = runner.uses_cgroups()};
+  class_data_statistics startup{
+      .archive = runner.uses_class_data() ? runner.class_data->path() : ""};
 
-    for (int i = 0; i < batch_size; ++i) {
-      auto run_count = current_offset + i;
-      auto of = output_file(run_count);
-      processes.emplace_back(runner(of));
-      results.emplace_back(run_result{.output_file = of});
-      p.update_header(run_count);
+  throughput_statistics speed{dpsg::posix::monotonic_now()};
+
+  // Each evaluation of --watch starts new trace and results files
+  std::ofstream trace;
+  std::ofstream results;
+  const auto reopen = [](std::ofstream &out, std::string_view path) {
+    out.close();
+    out.clear();
+    out.open(std::string{path}, std::ios::trunc);
+    if (!out) {
+      std::cerr << "Cannot write " << path << std::endl;
+      exit(1);
     }
-    p.update_statistics(stats);
+  };
+  std::string results_path{opts.results};
+  if (results_path.empty() && opts.shard_count > 0) {
+    results_path = "shard-" + std::to_string(opts.shard_index) + "-of-" +
+                   std::to_string(opts.shard_count) + ".results";
+  }
+  const auto open_outputs = [&] {
+    if (!opts.trace.empty()) {
+      reopen(trace, opts.trace);
+    }
+    if (!results_path.empty()) {
+      reopen(results, results_path);
+      char host[256] = "";
+      dpsg::posix::native::gethostname(host, sizeof(host) - 1);
+      write_result_header(
+          results,
+          result_header{
+              .referee = std::string{opts.referee},
+              .player1 = std::string{opts.p1},
+              .player2 = std::string{opts.p2},
+              .shard_index = opts.shard_index,
+              .shard_count = opts.shard_count,
+              .games = unbounded ? 0 : run_games,
+              .started_ms =
+                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count(),
+              .host = host,
+          });
+    }
+  };
 
-    poll_one_each(std::span{processes}, dpsg::posix::poll_event_t::read_ready,
-                  [current_offset, &results, &stats,
-                   &p](dpsg::posix::process_t &proc, size_t idx) {
-                    auto run_count = idx + current_offset;
-                    auto &result = results[run_count];
+  // With the seeds known up front, the games expected to last the longest
+  // are launched first. Without a game count, each pass over the seeds
+  // follows the plan of one.
+  duration_history history{opts.history};
+  const auto matchup = duration_history::matchup(opts.referee, opts.p1, opts.p2);
+  launch_plan plan;
+  const auto make_plan = [&] {
+    plan = plan_launches(history, matchup, seeds,
+                         unbounded ? (int)seeds.size() : opts.process_count,
+                         opts.parallel_processes);
+  };
+  const auto seed_of = [&](int run_count) {
+    return seeds.empty()
+               ? std::string{}
+               : seeds[plan.order[(size_t)run_count % plan.order.size()] %
+                       seeds.size()];
+  };
 
-                    std::string seed;
+  const auto report = [&](int submitted) {
+    history.save();
+    trace.flush();
+    results.flush();
 
-                    dpsg::posix::fd_streambuf buf{proc.stdout};
-                    std::istream out{&buf};
-                    out >> result.p1_score >> result.p2_score >> seed;
+    p.print_summary(stats, store);
+    {
+      thread_pool pool{(unsigned)opts.threads};
+      p.print_bootstrap(bootstrap(store, pool));
+    }
+    if (runner.measures_latency()) {
+      latencies.cleanup();
+      p.print_latency(latencies.stats);
+    }
+    if (scratch) {
+      p.print_kept_logs(scratch->finish());
+    }
+    if (logs) {
+      p.print_log_statistics(logs->finish());
+    }
+    if (runner.limits.any()) {
+      p.print_resources(resources);
+    }
+    if (runner.profiler) {
+      p.print_profile(runner.profiler->finish());
+    }
+    if (!startup.archive.empty()) {
+      p.print_class_data(startup);
+    }
+    if (opts.budget > 0) {
+      p.print_budget(opts.budget, (size_t)submitted - store.size(),
+                     opts.kill_at_deadline, stats,
+                     std::chrono::duration<double>(
+                         dpsg::posix::monotonic_now() - speed.started)
+                         .count());
+    }
+    if (plan.makespan_ms > 0) {
+      p.print_schedule(plan, std::chrono::duration<double, std::milli>(
+                                 speed.last_completion - speed.started)
+                                 .count());
+    }
+    size_t overflow = 0;
+    auto tails = runner.stderr_logs->take_kept(overflow);
+    p.print_stderr_tails(tails, overflow);
+  };
 
-                    int eq = seed.find('=');
-                    result.seed = std::string_view{seed}.substr(eq + 1);
+  // The engines count the results themselves, possibly on several threads
+  const auto play = [&](auto &games) {
+    // Games of a cancelled evaluation may still report, they're ignored
+    game_id first_id = 0;
 
-                    aggregate(result, stats);
-                    p.update_result(run_count, result, stats);
-                  });
+    games.on_launch([&](game_id id, const game_t &) {
+      if (id < first_id) {
+        return;
+      }
+      p.update_header((int)(id - first_id));
+      p.update_statistics(stats);
+    });
+    games.on_exit([&](game_id id, const struct rusage &usage) {
+      resources.add(runner.release(id, usage));
+      if (scratch) {
+        scratch->release(id);
+      }
+    });
 
-    left_to_run -= batch_size;
-    current_offset += batch_size;
-    processes.clear();
-  }
+    const auto on_result = [&](game_id id, const game_t &,
+                               run_result &result) {
+      if (id < first_id) {
+        return;
+      }
+      const int run_count = (int)(id - first_id);
+      stats = games.statistics();
+      stats.total_games = opts.process_count;
+      store.push_back(run_count, result);
+      if (runner.uses_class_data()) {
+        startup.add(runner.class_data->used_by(id),
+                    std::chrono::duration<double, std::milli>(result.duration)
+                        .count());
+      }
+      if (runner.measures_latency()) {
+        latencies.collect((int)id);
+      }
+      if (scratch) {
+        scratch->finished(id, result);
+      } else if (logs) {
+        logs->submit(result.output_file);
+      }
+      p.update_result(run_count, result, stats);
+      if (trace.is_open()) {
+        write_trace(trace, result);
+      }
+      if (results.is_open()) {
+        write_result(results, result);
+      }
+      if (result.has_error()) {
+        runner.stderr_logs->keep(id, "Run " + std::to_string(run_count + 1) +
+                                         " (seed " + result.seed + ")");
+      } else {
+        history.record(
+            matchup, result.seed,
+            std::chrono::duration<double, std::milli>(result.duration).count());
+      }
+
+      auto now = dpsg::posix::monotonic_now();
+      speed.add(now, result.duration);
+      p.update_throughput(speed, stats, games.in_flight(), games.slot_count(),
+                          now);
+    };
 
-  p.print_summary(stats, results);
+    const auto submit = [&](int run_count) {
+      auto id = games.submit(
+          game_t{
+              .player1 = std::string{opts.p1},
+              .player2 = std::string{opts.p2},
+              .referee = std::string{opts.referee},
+              .seed = seed_of(run_count),
+              .output_file =
+                  opts.generate_output ? log_file(run_count) : "",
+          },
+          on_result);
+      if (run_count == 0) {
+        first_id = id;
+      }
+    };
+
+    // Time budget (--budget): judging by the slowest games so far (p90), or
+    // until one completes by the history
+    const auto expected_ms = [&](int run_count) -> std::optional<double> {
+      if (speed.count > 0) {
+        return speed.duration_quantile_ms(0.9);
+      }
+      return history.predict(matchup, seed_of(run_count));
+    };
+    run_driver driver{games,
+                      {.games = opts.process_count,
+                       .budget = std::chrono::seconds(opts.budget),
+                       .kill_at_deadline = opts.kill_at_deadline},
+                      dpsg::posix::monotonic_now,
+                      submit,
+                      expected_ms};
+
+    for (bool first = true;; first = false) {
+      if (!first) {
+        output_prefix = timestamped_prefix();
+        store.clear(output_prefix);
+        games.reset_statistics();
+        stats = games.statistics();
+        stats.total_games = opts.process_count;
+        speed = throughput_statistics{dpsg::posix::monotonic_now()};
+        p.reset_screen();
+      }
+      first_id = std::numeric_limits<game_id>::max();
+      make_plan();
+      open_outputs();
+
+      std::function<bool()> changed;
+      if (watcher) {
+        changed = [&] { return watcher->changed(); };
+      }
+      if (driver.run(changed, watch_interval)) {
+        games.run();
+        stats = games.statistics();
+        stats.total_games = opts.process_count;
+        report(driver.submitted());
+        if (!watcher) {
+          return;
+        }
+        p.print_watching();
+        watcher->wait();
+      }
+      // Let the build finish writing before the players start
+      watcher->settle(watch_interval * 5);
+    }
+  };
 
+  with_engine(opts, runner, play);
 
   return 0;
 }
@@ -0,0 +1,72 @@
+#ifndef HEADER_GUARD_DPSG_MPSC_QUEUE_HPP
+#define HEADER_GUARD_DPSG_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+// Unbounded lock-free queue with any number of producers and a single
+// consumer (D. Vyukov's intrusive MPSC queue, with a node allocated per
+// element). Producers never wait on each other: pushing is one atomic
+// exchange. Elements pushed by one producer are popped in order.
+template <class T> class mpsc_queue {
+public:
+  mpsc_queue() : _head(&_stub), _tail(&_stub) {}
+  mpsc_queue(const mpsc_queue &) = delete;
+  mpsc_queue &operator=(const mpsc_queue &) = delete;
+  ~mpsc_queue() {
+    while (pop()) {
+    }
+  }
+
+  void push(T value) { _push(new node{std::move(value)}); }
+
+  // Consumer side only. Returns nothing when the queue is empty, or when a
+  // producer is half-way through a push (the element shows up on a later
+  // call).
+  std::optional<T> pop() {
+    node *tail = _tail;
+    node *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &_stub) {
+      if (next == nullptr) {
+        return std::nullopt;
+      }
+      _tail = tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next == nullptr) {
+      if (tail != _head.load(std::memory_order_acquire)) {
+        return std::nullopt;
+      }
+      // Put the stub back behind the last element to be able to detach it
+      _stub.next.store(nullptr, std::memory_order_relaxed);
+      _push(&_stub);
+      next = tail->next.load(std::memory_order_acquire);
+      if (next == nullptr) {
+        return std::nullopt;
+      }
+    }
+    _tail = next;
+    std::optional<T> value{std::move(*tail->value)};
+    delete tail;
+    return value;
+  }
+
+private:
+  struct node {
+    std::optional<T> value;
+    std::atomic<node *> next = nullptr;
+  };
+
+  void _push(node *n) {
+    node *previous = _head.exchange(n, std::memory_order_acq_rel);
+    previous->next.store(n, std::memory_order_release);
+  }
+
+  node _stub;
+  std::atomic<node *> _head;
+  // Only touched by the consumer
+  node *_tail;
+};
+
+#endif // HEADER_GUARD_DPSG_MPSC_QUEUE_HPP
@@ -1,5 +1,142 @@
 #include "options.hpp"
 
+#include <charconv>
+
+namespace {
+
+// Options with a long name (`--name value` or `--name=value`) and no short
+// equivalent
+struct long_option {
+  std::string_view name;
+  bool takes_value;
+  void (*apply)(option_t &options, std::string_view value);
+};
+
+constexpr long_option long_options[] = {
+    {"checkpoint", true,
+     [](option_t &o, std::string_view v) { o.checkpoint = v; }},
+    {"memory-max", true,
+     [](option_t &o, std::string_view v) {
+       o.memory_max = unwrap(dpsg::cli::parse_size(v), "Invalid size ", v);
+     }},
+    {"cpu-max", true,
+     [](option_t &o, std::string_view v) {
+       auto r = std::from_chars(v.data(), v.data() + v.size(), o.cpu_max);
+       if (r.ec != std::errc{} || r.ptr != v.data() + v.size() ||
+           o.cpu_max <= 0) {
+         std::cerr << "Invalid CPU fraction " << v << std::endl;
+         exit(1);
+       }
+     }},
+    {"seeds", true, [](option_t &o, std::string_view v) { o.seed_file = v; }},
+    {"history", true, [](option_t &o, std::string_view v) { o.history = v; }},
+    {"pids-max", true,
+     [](option_t &o, std::string_view v) {
+       o.pids_max = unwrap(dpsg::cli::parse_unsigned_int(v),
+                           "Invalid process count ", v);
+     }},
+    {"io-threads", true,
+     [](option_t &o, std::string_view v) {
+       o.io_threads = unwrap(dpsg::cli::parse_unsigned_int(v),
+                             "Invalid thread count ", v);
+     }},
+    {"jvm-flag", true,
+     [](option_t &o, std::string_view v) { o.jvm_flags.push_back(v); }},
+    {"preload", true,
+     [](option_t &o, std::string_view v) { o.preload.push_back(v); }},
+    {"huge-pages", false,
+     [](option_t &o, std::string_view) { o.huge_pages = true; }},
+    {"budget", true,
+     [](option_t &o, std::string_view v) {
+       o.budget = unwrap(dpsg::cli::parse_duration(v), "Invalid duration ", v);
+     }},
+    {"at-deadline", true,
+     [](option_t &o, std::string_view v) {
+       if (v != "drain" && v != "kill") {
+         std::cerr << "--at-deadline expects drain or kill, got " << v
+                   << std::endl;
+         exit(1);
+       }
+       o.kill_at_deadline = v == "kill";
+     }},
+    {"watch", false, [](option_t &o, std::string_view) { o.watch = true; }},
+    {"daemon", false, [](option_t &o, std::string_view) { o.daemon = true; }},
+    {"socket", true, [](option_t &o, std::string_view v) { o.socket = v; }},
+    {"shard", true,
+     [](option_t &o, std::string_view v) {
+       auto slash = v.find('/');
+       if (slash == std::string_view::npos) {
+         std::cerr << "--shard expects i/N, got " << v << std::endl;
+         exit(1);
+       }
+       o.shard_index = unwrap(
+           dpsg::cli::parse_unsigned_int(v.substr(0, slash)), "Invalid shard ",
+           v);
+       o.shard_count = unwrap(
+           dpsg::cli::parse_unsigned_int(v.substr(slash + 1)),
+           "Invalid shard ", v);
+       if (o.shard_index < 1 || o.shard_index > o.shard_count) {
+         std::cerr << "--shard i/N needs 1 <= i <= N, got " << v << std::endl;
+         exit(1);
+       }
+     }},
+    {"results", true, [](option_t &o, std::string_view v) { o.results = v; }},
+    {"trace", true, [](option_t &o, std::string_view v) { o.trace = v; }},
+    {"record", true, [](option_t &o, std::string_view v) { o.record = v; }},
+    {"profile", true, [](option_t &o, std::string_view v) { o.profile = v; }},
+    {"stderr-tail", true,
+     [](option_t &o, std::string_view v) {
+       o.stderr_tail = unwrap(dpsg::cli::parse_size(v), "Invalid size ", v);
+       if (o.stderr_tail == 0) {
+         std::cerr << "--stderr-tail must be > 0" << std::endl;
+         exit(1);
+       }
+     }},
+    {"keep", true, [](option_t &o, std::string_view v) { o.keep = v; }},
+    {"no-cds", false,
+     [](option_t &o, std::string_view) { o.class_data_sharing = false; }},
+    {"pairs", true,
+     [](option_t &o, std::string_view v) {
+       o.tuning_pairs = unwrap(dpsg::cli::parse_unsigned_int(v),
+                               "Invalid pair count ", v);
+     }},
+};
+
+// Returns the index of the last argument consumed
+int parse_long_option(option_t &options, int argc, const char **argv, int i) {
+  std::string_view arg = std::string_view{argv[i]}.substr(2);
+  std::string_view value;
+  bool has_value = false;
+  if (auto eq = arg.find('='); eq != std::string_view::npos) {
+    value = arg.substr(eq + 1);
+    arg = arg.substr(0, eq);
+    has_value = true;
+  }
+
+  for (auto &opt : long_options) {
+    if (opt.name != arg) {
+      continue;
+    }
+    if (opt.takes_value && !has_value) {
+      if (i + 1 >= argc) {
+        std::cerr << "Option needs a value: --" << arg << std::endl;
+        exit(1);
+      }
+      value = argv[++i];
+    } else if (!opt.takes_value && has_value) {
+      std::cerr << "Option --" << arg << " doesn't take a value" << std::endl;
+      exit(1);
+    }
+    opt.apply(options, value);
+    return i;
+  }
+
+  std::cerr << "Unexpected option --" << arg << std::endl;
+  exit(1);
+}
+
+} // namespace
+
 option_t parse_options(int argc, const char **argv) {
 
   enum { expect_option, expect_value } expectation = expect_option;
@@ -12,7 +149,10 @@ option_t parse_options(int argc, const char **argv) {
     player_1 = '1',
     player_2 = '2',
     referee = 'r',
-    debug = 'd'
+    debug = 'd',
+    measure_latency = 'L',
+    threads = 'j',
+    analyze_logs = 'A',
 
   } current_option = curopt::none;
 
@@ -23,9 +163,13 @@ option_t parse_options(int argc, const char **argv) {
 
     switch (expectation) {
     case expect_option: {
+      if (arg.starts_with("--")) {
+        i = parse_long_option(options, argc, argv, i);
+        break;
+      }
       if (arg.size() < 2 || arg[0] != '-') {
-        std::cerr << "Expected option, got '" << arg << "'" << std::endl;
-        exit(1);
+        options.arguments.push_back(arg);
+        break;
       }
 
       for (size_t c = 1; c < arg.size(); ++c) {
@@ -36,6 +180,7 @@ option_t parse_options(int argc, const char **argv) {
             options.process_count =
                 unwrap(dpsg::cli::parse_unsigned_int(arg.substr(c + 1)),
                        "Invalid run count ", arg.substr(c + 1));
+            options.process_count_given = true;
           } else {
             current_option = curopt::count;
             expectation = expect_value;
@@ -88,6 +233,25 @@ option_t parse_options(int argc, const char **argv) {
           options.debug = true;
           break;
         }
+        case curopt::threads: {
+          if (c < arg.size() - 1) {
+            options.threads =
+                unwrap(dpsg::cli::parse_unsigned_int(arg.substr(c + 1)),
+                       "Invalid thread count ", arg.substr(c + 1));
+          } else {
+            current_option = curopt::threads;
+            expectation = expect_value;
+          }
+          goto done_with_short_options;
+        }
+        case curopt::analyze_logs: {
+          options.analyze_logs = true;
+          break;
+        }
+        case curopt::measure_latency: {
+          options.measure_latency = true;
+          break;
+        }
         default: {
           std::cerr << "Unexpected option " << cur << std::endl;
           exit(1);
@@ -102,6 +266,7 @@ option_t parse_options(int argc, const char **argv) {
       case curopt::count: {
         options.process_count = unwrap(dpsg::cli::parse_unsigned_int(arg),
                                        "Invalid run count ", arg);
+        options.process_count_given = true;
         break;
       }
       case curopt::parallel_processes: {
@@ -110,6 +275,11 @@ option_t parse_options(int argc, const char **argv) {
                    "Invalid parallel process count ", arg);
         break;
       }
+      case curopt::threads: {
+        options.threads = unwrap(dpsg::cli::parse_unsigned_int(arg),
+                                 "Invalid thread count ", arg);
+        break;
+      }
       case curopt::player_1: {
         options.p1 = arg;
         break;
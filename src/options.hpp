@@ -6,15 +6,82 @@
 
 #include <string_view>
 #include <iostream>
+#include <vector>
 
 struct option_t {
   int process_count = 20;
+  // Whether -c was given, for the modes with a default of their own
+  bool process_count_given = false;
   int parallel_processes = 4;
   bool generate_output = true;
   std::string_view p1 = "";
   std::string_view p2 = "";
   std::string_view referee = "";
   bool debug = false;
+  bool measure_latency = false;
+  // Directory in which to record the input of the players (see transcript.hpp)
+  std::string_view record;
+  // Directory receiving the folded stacks of the players (see profiler.hpp)
+  std::string_view profile;
+  bool analyze_logs = false;
+  // Worker threads for the analysis of game logs, 0 for one per core
+  int threads = 0;
+  // Threads launching games and reading their results. 1 keeps everything on
+  // the main thread, 0 means one per core
+  int io_threads = 1;
+
+  // Time budget of the run in seconds (--budget), 0 to play -c games
+  int64_t budget = 0;
+  // Whether the games still running at the end of the budget are killed
+  // rather than waited for
+  bool kill_at_deadline = false;
+
+  // Start over whenever a player's executable changes
+  bool watch = false;
+
+  // Play the games through `runner daemon` (see daemon.hpp), listening on
+  // `socket` (default_daemon_socket() when empty)
+  bool daemon = false;
+  std::string_view socket;
+
+  // Part of the run played here (--shard i/N, see shard.hpp), from 1, 0 out
+  // of 0 for the whole run
+  int shard_index = 0;
+  int shard_count = 0;
+  // Results file of the run (see shard.hpp), none when empty unless sharded
+  std::string_view results;
+
+  // File receiving the seed, result and duration of every game (see
+  // simulation.hpp), none when empty
+  std::string_view trace;
+
+  // Bytes of stderr kept for each game, shown for the failed ones
+  size_t stderr_tail = 8 << 10;
+
+  // Which game logs to keep (see scratch_logs.hpp), empty to keep them all
+  std::string_view keep;
+
+  // Data files shared with the players through memfds (--preload,
+  // repeatable, see preload.hpp), on huge pages with --huge-pages
+  std::vector<std::string_view> preload;
+  bool huge_pages = false;
+  // Extra flags for the referee's JVM (--jvm-flag, repeatable)
+  std::vector<std::string_view> jvm_flags;
+  // Cache an AppCDS archive of the referee's classes (see class_data.hpp)
+  bool class_data_sharing = true;
+  // Per game resource limits, 0 for none
+  uint64_t memory_max = 0;
+  double cpu_max = 0;
+  uint64_t pids_max = 0;
+  // Non-option arguments, used by subcommands
+  std::vector<std::string_view> arguments;
+  // Tuning mode
+  std::string_view checkpoint = "tune.checkpoint";
+  int tuning_pairs = 1;
+  // Seeds to play, one per line, left to the referee when empty
+  std::string_view seed_file;
+  // Game durations of the previous runs (see schedule.hpp), none when empty
+  std::string_view history;
 };
 
 template <class T, class E, class... Args>
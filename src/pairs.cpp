@@ -0,0 +1,42 @@
+#include "pairs.hpp"
+#include "schedule.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+void pair_scores::add(double score) {
+  n++;
+  sum += score;
+  sum_squares += score * score;
+}
+
+double pair_scores::mean() const { return n == 0 ? 0.5 : sum / n; }
+
+double pair_scores::standard_error() const {
+  if (n == 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  const double m = mean();
+  const double squares = std::max(0.0, sum_squares - n * m * m);
+  const double variance =
+      (squares + 2 * prior_deviation * prior_deviation) / (n + 1);
+  return std::sqrt(variance / n);
+}
+
+std::optional<std::vector<std::string>>
+read_pair_seeds(option_t &opts, size_t games_per_seed, int min_games) {
+  auto seeds = read_seeds(opts.seed_file, default_pair_seed_count);
+  if (!opts.process_count_given) {
+    opts.process_count = (int)(games_per_seed * seeds.size());
+  }
+  if (opts.parallel_processes <= 0 || opts.process_count < min_games) {
+    std::cerr << "-c must be >= " << min_games << " and -p > 0" << std::endl;
+    return std::nullopt;
+  }
+  if (!check_engine_options(opts)) {
+    return std::nullopt;
+  }
+  return seeds;
+}
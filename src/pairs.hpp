@@ -0,0 +1,95 @@
+#ifndef HEADER_GUARD_DPSG_PAIRS_HPP
+#define HEADER_GUARD_DPSG_PAIRS_HPP
+
+#include "engine.hpp"
+#include "engine_choice.hpp"
+#include "options.hpp"
+#include "runner.hpp"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// What `runner bisect`, `race` and `ab` have in common: bots playing
+// side-swapped pairs against a baseline, on the same seeds in the same order,
+// each pair scoring the average points of the bot (0 to 1), which cancels out
+// most of the advantage of a side.
+
+// Seeds played when no --seeds file is given
+constexpr size_t default_pair_seed_count = 200;
+
+// Running mean of the pair scores of a bot
+struct pair_scores {
+  // Standard deviation assumed for a pair score before any is seen, weighing
+  // two pairs in the estimate
+  constexpr static inline double prior_deviation = 0.35;
+
+  int n = 0;
+  double sum = 0;
+  double sum_squares = 0;
+
+  void add(double score);
+  // 0.5 before any pair
+  double mean() const;
+  // Infinite before any pair
+  double standard_error() const;
+};
+
+// Seeds of the run (--seeds, else default_pair_seed_count random ones), -c
+// defaulting to `games_per_seed` games on each of them. Nothing, with a
+// message on stderr, when -p or -c leave no room for `min_games` or the
+// engine options don't go together.
+std::optional<std::vector<std::string>>
+read_pair_seeds(option_t &opts, size_t games_per_seed, int min_games);
+
+// Submits the two games of `bot` against `baseline` on `seed`, `bot` being
+// player 1 then player 2. `on_game` is given each result, with its game and
+// the seat of the bot, and `on_pair` the score of the pair once both are in.
+// Returns the ids of the games.
+template <class Engine>
+std::array<game_id, 2>
+submit_pair(Engine &games, const std::string &bot, const std::string &baseline,
+            std::string_view referee, const std::string &seed,
+            std::function<void(double)> on_pair,
+            std::function<void(game_id, int, run_result &)> on_game = nullptr) {
+  auto pair = std::make_shared<double>(0);
+  auto remaining = std::make_shared<int>(2);
+  std::array<game_id, 2> ids;
+  for (int seat = 0; seat < 2; ++seat) {
+    ids[seat] = games.submit(
+        game_t{
+            .player1 = seat == 0 ? bot : baseline,
+            .player2 = seat == 0 ? baseline : bot,
+            .referee = std::string{referee},
+            .seed = seed,
+        },
+        [=](game_id id, const game_t &, run_result &r) {
+          if (on_game) {
+            on_game(id, seat, r);
+          }
+          *pair += r.points(seat) / 2;
+          if (--*remaining == 0) {
+            on_pair(*pair);
+          }
+        });
+  }
+  return ids;
+}
+
+// Makes the runner and the engine of the run (see engine_choice.hpp), and
+// calls `play(games)`
+template <class F> void with_pair_engine(const option_t &opts, F &&play) {
+  auto runner = make_runner(opts);
+  with_engine(opts, runner, [&](auto &games) {
+    games.on_exit([&runner](game_id id, const struct rusage &usage) {
+      runner.release(id, usage);
+    });
+    play(games);
+  });
+}
+
+#endif // HEADER_GUARD_DPSG_PAIRS_HPP
@@ -0,0 +1,362 @@
+#include "parallel_engine.hpp"
+
+#include <algorithm>
+
+using namespace dpsg::posix;
+
+namespace {
+
+fd_t make_eventfd() {
+  int fd = native::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fd == -1) {
+    perror("Failed to create an eventfd");
+    exit(1);
+  }
+  return (fd_t)fd;
+}
+
+} // namespace
+
+parallel_engine::parallel_engine(int slot_count, unsigned io_threads,
+                                 launcher launch)
+    : _slot_count(slot_count), _launch(std::move(launch)),
+      _events_ready(make_eventfd()) {
+  if (io_threads == 0) {
+    io_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  io_threads = std::min<unsigned>(io_threads, std::max(1, slot_count));
+
+  for (unsigned i = 0; i < io_threads; ++i) {
+    auto r = std::make_unique<reactor>();
+    r->slot_count = slot_count / io_threads + (i < slot_count % io_threads);
+    r->free_slots = r->slot_count;
+    r->wakeup = make_eventfd();
+    _reactors.push_back(std::move(r));
+  }
+  // Started once every reactor exists, as they may steal from each other
+  for (auto &r : _reactors) {
+    r->thread = std::thread{[this, &r = *r] { _work(r); }};
+  }
+}
+
+parallel_engine::~parallel_engine() {
+  _stopping = true;
+  for (auto &r : _reactors) {
+    native::eventfd_write((int)r->wakeup, 1);
+  }
+  for (auto &r : _reactors) {
+    r->thread.join();
+    native::close((int)r->wakeup);
+  }
+  native::close((int)_events_ready);
+  // Games that never made it to the callbacks
+  while (auto e = _events.pop()) {
+    if (e->type == event::kind::finished) {
+      delete e->game;
+    }
+  }
+}
+
+game_id parallel_engine::submit(game_t game, callback on_done) {
+  auto id = _next_id++;
+  auto &r = *_reactors[id % _reactors.size()];
+  {
+    std::lock_guard lock{r.mutex};
+    r.pending.push_back(std::make_unique<pending_game>(
+        pending_game{id, std::move(game), std::move(on_done)}));
+  }
+  _unfinished++;
+  _unexited++;
+  _pending_count.fetch_add(1, std::memory_order_relaxed);
+
+  native::eventfd_write((int)r.wakeup, 1);
+  if (r.free_slots.load(std::memory_order_relaxed) == 0) {
+    // Someone else with a free slot steals it
+    for (size_t i = 1; i < _reactors.size(); ++i) {
+      auto &other = *_reactors[(id + i) % _reactors.size()];
+      if (other.free_slots.load(std::memory_order_relaxed) > 0) {
+        native::eventfd_write((int)other.wakeup, 1);
+        break;
+      }
+    }
+  }
+  return id;
+}
+
+void parallel_engine::cancel() {
+  _cancel_before = _next_id;
+  size_t dropped = 0;
+  for (auto &r : _reactors) {
+    std::lock_guard lock{r->mutex};
+    dropped += r->pending.size();
+    r->pending.clear();
+  }
+  _pending_count.fetch_sub(dropped, std::memory_order_relaxed);
+  _unfinished -= dropped;
+  _unexited -= dropped;
+  // The games in flight are killed by their I/O thread
+  for (auto &r : _reactors) {
+    native::eventfd_write((int)r->wakeup, 1);
+  }
+}
+
+bool parallel_engine::cancel(game_id id) {
+  for (auto &r : _reactors) {
+    std::lock_guard lock{r->mutex};
+    auto it = std::find_if(r->pending.begin(), r->pending.end(),
+                           [id](auto &g) { return g->id == id; });
+    if (it != r->pending.end()) {
+      r->pending.erase(it);
+      _pending_count.fetch_sub(1, std::memory_order_relaxed);
+      _unfinished--;
+      _unexited--;
+      return false;
+    }
+  }
+  {
+    std::lock_guard lock{_cancelled_mutex};
+    _cancelled.insert(id);
+    _cancelled_count = _cancelled.size();
+  }
+  // Killed by the I/O thread which launched it
+  for (auto &r : _reactors) {
+    native::eventfd_write((int)r->wakeup, 1);
+  }
+  return true;
+}
+
+bool parallel_engine::_is_cancelled(game_id id) {
+  if (id < _cancel_before.load()) {
+    return true;
+  }
+  if (_cancelled_count.load(std::memory_order_relaxed) == 0) {
+    return false;
+  }
+  std::lock_guard lock{_cancelled_mutex};
+  return _cancelled.contains(id);
+}
+
+statistics_t parallel_engine::statistics() const {
+  statistics_t merged;
+  for (auto &r : _reactors) {
+    std::lock_guard lock{r->stats_mutex};
+    merged.merge(r->stats);
+  }
+  return merged;
+}
+
+void parallel_engine::reset_statistics() {
+  for (auto &r : _reactors) {
+    std::lock_guard lock{r->stats_mutex};
+    r->stats = {};
+  }
+}
+
+std::unique_ptr<parallel_engine::pending_game>
+parallel_engine::_take(reactor &self) {
+  std::unique_ptr<pending_game> game;
+  {
+    std::lock_guard lock{self.mutex};
+    if (!self.pending.empty()) {
+      game = std::move(self.pending.front());
+      self.pending.pop_front();
+      return game;
+    }
+  }
+  // Steal from the back, away from where the owner takes its games
+  for (auto &r : _reactors) {
+    if (r.get() == &self) {
+      continue;
+    }
+    std::lock_guard lock{r->mutex};
+    if (!r->pending.empty()) {
+      game = std::move(r->pending.back());
+      r->pending.pop_back();
+      return game;
+    }
+  }
+  return game;
+}
+
+void parallel_engine::_notify(event e) {
+  _events.push(std::move(e));
+  native::eventfd_write((int)_events_ready, 1);
+}
+
+void parallel_engine::_work(reactor &self) {
+  struct slot {
+    std::unique_ptr<pending_game> game;
+    process_t process;
+    std::chrono::nanoseconds started;
+  };
+  std::vector<slot> active;
+  active.reserve(self.slot_count);
+  std::vector<std::pair<dpsg::posix::pid_t, game_id>> exiting;
+  std::vector<dpsg::posix::pollfd> pollfds;
+
+  const auto reap = [&](int options) {
+    std::erase_if(exiting, [&](auto &e) {
+      int status;
+      struct rusage usage {};
+      if (native::wait4((int)e.first, &status, options, &usage) == 0) {
+        return false;
+      }
+      untrack_game(e.first);
+      event exited{.type = event::kind::exited, .id = e.second};
+      exited.usage = usage;
+      _notify(std::move(exited));
+      return true;
+    });
+  };
+
+  while (!_stopping) {
+    while ((int)active.size() < self.slot_count) {
+      auto game = _take(self);
+      if (!game) {
+        break;
+      }
+      _pending_count.fetch_sub(1, std::memory_order_relaxed);
+      auto started = monotonic_now();
+      auto process = _launch(game->game, game->id);
+      track_game(process.pid);
+      _notify(event{.type = event::kind::launched,
+                    .id = game->id,
+                    .game = game.get()});
+      active.push_back({std::move(game), process, started});
+    }
+    self.free_slots.store(self.slot_count - (int)active.size(),
+                          std::memory_order_relaxed);
+
+    pollfds.clear();
+    pollfds.emplace_back(self.wakeup, poll_event_t::read_ready);
+    for (auto &s : active) {
+      pollfds.emplace_back(s.process.stdout, poll_event_t::read_ready);
+    }
+    // Referees usually exit right after printing their result
+    auto timeout = exiting.empty() ? std::chrono::milliseconds(-1)
+                                   : std::chrono::milliseconds(50);
+    auto r = ::dpsg::posix::poll(std::span{pollfds}, timeout);
+    if (r.is_error()) {
+      auto e = r.error();
+      if (e == poll_error::interrupted || e == poll_error::again) {
+        continue;
+      }
+      perror("Poll failed");
+      exit(1);
+    }
+
+    if (pollfds[0].revents != 0) {
+      eventfd_t count;
+      native::eventfd_read((int)self.wakeup, &count);
+    }
+    for (size_t idx = pollfds.size(); idx-- > 1;) {
+      if (pollfds[idx].revents == 0) {
+        continue;
+      }
+      auto &s = active[idx - 1];
+      event e{.type = event::kind::finished, .id = s.game->id};
+      e.result.output_file = s.game->game.output_file;
+      parse_result(s.process.stdout, e.result);
+      e.result.duration = monotonic_now() - s.started;
+
+      native::close((int)s.process.stdout);
+      native::close((int)s.process.stdin);
+      native::close((int)s.process.stderr);
+      exiting.emplace_back(s.process.pid, s.game->id);
+
+      {
+        // Checked under the lock, so that a game cancelled before a
+        // reset_statistics can't be counted after it
+        std::lock_guard lock{self.stats_mutex};
+        e.cancelled = _is_cancelled(s.game->id);
+        if (!e.cancelled) {
+          aggregate(e.result, self.stats);
+        }
+      }
+      e.game = s.game.release();
+      _notify(std::move(e));
+      active.erase(active.begin() + (idx - 1));
+    }
+
+    std::erase_if(active, [&](slot &s) {
+      if (!_is_cancelled(s.game->id)) {
+        return false;
+      }
+      kill_game(s.process.pid);
+      native::close((int)s.process.stdout);
+      native::close((int)s.process.stdin);
+      native::close((int)s.process.stderr);
+      exiting.emplace_back(s.process.pid, s.game->id);
+      event e{.type = event::kind::finished, .id = s.game->id};
+      e.cancelled = true;
+      e.game = s.game.release();
+      _notify(std::move(e));
+      return true;
+    });
+    reap(WNOHANG);
+  }
+
+  for (auto &s : active) {
+    native::close((int)s.process.stdout);
+    native::close((int)s.process.stdin);
+    native::close((int)s.process.stderr);
+  }
+}
+
+size_t parallel_engine::poll(std::chrono::milliseconds timeout) {
+  dpsg::posix::pollfd ready{_events_ready, poll_event_t::read_ready};
+  auto r = ::dpsg::posix::poll(std::span{&ready, 1}, timeout);
+  if (r.is_error()) {
+    auto e = r.error();
+    if (e == poll_error::interrupted || e == poll_error::again) {
+      return 0;
+    }
+    perror("Poll failed");
+    exit(1);
+  }
+  if (ready.revents != 0) {
+    eventfd_t count;
+    native::eventfd_read((int)_events_ready, &count);
+  }
+
+  size_t finished = 0;
+  while (auto e = _events.pop()) {
+    switch (e->type) {
+    case event::kind::launched:
+      if (_on_launch) {
+        _on_launch(e->game->id, e->game->game);
+      }
+      break;
+    case event::kind::finished: {
+      std::unique_ptr<pending_game> game{e->game};
+      _unfinished--;
+      if (_cancelled_count.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard lock{_cancelled_mutex};
+        _cancelled.erase(game->id);
+        _cancelled_count = _cancelled.size();
+      }
+      if (e->cancelled) {
+        break;
+      }
+      finished++;
+      if (game->on_done) {
+        game->on_done(game->id, game->game, e->result);
+      }
+      break;
+    }
+    case event::kind::exited:
+      _unexited--;
+      if (_on_exit) {
+        _on_exit(e->id, e->usage);
+      }
+      break;
+    }
+  }
+  return finished;
+}
+
+void parallel_engine::run() {
+  while (!idle() || _unexited > 0) {
+    poll();
+  }
+}
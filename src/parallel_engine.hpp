@@ -0,0 +1,136 @@
+#ifndef HEADER_GUARD_DPSG_PARALLEL_ENGINE_HPP
+#define HEADER_GUARD_DPSG_PARALLEL_ENGINE_HPP
+
+#include "engine.hpp"
+#include "mpsc_queue.hpp"
+#include "statistics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Same interface as `engine`, for when a single thread launching games and
+// reading their results can't keep up with the number of slots.
+//
+// Each I/O thread owns a share of the slots and a queue of pending games, fed
+// round-robin by `submit`, which wakes the owner and, when the owner is full,
+// one thread with free slots. A thread with free slots and nothing left in its
+// own queue steals from the back of the others'. Launches, results and exits
+// are sent over a lock-free queue to the thread calling `poll`, which runs
+// every callback: callers need no synchronization of their own. The launcher
+// however is called from the I/O threads and must be thread-safe.
+class parallel_engine {
+public:
+  using callback = engine::callback;
+  using launcher = engine::launcher;
+
+  // 0 I/O threads means one per core
+  parallel_engine(int slot_count, unsigned io_threads, launcher launch);
+  parallel_engine(const parallel_engine &) = delete;
+  parallel_engine &operator=(const parallel_engine &) = delete;
+  ~parallel_engine();
+
+  game_id submit(game_t game, callback on_done);
+
+  void on_launch(std::function<void(game_id, const game_t &)> f) {
+    _on_launch = std::move(f);
+  }
+  void on_exit(std::function<void(game_id, const struct rusage &)> f) {
+    _on_exit = std::move(f);
+  }
+
+  // Runs the callbacks of what happened on the I/O threads, waiting up to
+  // `timeout` for something to happen. Returns the number of games that
+  // completed.
+  size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+
+  // Polls until every submitted game has completed and its referee exited.
+  void run();
+
+  // Drops the pending games and kills the referees of the games in flight,
+  // without calling their completion callbacks nor counting them in the
+  // statistics. Games already reported finished by their I/O thread still get
+  // their callback.
+  void cancel();
+  // Same for game `id` alone. Returns whether it had left the queue, and
+  // will go through `on_exit`.
+  bool cancel(game_id id);
+
+  size_t pending() const { return _pending_count.load(std::memory_order_relaxed); }
+  size_t in_flight() const { return _unfinished - pending(); }
+  bool idle() const { return _unfinished == 0; }
+  int slot_count() const { return _slot_count; }
+  size_t io_threads() const { return _reactors.size(); }
+
+  // Results of the games completed so far, counted by the I/O threads as
+  // they come. May be ahead of the completion callbacks.
+  statistics_t statistics() const;
+  void reset_statistics();
+
+private:
+  struct pending_game {
+    game_id id;
+    game_t game;
+    callback on_done;
+  };
+
+  struct event {
+    enum class kind { launched, finished, exited } type;
+    game_id id;
+    // Owned by the event once the game finished
+    pending_game *game = nullptr;
+    run_result result{};
+    struct rusage usage {};
+    // Finished because it was cancelled, without a result
+    bool cancelled = false;
+  };
+
+  struct reactor {
+    int slot_count;
+    // Updated by the thread before waiting, for `submit` to pick whom to wake
+    std::atomic<int> free_slots = 0;
+    dpsg::posix::fd_t wakeup;
+    std::mutex mutex;
+    std::deque<std::unique_ptr<pending_game>> pending;
+    // Sharded counters: each I/O thread aggregates its own results
+    mutable std::mutex stats_mutex;
+    statistics_t stats;
+    std::thread thread;
+  };
+
+  void _work(reactor &self);
+  std::unique_ptr<pending_game> _take(reactor &self);
+  void _notify(event e);
+  bool _is_cancelled(game_id id);
+
+  int _slot_count;
+  launcher _launch;
+  std::function<void(game_id, const game_t &)> _on_launch;
+  std::function<void(game_id, const struct rusage &)> _on_exit;
+  std::vector<std::unique_ptr<reactor>> _reactors;
+  std::atomic<bool> _stopping = false;
+  std::atomic<size_t> _pending_count = 0;
+  // Games submitted before the last call to cancel
+  std::atomic<game_id> _cancel_before = 0;
+  // Games cancelled one by one after they left the queues, until their
+  // completion is reported
+  std::mutex _cancelled_mutex;
+  std::unordered_set<game_id> _cancelled;
+  std::atomic<size_t> _cancelled_count = 0;
+
+  mpsc_queue<event> _events;
+  dpsg::posix::fd_t _events_ready;
+
+  // Only touched by the thread calling submit and poll
+  game_id _next_id = 0;
+  size_t _unfinished = 0;
+  size_t _unexited = 0;
+};
+
+#endif // HEADER_GUARD_DPSG_PARALLEL_ENGINE_HPP
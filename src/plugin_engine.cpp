@@ -0,0 +1,257 @@
+#include "plugin_engine.hpp"
+
+#include <algorithm>
+#include <memory>
+
+using namespace dpsg::posix;
+
+namespace {
+
+template <class F> F load_symbol(void *library, const char *name) {
+  auto symbol = native::dlsym(library, name);
+  if (symbol == nullptr) {
+    std::cerr << "Referee plugin: missing symbol " << name << std::endl;
+    exit(1);
+  }
+  return reinterpret_cast<F>(symbol);
+}
+
+void add_usage(struct rusage &total, const struct rusage &usage) {
+  const auto add = [](timeval &t, const timeval &u) {
+    t.tv_usec += u.tv_usec;
+    t.tv_sec += u.tv_sec + t.tv_usec / 1000000;
+    t.tv_usec %= 1000000;
+  };
+  add(total.ru_utime, usage.ru_utime);
+  add(total.ru_stime, usage.ru_stime);
+  total.ru_maxrss = std::max(total.ru_maxrss, usage.ru_maxrss);
+}
+
+} // namespace
+
+referee_plugin::referee_plugin(const std::string &path) {
+  // Without a slash, dlopen would search the library path instead
+  auto file = path.find('/') == std::string::npos ? "./" + path : path;
+  _library = native::dlopen(file.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (_library == nullptr) {
+    std::cerr << "Failed to load the referee plugin: " << native::dlerror()
+              << std::endl;
+    exit(1);
+  }
+  auto init = load_symbol<decltype(&cg_referee_init)>(_library,
+                                                      "cg_referee_init");
+  _play = load_symbol<decltype(&cg_referee_play)>(_library, "cg_referee_play");
+  _shutdown = load_symbol<decltype(&cg_referee_shutdown)>(
+      _library, "cg_referee_shutdown");
+
+  _state = init(CG_REFEREE_ABI_VERSION);
+  if (_state == nullptr) {
+    std::cerr << "The referee plugin " << path
+              << " failed to initialize (ABI version "
+              << CG_REFEREE_ABI_VERSION << ")" << std::endl;
+    exit(1);
+  }
+}
+
+referee_plugin::~referee_plugin() {
+  _shutdown(_state);
+  native::dlclose(_library);
+}
+
+plugin_engine::plugin_engine(int slot_count, const referee_plugin &referee,
+                             player_launcher launch)
+    : _slot_count(slot_count), _referee(referee), _launch(std::move(launch)),
+      _workers((unsigned)std::max(1, slot_count)) {
+  int fd = native::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fd == -1) {
+    perror("Failed to create an eventfd");
+    exit(1);
+  }
+  _events_ready = (fd_t)fd;
+}
+
+plugin_engine::~plugin_engine() {
+  _stopping = true;
+  _workers.wait();
+  native::close((int)_events_ready);
+  while (auto e = _events.pop()) {
+    if (e->type == event::kind::finished) {
+      delete e->game;
+    }
+  }
+}
+
+game_id plugin_engine::submit(game_t game, callback on_done) {
+  auto id = _next_id++;
+  auto *g = new pending_game{id, std::move(game), std::move(on_done)};
+  _unfinished++;
+  _pending_count.fetch_add(1, std::memory_order_relaxed);
+  _workers.submit([this, g] { _play(g); });
+  return id;
+}
+
+void plugin_engine::_notify(event e) {
+  _events.push(std::move(e));
+  native::eventfd_write((int)_events_ready, 1);
+}
+
+void plugin_engine::cancel() {
+  _cancel_before = _next_id;
+  std::lock_guard lock{_players_mutex};
+  for (auto &[id, pid] : _players) {
+    kill_game(pid);
+  }
+}
+
+bool plugin_engine::cancel(game_id id) {
+  std::lock_guard lock{_players_mutex};
+  _cancelled.insert(id);
+  bool running = false;
+  for (auto &[game, pid] : _players) {
+    if (game == id) {
+      kill_game(pid);
+      running = true;
+    }
+  }
+  return running;
+}
+
+bool plugin_engine::_is_cancelled(game_id id) const {
+  return id < _cancel_before || _cancelled.contains(id);
+}
+
+void plugin_engine::_play(pending_game *g) {
+  _pending_count.fetch_sub(1, std::memory_order_relaxed);
+  // The plugin writes to players that may have died. SIGPIPE is blocked in
+  // the workers rather than ignored, which would change it for the program.
+  sigset_t pipe;
+  native::sigemptyset(&pipe);
+  native::sigaddset(&pipe, SIGPIPE);
+  native::pthread_sigmask(SIG_BLOCK, &pipe, nullptr);
+  if (_stopping) {
+    delete g;
+    return;
+  }
+  bool cancelled;
+  {
+    std::lock_guard lock{_players_mutex};
+    cancelled = _is_cancelled(g->id);
+  }
+  if (cancelled) {
+    event e{.type = event::kind::finished, .game = g};
+    e.cancelled = true;
+    e.launched = false;
+    _notify(std::move(e));
+    return;
+  }
+  _notify(event{.type = event::kind::launched, .game = g});
+
+  auto started = monotonic_now();
+  process_t players[2] = {_launch(g->game, g->id, 0),
+                          _launch(g->game, g->id, 1)};
+  {
+    std::lock_guard lock{_players_mutex};
+    // Cancelled while the players were starting
+    const bool cancelled = _is_cancelled(g->id);
+    for (auto &p : players) {
+      _players.emplace_back(g->id, p.pid);
+      track_game(p.pid);
+      if (cancelled) {
+        kill_game(p.pid);
+      }
+    }
+  }
+  cg_referee_game game{
+      .player_input = {(int)players[0].stdin, (int)players[1].stdin},
+      .player_output = {(int)players[0].stdout, (int)players[1].stdout},
+      .seed = g->game.seed.empty() ? nullptr : g->game.seed.c_str(),
+      .log_file =
+          g->game.output_file.empty() ? nullptr : g->game.output_file.c_str(),
+  };
+  cg_referee_result played{};
+  int status = _referee.play(game, played);
+  auto finished = monotonic_now();
+
+  event e{.type = event::kind::finished, .game = g};
+  e.result.output_file = g->game.output_file;
+  e.result.duration = finished - started;
+  if (status == 0) {
+    e.result.p1_score = played.scores[0];
+    e.result.p2_score = played.scores[1];
+    played.seed[sizeof(played.seed) - 1] = '\0';
+    e.result.seed = played.seed;
+  } else {
+    e.result.p1_score = e.result.p2_score = -1;
+    e.result.seed = g->game.seed;
+  }
+
+  {
+    std::lock_guard lock{_players_mutex};
+    std::erase_if(_players, [g](auto &p) { return p.first == g->id; });
+    e.cancelled = _is_cancelled(g->id);
+  }
+
+  // The game is over, whether the players agree or not
+  for (auto &p : players) {
+    native::close((int)p.stdout);
+    native::close((int)p.stdin);
+    native::close((int)p.stderr);
+    kill_game(p.pid);
+    int wstatus;
+    struct rusage usage {};
+    native::wait4((int)p.pid, &wstatus, 0, &usage);
+    untrack_game(p.pid);
+    add_usage(e.usage, usage);
+  }
+  _notify(std::move(e));
+}
+
+size_t plugin_engine::poll(std::chrono::milliseconds timeout) {
+  dpsg::posix::pollfd ready{_events_ready, poll_event_t::read_ready};
+  auto r = ::dpsg::posix::poll(std::span{&ready, 1}, timeout);
+  if (r.is_error()) {
+    auto e = r.error();
+    if (e == poll_error::interrupted || e == poll_error::again) {
+      return 0;
+    }
+    perror("Poll failed");
+    exit(1);
+  }
+  if (ready.revents != 0) {
+    eventfd_t count;
+    native::eventfd_read((int)_events_ready, &count);
+  }
+
+  size_t finished = 0;
+  while (auto e = _events.pop()) {
+    if (e->type == event::kind::launched) {
+      if (_on_launch) {
+        _on_launch(e->game->id, e->game->game);
+      }
+      continue;
+    }
+    std::unique_ptr<pending_game> game{e->game};
+    _unfinished--;
+    if (e->cancelled) {
+      std::lock_guard lock{_players_mutex};
+      _cancelled.erase(game->id);
+    }
+    if (!e->cancelled) {
+      finished++;
+      aggregate(e->result, _statistics);
+      if (game->on_done) {
+        game->on_done(game->id, game->game, e->result);
+      }
+    }
+    if (_on_exit && e->launched) {
+      _on_exit(game->id, e->usage);
+    }
+  }
+  return finished;
+}
+
+void plugin_engine::run() {
+  while (!idle()) {
+    poll();
+  }
+}
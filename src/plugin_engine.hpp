@@ -0,0 +1,136 @@
+#ifndef HEADER_GUARD_DPSG_PLUGIN_ENGINE_HPP
+#define HEADER_GUARD_DPSG_PLUGIN_ENGINE_HPP
+
+#include "engine.hpp"
+#include "mpsc_queue.hpp"
+#include "referee_plugin.h"
+#include "statistics.hpp"
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <unordered_set>
+
+// Referee loaded from a shared object implementing referee_plugin.h.
+// Exits the program when the library can't be loaded.
+class referee_plugin {
+public:
+  explicit referee_plugin(const std::string &path);
+  referee_plugin(const referee_plugin &) = delete;
+  referee_plugin &operator=(const referee_plugin &) = delete;
+  ~referee_plugin();
+
+  // Whether `referee` designates a plugin rather than a jar
+  static bool is_plugin(std::string_view referee) {
+    return referee.ends_with(".so");
+  }
+
+  int play(const cg_referee_game &game, cg_referee_result &result) const {
+    return _play(_state, &game, &result);
+  }
+
+private:
+  void *_library;
+  void *_state;
+  decltype(&cg_referee_play) _play;
+  decltype(&cg_referee_shutdown) _shutdown;
+};
+
+// Same interface as `engine`, playing games with a referee plugin. Each slot is
+// a worker thread calling the plugin, only the players being child processes.
+// Callbacks run on the thread calling `poll`, `on_exit` receiving the resource
+// usage of both players.
+class plugin_engine {
+public:
+  using callback = engine::callback;
+  // Starts player 0 or 1 of a game. Called from the worker threads.
+  using player_launcher =
+      std::function<dpsg::posix::process_t(const game_t &, game_id, int)>;
+
+  plugin_engine(int slot_count, const referee_plugin &referee,
+                player_launcher launch);
+  plugin_engine(const plugin_engine &) = delete;
+  plugin_engine &operator=(const plugin_engine &) = delete;
+  ~plugin_engine();
+
+  game_id submit(game_t game, callback on_done);
+
+  void on_launch(std::function<void(game_id, const game_t &)> f) {
+    _on_launch = std::move(f);
+  }
+  void on_exit(std::function<void(game_id, const struct rusage &)> f) {
+    _on_exit = std::move(f);
+  }
+
+  size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+  void run();
+
+  // Drops the pending games and kills the players of the games in flight,
+  // which the plugin then reports as errors. Neither get their completion
+  // callbacks.
+  void cancel();
+  // Same for game `id` alone. Returns whether its players were running, its
+  // usage then going through `on_exit`.
+  bool cancel(game_id id);
+
+  size_t pending() const { return _pending_count.load(std::memory_order_relaxed); }
+  size_t in_flight() const { return _unfinished - pending(); }
+  bool idle() const { return _unfinished == 0; }
+  int slot_count() const { return _slot_count; }
+
+  const statistics_t &statistics() const { return _statistics; }
+  void reset_statistics() { _statistics = {}; }
+
+private:
+  struct pending_game {
+    game_id id;
+    game_t game;
+    callback on_done;
+  };
+
+  struct event {
+    enum class kind { launched, finished } type;
+    // Owned by the event once the game finished
+    pending_game *game = nullptr;
+    run_result result{};
+    struct rusage usage {};
+    bool cancelled = false;
+    // Whether its players were started
+    bool launched = true;
+  };
+
+  void _play(pending_game *game);
+  void _notify(event e);
+  // With _players_mutex held
+  bool _is_cancelled(game_id id) const;
+
+  int _slot_count;
+  const referee_plugin &_referee;
+  player_launcher _launch;
+  std::function<void(game_id, const game_t &)> _on_launch;
+  std::function<void(game_id, const struct rusage &)> _on_exit;
+  std::atomic<size_t> _pending_count = 0;
+  std::atomic<bool> _stopping = false;
+  // Games submitted before the last call to cancel
+  std::atomic<game_id> _cancel_before = 0;
+  // Players of the games in flight, for cancel to kill
+  std::mutex _players_mutex;
+  std::vector<std::pair<game_id, dpsg::posix::pid_t>> _players;
+  // Games cancelled one by one, until their completion is reported
+  std::unordered_set<game_id> _cancelled;
+
+  mpsc_queue<event> _events;
+  dpsg::posix::fd_t _events_ready;
+
+  // Only touched by the thread calling submit and poll
+  game_id _next_id = 0;
+  size_t _unfinished = 0;
+  statistics_t _statistics;
+
+  // Last, so that the workers are done before the rest goes away
+  thread_pool _workers;
+};
+
+#endif // HEADER_GUARD_DPSG_PLUGIN_ENGINE_HPP
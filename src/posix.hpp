@@ -6,18 +6,109 @@
 #include <chrono>
 #include <cstdint>
 #include <cassert>
+#include <ctime>
 #include <vector>
 
 #include "integer_result.hpp"
 
-namespace dpsg::posix {
-namespace native {
+// The C headers are included globally, so that the C++ standard headers
+// relying on them keep working whatever the inclusion order. The functions we
+// use are brought into `native` to distinguish them from our wrappers.
 extern "C" {
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
 #include <sys/poll.h>
+#include <sys/resource.h>
 #include <sys/select.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <unistd.h>
 }
+
+namespace dpsg::posix {
+namespace native {
+using ::accept4;
+using ::bind;
+using ::chdir;
+using ::close;
+using ::connect;
+using ::dlclose;
+using ::dlerror;
+using ::dlopen;
+using ::dlsym;
+using ::dup2;
+using ::epoll_create1;
+using ::epoll_ctl;
+using ::epoll_event;
+using ::epoll_wait;
+using ::eventfd;
+using ::eventfd_read;
+using ::eventfd_write;
+using ::execvp;
+using ::fcntl;
+using ::fork;
+using ::fstat;
+using ::ftruncate;
+using ::gethostname;
+using ::getpid;
+using ::getsockopt;
+using ::getuid;
+using ::inotify_add_watch;
+using ::inotify_event;
+using ::inotify_init1;
+using ::ioctl;
+using ::kill;
+using ::listen;
+using ::lstat;
+using ::madvise;
+using ::memfd_create;
+using ::mkdir;
+using ::mmap;
+using ::munmap;
+using ::open;
+using ::pipe;
+using ::pipe2;
+using ::poll;
+using ::pollfd;
+using ::pread;
+using ::pwrite;
+using ::pthread_sigmask;
+using ::raise;
+using ::read;
+using ::send;
+using ::sendfile;
+using ::setenv;
+using ::setpgid;
+using ::sigaction;
+using ::sigaddset;
+using ::sigemptyset;
+using ::signalfd;
+using ::signalfd_siginfo;
+using ::sockaddr_un;
+using ::socket;
+using ::sigprocmask;
+using ::sigset_t;
+using ::splice;
+using ::ucred;
+using ::setrlimit;
+using ::syscall;
+using ::sysconf;
+using ::unlink;
+using ::wait4;
+using ::waitpid;
+using ::write;
 } // namespace native
 
 enum class pid_t : uint64_t {};
@@ -61,6 +152,23 @@ inline long_err write(fd_t fd, const char *buffer, size_t size) {
   return long_err::from_unknown(native::write((int)fd, buffer, size));
 }
 
+// Moves up to `size` bytes between two file descriptors without copying them
+// to user space. One of them must be a pipe.
+inline long_err splice(fd_t in, fd_t out, size_t size, unsigned flags = 0) {
+  return long_err::from_unknown(
+      native::splice((int)in, nullptr, (int)out, nullptr, size, flags));
+}
+
+inline std::chrono::nanoseconds monotonic_now() {
+  std::timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+// Runs `f` in a child process, which ends with _exit once `f` returns: exit
+// would run the atexit handlers and flush the stdio buffers of the parent, and
+// in a multi-threaded parent, only async-signal-safe functions may be used in
+// the child.
 template <class F> pid_t fork(F &&f) {
 
   volatile int p = native::fork();
@@ -71,9 +179,9 @@ template <class F> pid_t fork(F &&f) {
   case 0:
     if constexpr (std::is_same_v<std::invoke_result_t<F>, void>) {
       f();
-      exit(0);
+      _exit(0);
     } else {
-      exit(f());
+      _exit(f());
     }
   default:
     return (pid_t)p;
@@ -116,11 +224,21 @@ struct process_t {
   }
 };
 
-inline process_t run_external(std::string_view name, const char *const *args) {
+// Starts `args` with its standard streams connected to pipes. Its stderr has
+// to be read or closed, or the child blocks once the pipe is full (see
+// stderr_capture.hpp).
+//
+// `before_exec` is called in the child process, right before it's replaced by
+// the command. It may only use async-signal-safe functions.
+template <class F>
+process_t run_external(std::string_view name, const char *const *args,
+                       F &&before_exec) {
   enum RW { Read = 0, Write = 1 };
   int in[2], err[2], out[2];
+  // Close-on-exec so that games launched concurrently don't inherit each
+  // other's pipes. dup2 clears the flag on the child's standard streams.
   const auto pipe_open = [](int (&x)[2]) {
-    if (native::pipe(x) == -1) {
+    if (native::pipe2(x, O_CLOEXEC) == -1) {
       perror("Pipe opening failed");
       exit(1);
     }
@@ -130,27 +248,31 @@ inline process_t run_external(std::string_view name, const char *const *args) {
   pipe_open(err);
 
   auto p = fork([&]() {
+    // Between fork and exec, errors can only be reported with write
+    const auto fail = [](std::string_view msg) {
+      native::write(STDERR_FILENO, msg.data(), msg.size());
+      _exit(127);
+    };
     // We don't need to write on stdin or read from stdout/stderr
     // ignoring errors as there's nothing to do about them
     native::close(in[Write]);
     native::close(out[Read]);
     native::close(err[Read]);
     if (native::dup2(in[Read], STDIN_FILENO) == -1) {
-      perror("Failed to rebind stdin");
-      exit(1);
+      fail("Failed to rebind stdin\n");
     }
     if (native::dup2(out[Write], STDOUT_FILENO) == -1) {
-      perror("Failed to rebind stdin");
-      exit(1);
+      fail("Failed to rebind stdout\n");
     }
-    if (native::dup2(in[Read], STDIN_FILENO) == -1) {
-      perror("Failed to rebind stdin");
-      exit(1);
+    if (native::dup2(err[Write], STDERR_FILENO) == -1) {
+      fail("Failed to rebind stderr\n");
     }
     native::close(in[Read]);
     native::close(out[Write]);
     native::close(err[Write]);
+    before_exec();
     native::execvp(name.data(), (char **)args);
+    fail("Failed to launch the command\n");
   });
 
   native::close(err[Write]);
@@ -167,6 +289,10 @@ inline process_t run_external(std::string_view name, const char *const *args) {
   return pr;
 }
 
+inline process_t run_external(std::string_view name, const char *const *args) {
+  return run_external(name, args, [] {});
+}
+
 template <size_t BufferSize = 4096>
 struct fd_streambuf : std::basic_streambuf<char> {
 protected:
@@ -221,6 +347,40 @@ struct process_streams : private process_t {
   std::ostream stdin{&stdin_buf};
 };
 
+// Read-only view of a whole file, mapped in memory.
+class mapped_file {
+  const char *_data = nullptr;
+  size_t _size = 0;
+
+public:
+  explicit mapped_file(const char *path) {
+    int fd = native::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      return;
+    }
+    struct stat st;
+    if (native::fstat(fd, &st) == 0 && st.st_size > 0) {
+      void *p = native::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        native::madvise(p, st.st_size, MADV_SEQUENTIAL);
+        _data = static_cast<const char *>(p);
+        _size = st.st_size;
+      }
+    }
+    native::close(fd);
+  }
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+  ~mapped_file() {
+    if (_data != nullptr) {
+      native::munmap(const_cast<char *>(_data), _size);
+    }
+  }
+
+  bool is_open() const { return _data != nullptr; }
+  std::string_view view() const { return {_data, _size}; }
+};
+
 enum class poll_event_t : short {
   write_ready = POLLOUT,
   error_condition = POLLERR,
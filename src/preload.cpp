@@ -0,0 +1,154 @@
+#include "preload.hpp"
+#include "posix.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <set>
+
+using namespace dpsg::posix;
+
+namespace {
+constexpr unsigned seals =
+    F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+
+// Default huge page size, from /proc/meminfo
+uint64_t huge_page_size() {
+  std::ifstream in{"/proc/meminfo"};
+  std::string key;
+  uint64_t kb;
+  while (in >> key) {
+    if (key == "Hugepagesize:" && in >> kb) {
+      return kb << 10;
+    }
+    in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+  }
+  return 2 << 20;
+}
+
+// Copies the file into a hugetlbfs memfd, -1 when no huge pages are available
+int copy_to_huge_pages(int source, const std::string &name, uint64_t size) {
+  const int fd = native::memfd_create(
+      name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB);
+  if (fd == -1) {
+    return -1;
+  }
+  const uint64_t page = huge_page_size();
+  const uint64_t mapped_size = (size + page - 1) / page * page;
+  // The pages are reserved by mmap, rather than failing when touched
+  void *data = native::ftruncate(fd, (off_t)mapped_size) == -1
+                   ? MAP_FAILED
+                   : native::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    native::close(fd);
+    return -1;
+  }
+  uint64_t copied = 0;
+  while (copied < size) {
+    auto n = native::pread(source, (char *)data + copied, size - copied,
+                           (off_t)copied);
+    if (n <= 0) {
+      if (n == -1 && errno == EINTR) {
+        continue;
+      }
+      perror("Failed to read a preloaded file");
+      exit(1);
+    }
+    copied += (uint64_t)n;
+  }
+  // Write seals need the writable mapping gone
+  native::munmap(data, mapped_size);
+  return fd;
+}
+
+int copy_to_memfd(int source, const std::string &name, uint64_t size) {
+  const int fd =
+      native::memfd_create(name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd == -1) {
+    perror("Failed to create a memfd");
+    exit(1);
+  }
+  off_t offset = 0;
+  while ((uint64_t)offset < size) {
+    auto n = native::sendfile(fd, source, &offset, size - (uint64_t)offset);
+    if (n <= 0) {
+      if (n == -1 && errno == EINTR) {
+        continue;
+      }
+      perror("Failed to read a preloaded file");
+      exit(1);
+    }
+  }
+  return fd;
+}
+} // namespace
+
+preloaded_data::preloaded_data(const std::vector<std::string_view> &paths,
+                               bool huge_pages) {
+  const std::string fd_directory =
+      "/proc/" + std::to_string((uint64_t)dpsg::posix::getpid()) + "/fd/";
+  std::set<std::string> names;
+  bool warned = false;
+
+  for (auto path : paths) {
+    file f;
+    f.name = std::filesystem::path{path}.filename().string();
+    if (f.name.find_first_of(":=") != std::string::npos) {
+      std::cerr << "--preload: the name of " << path
+                << " can't hold ':' nor '='" << std::endl;
+      exit(1);
+    }
+    if (!names.insert(f.name).second) {
+      std::cerr << "--preload: two files named " << f.name << std::endl;
+      exit(1);
+    }
+
+    const int source = native::open(std::string{path}.c_str(),
+                                    O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (source == -1 || native::fstat(source, &st) == -1) {
+      std::cerr << "Cannot read " << path << ": " << std::strerror(errno)
+                << std::endl;
+      exit(1);
+    }
+    f.size = (uint64_t)st.st_size;
+
+    if (huge_pages) {
+      f.fd = copy_to_huge_pages(source, f.name, f.size);
+      f.huge_pages = f.fd != -1;
+      if (!f.huge_pages && !warned) {
+        std::cerr << "Not enough huge pages for " << path
+                  << " (see vm.nr_hugepages), using normal pages" << std::endl;
+        warned = true;
+      }
+    }
+    if (f.fd == -1) {
+      f.fd = copy_to_memfd(source, f.name, f.size);
+    }
+    native::close(source);
+
+    if (native::fcntl(f.fd, F_ADD_SEALS, seals) == -1) {
+      perror("Failed to seal a preloaded file");
+      exit(1);
+    }
+
+    if (!_environment.empty()) {
+      _environment += ':';
+    }
+    _environment += f.name + '=' + fd_directory + std::to_string(f.fd) + ',' +
+                    std::to_string(f.size);
+    _files.push_back(std::move(f));
+  }
+
+  // Inherited by the referees, which pass it on to the players
+  native::setenv(variable, _environment.c_str(), 1);
+}
+
+preloaded_data::~preloaded_data() {
+  for (auto &f : _files) {
+    native::close(f.fd);
+  }
+}
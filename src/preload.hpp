@@ -0,0 +1,51 @@
+#ifndef HEADER_GUARD_DPSG_PRELOAD_HPP
+#define HEADER_GUARD_DPSG_PRELOAD_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Data files the bots load at startup (opening books, weights...), read once
+// into sealed memfds that every player of every game maps instead of reading
+// and parsing its own copy (--preload).
+//
+// The referee doesn't pass descriptors on to the players (the JVM closes them
+// when starting processes), but it passes the environment: the files are
+// listed in `CG_PRELOAD`, as `<file name>=/proc/<runner pid>/fd/<n>,<size>`
+// entries separated by ':'. A bot opens the path read-only and maps `size`
+// bytes of it with MAP_SHARED, all of them then sharing the same physical
+// pages. The memfds are sealed against writes, shrinking and growing.
+//
+// With huge pages, the memfds come from hugetlbfs, which needs pages reserved
+// beforehand (vm.nr_hugepages), and their size is rounded up to a huge page,
+// zero padded: the size of the entry is the one of the file, not of the
+// memfd. Files that don't fit fall back to normal pages.
+class preloaded_data {
+public:
+  constexpr static inline const char *variable = "CG_PRELOAD";
+
+  struct file {
+    std::string name;
+    int fd = -1;
+    uint64_t size = 0;
+    bool huge_pages = false;
+  };
+
+  // Exits the program when a file can't be preloaded. Sets `CG_PRELOAD`.
+  preloaded_data(const std::vector<std::string_view> &paths, bool huge_pages);
+  preloaded_data(const preloaded_data &) = delete;
+  preloaded_data &operator=(const preloaded_data &) = delete;
+  ~preloaded_data();
+
+  const std::vector<file> &files() const { return _files; }
+  // Value of `CG_PRELOAD`
+  const std::string &environment() const { return _environment; }
+
+private:
+  std::vector<file> _files;
+  std::string _environment;
+};
+
+#endif // HEADER_GUARD_DPSG_PRELOAD_HPP
@@ -2,6 +2,7 @@
 #define HEADER_GUARD_DPSG_PRESENTATION_HPP
 
 #include "vt100.hpp"
+#include <chrono>
 #include <vector>
 
 constexpr int digitnum(auto x) {
@@ -32,6 +33,9 @@ public:
   }
   ~presenter() { _out << dpsg::vt100::show_cursor << std::endl; }
 
+  // Clears the screen for a new run
+  void reset_screen() { _out << dpsg::vt100::clear << std::flush; }
+
 private:
   constexpr static inline auto p1_color = dpsg::vt100::yellow;
   constexpr static inline auto p2_color = dpsg::vt100::cyan;
@@ -61,12 +65,36 @@ public:
   void update_header(int run_count);
   void update_result(int run_count, const struct run_result &result,
                     const struct statistics_t &stats);
-  void print_summary(const struct statistics_t &stats, const std::vector<run_result> &results);
+  void print_summary(const struct statistics_t &stats,
+                     const class result_store &results);
+  // Same for results tallied as they were read (runner merge)
+  void print_summary(const struct statistics_t &stats,
+                     const class result_tally &results);
   void update_statistics(const struct statistics_t &stats);
+  void update_throughput(const struct throughput_statistics &speed,
+                         const struct statistics_t &stats, size_t in_flight,
+                         int slot_count, std::chrono::nanoseconds now);
+  void print_bootstrap(const struct bootstrap_summary &bootstrap);
+  void print_latency(const struct latency_statistics &latencies);
+  void print_log_statistics(const struct log_statistics &logs);
+  void print_kept_logs(const struct kept_logs &kept);
+  void print_resources(const struct resource_statistics &resources);
+  void print_profile(const struct profile_report &profile);
+  void print_class_data(const struct class_data_statistics &startup);
+  void print_budget(int64_t budget_seconds, size_t cancelled, bool killed,
+                    const struct statistics_t &stats, double elapsed_seconds);
+  void print_watching();
+  void print_schedule(const struct launch_plan &plan, double makespan_ms);
+  void print_stderr_tails(const std::vector<struct stderr_tail> &tails,
+                          size_t overflow);
 
 private:
   void print_statistics(const struct statistics_t &stats);
   void print_result(const struct run_result &result);
+  // Both summaries, `Results` being a result_store or a result_tally
+  template <class Results>
+  void print_results(const struct statistics_t &stats, const Results &results);
+  template <class Results> void print_histogram(const Results &results);
 };
 
 #endif // HEADER_GUARD_DPSG_PRESENTATION_HPP
@@ -1,8 +1,20 @@
 #include "presentation.hpp"
+#include "bootstrap.hpp"
+#include "cgroup.hpp"
+#include "class_data.hpp"
+#include "game_log.hpp"
+#include "latency.hpp"
+#include "profiler.hpp"
+#include "result_store.hpp"
+#include "schedule.hpp"
+#include "scratch_logs.hpp"
 #include "statistics.hpp"
+#include "stderr_capture.hpp"
+#include "throughput.hpp"
 #include <cmath>
+#include <algorithm>
 #include <iomanip>
-#include <span>
+#include <sstream>
 
 void presenter::update_header(int run_count) {
   using namespace dpsg::vt100;
@@ -23,9 +35,11 @@ void presenter::print_statistics(const statistics_t &stats) {
   const auto s4 = std::setw(4);
 
   // Go after the list of runs
-  _out << comment_color << "Games played:" << s4 << stats.run_games() << " / "
-       << s4 << stats.total_games << " (remaining:" << s4 << stats.left_to_run()
-       << ") ";
+  _out << comment_color << "Games played:" << s4 << stats.run_games() << ' ';
+  if (stats.bounded()) {
+    _out << "/ " << s4 << stats.total_games << " (remaining:" << s4
+         << stats.left_to_run() << ") ";
+  }
 
   if (stats.errors() > 0) {
     _out << (bold | red) << "Errors:" << s4 << stats.errors() << ' ';
@@ -106,6 +120,69 @@ void presenter::update_statistics(const statistics_t &stats) {
   print_statistics(stats);
 }
 
+void presenter::update_throughput(const throughput_statistics &speed,
+                                  const statistics_t &stats, size_t in_flight,
+                                  int slot_count, std::chrono::nanoseconds now) {
+  using namespace dpsg::vt100;
+  constexpr const char *bars[] = {" ", "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+  const auto duration = [](double ms) {
+    std::ostringstream s;
+    s.precision(3);
+    if (ms < 1000) {
+      s << ms << "ms";
+    } else if (ms < 60000) {
+      s << ms / 1000 << 's';
+    } else {
+      auto total = (long)(ms / 1000);
+      s << total / 60 << 'm' << std::setw(2) << std::setfill('0') << total % 60
+        << 's';
+    }
+    return s.str();
+  };
+
+  // Below the statistics
+  _out << set_cursor(std::min(stats.total_games, LINE_NB) + 5, 2);
+  _out.precision(3);
+  _out << comment_color << "Speed: " << reset << speed.rate() << comment_color
+       << " games/s (avg " << reset << speed.average_rate() << comment_color
+       << ')';
+  if (stats.bounded()) {
+    _out << " | ETA " << reset
+         << duration(1000 * speed.eta_seconds(stats.left_to_run(), slot_count))
+         << comment_color;
+  }
+  _out << " | Slots: " << reset << in_flight << '/'
+       << slot_count << comment_color << " busy ("
+       << (int)(100 * speed.occupancy(now, slot_count)) << "% overall)"
+       << reset << clear_line(clear_mode::from_cursor) << std::endl;
+
+  int first = 0;
+  int last = throughput_statistics::bucket_count - 1;
+  while (first < last && speed.buckets[first] == 0) {
+    first++;
+  }
+  while (last > first && speed.buckets[last] == 0) {
+    last--;
+  }
+  const auto highest =
+      *std::max_element(speed.buckets.begin(), speed.buckets.end());
+  _out << ' ' << comment_color << "Game duration: "
+       << duration(first == 0 ? 0 : throughput_statistics::bucket_upper_ms(first - 1))
+       << ' ' << reset;
+  for (int b = first; b <= last && highest > 0; ++b) {
+    _out << bars[(speed.buckets[b] * 8 + highest - 1) / highest];
+  }
+  _out << comment_color << ' '
+       << duration(throughput_statistics::bucket_upper_ms(last))
+       << " | p50 " << reset << duration(speed.duration_quantile_ms(0.5))
+       << comment_color << " p90 " << reset
+       << duration(speed.duration_quantile_ms(0.9)) << comment_color
+       << " | recent " << reset << duration(speed.duration_ewma_ms)
+       << comment_color << " vs " << reset << duration(speed.mean_duration_ms())
+       << comment_color << " overall" << reset
+       << clear_line(clear_mode::from_cursor) << std::flush;
+}
+
 void presenter::print_result(const run_result &result) {
   using namespace dpsg::vt100;
   if (result.has_error(run_result::error::both_error)) {
@@ -129,71 +206,291 @@ void presenter::print_result(const run_result &result) {
 }
 
 void presenter::print_summary(const struct statistics_t &stats,
-                              const std::vector<run_result> &results) {
+                              const result_store &results) {
+  print_results(stats, results);
+}
+
+void presenter::print_summary(const struct statistics_t &stats,
+                              const result_tally &results) {
+  print_results(stats, results);
+}
+
+template <class Results>
+void presenter::print_results(const struct statistics_t &stats,
+                              const Results &results) {
   using namespace dpsg::vt100;
-  _out << set_cursor(std::min(LINE_NB, stats.total_games) + 6, 0);
+  _out << set_cursor(std::min(LINE_NB, stats.total_games) + 8, 0);
 
-  std::vector<std::string> p1_errors, p2_errors;
-  double point_difference_avg[2] = {0, 0};
-  std::vector<int> scores[2]{};
+  const auto summary = results.summarize();
 
-  for (int i = 0; i < stats.run_games(); ++i) {
-    auto &result = results[i];
-    if (result.has_error(run_result::error::p1_error)) {
-      p1_errors.push_back(result.seed);
-    }
-    if (result.has_error(run_result::error::p2_error)) {
-      p2_errors.push_back(result.seed);
+  for (int x = 0; x < 2; ++x) {
+    if (summary.errors[x] == 0) {
+      continue;
     }
-
-    if (!result.has_error()) {
-      if (result.winner() == run_result::winner::p1) {
-        auto score = result.p1_score - result.p2_score;
-        point_difference_avg[0] = statistics_t::moving_average(
-            point_difference_avg[0], score, scores[0].size());
-        scores[0].push_back(score);
-      } else if (result.winner() == run_result::winner::p2) {
-        auto score = result.p2_score - result.p1_score;
-        point_difference_avg[1] = statistics_t::moving_average(
-            point_difference_avg[1], score, scores[1].size());
-        scores[1].push_back(score);
+    const auto error = x == 0 ? result_store::p1_error : result_store::p2_error;
+    _out << "Player " << (x + 1) << " error seeds (" << summary.errors[x]
+         << "): [";
+    bool first = true;
+    const auto seeds = results.error_seeds(error);
+    for (auto seed : seeds) {
+      if (!first) {
+        _out << ", ";
       }
+      first = false;
+      _out << red << seed << reset;
+    }
+    if (seeds.size() < summary.errors[x]) {
+      _out << ", " << summary.errors[x] - seeds.size() << " more";
     }
+    _out << "]" << std::endl;
   }
 
-  double deviation[2] = {
-      statistics_t::standard_deviation(std::span{scores[0]},
-                                       point_difference_avg[0]),
-      statistics_t::standard_deviation(std::span{scores[1]},
-                                       point_difference_avg[1]),
+  const auto format_double = [](double d) -> std::string {
+    if (std::isnan(d)) {
+      return "-";
+    }
+    std::ostringstream s;
+    s.precision(3);
+    s << d;
+    return s.str();
   };
 
-  if (p1_errors.size() > 0) {
-    _out << "Player 1 error seeds (" << p1_errors.size() << "): [";
-    for (size_t s = 0; s < p1_errors.size(); ++s) {
-      if (s != 0) {
-        _out << ", ";
-      }
-      _out << red << p1_errors[s] << reset;
+  _out << "Player 1 point difference average: " << p1_color << std::setw(6)
+       << format_double(summary.point_difference_avg[0]) << white
+       << "  standard deviation: " << p1_color
+       << format_double(summary.point_difference_deviation[0]) << white
+       << std::endl;
+  _out << "Player 2 point difference average: " << p2_color << std::setw(6)
+       << format_double(summary.point_difference_avg[1]) << white
+       << "  standard deviation: " << p2_color
+       << format_double(summary.point_difference_deviation[1]) << white
+       << std::endl;
+
+  print_histogram(results);
+}
+
+void presenter::print_bootstrap(const bootstrap_summary &b) {
+  using namespace dpsg::vt100;
+  if (b.units == 0) {
+    return;
+  }
+  const auto number = [](double x, bool sign) {
+    std::ostringstream s;
+    s.precision(3);
+    s << (sign ? std::showpos : std::noshowpos) << x;
+    return s.str();
+  };
+  const auto print = [&](const char *label, const bootstrap_interval &i,
+                         double scale, bool sign) {
+    _out << label << p1_color << number(i.estimate * scale, sign) << reset
+         << " [" << number(i.low * scale, sign) << ", "
+         << number(i.high * scale, sign) << ']';
+  };
+
+  print("Player 1 score: ", b.p1_score, 100, false);
+  _out << "%";
+  print("  Elo: ", b.elo, 1, true);
+  if (!std::isnan(b.point_difference.estimate)) {
+    print("  point difference: ", b.point_difference, 1, true);
+  }
+  _out << comment_color << " (" << number(100 * b.confidence, false)
+       << "% BCa, "
+       << b.resamples << " resamples of " << b.units
+       << (b.paired ? " seeds)" : " games)") << reset << std::endl;
+}
+
+template <class Results>
+void presenter::print_histogram(const Results &results) {
+  using namespace dpsg::vt100;
+  constexpr int buckets = 21;
+  constexpr const char *bars[] = {" ", "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█"};
+
+  if (results.size() == 0) {
+    return;
+  }
+  const int max_difference = std::max(1, results.max_score_difference());
+  const int width = (2 * max_difference) / buckets + 1;
+  const auto histogram = results.score_difference_histogram(width, buckets);
+  const auto highest = *std::max_element(histogram.begin(), histogram.end());
+  if (highest == 0) {
+    return;
+  }
+
+  _out << "Point difference distribution: " << comment_color
+       << -(buckets / 2) * width << ' ' << p2_color;
+  for (int b = 0; b < buckets; ++b) {
+    if (b == buckets / 2) {
+      _out << white;
+    } else if (b == buckets / 2 + 1) {
+      _out << p1_color;
     }
-    _out << "]" << std::endl;
+    _out << bars[(histogram[b] * 8 + highest - 1) / highest];
   }
-  if (p2_errors.size() > 0) {
-    _out << "Player 2 error seeds (" << p2_errors.size() << "): [";
-    for (size_t s = 0; s < p2_errors.size(); ++s) {
-      if (s != 0) {
-        _out << ", ";
-      }
-      _out << red << p2_errors[s] << reset;
+  _out << comment_color << ' ' << (buckets / 2) * width << reset << std::endl;
+}
+
+void presenter::print_latency(const latency_statistics &latencies) {
+  using namespace dpsg::vt100;
+  const auto ms = [](uint32_t us) { return (double)us / 1000.0; };
+  const auto print = [&](const char *label,
+                         const latency_statistics::percentiles &p) {
+    _out << comment_color << label << reset << "p50 " << std::setw(7)
+         << ms(p.p50) << "  p99 " << std::setw(7) << ms(p.p99) << "  max "
+         << std::setw(7) << ms(p.max) << comment_color << " (" << p.count
+         << " turns)" << reset;
+  };
+
+  _out.precision(3);
+  for (int x = 0; x < 2; ++x) {
+    _out << (x == 0 ? p1_color : p2_color) << "Player " << (x + 1)
+         << " response time (ms): " << reset;
+    print("first turn ",
+          latency_statistics::compute(latencies.first_turn[x]));
+    print(" | other turns ", latency_statistics::compute(latencies.turns[x]));
+    _out << std::endl;
+  }
+}
+
+void presenter::print_log_statistics(const log_statistics &logs) {
+  ::print_log_statistics(_out, logs);
+}
+
+void presenter::print_kept_logs(const kept_logs &kept) {
+  using namespace dpsg::vt100;
+  constexpr const char *names[] = {"errors", "timeouts", "draws", "extreme",
+                                   "sampled"};
+  _out << "Game logs: kept " << kept.kept << " of " << kept.games;
+  const char *separator = " (";
+  for (int r = 0; r < kept_logs::reason_count; ++r) {
+    if (kept.reasons[r] > 0) {
+      _out << separator << names[r] << ' ' << kept.reasons[r];
+      separator = ", ";
     }
-    _out << "]" << std::endl;
   }
+  _out << (kept.kept > 0 ? ")" : "") << std::endl;
+}
+
+void presenter::print_resources(const resource_statistics &resources) {
+  using namespace dpsg::vt100;
+  if (resources.games == 0) {
+    return;
+  }
+  const auto n = (double)resources.games;
+  const auto ms = [](double us) { return us / 1000.0; };
+  const auto mib = [](double bytes) { return bytes / (1 << 20); };
+
+  _out.precision(4);
+  _out << "CPU per game: avg " << ms((double)resources.cpu_usec_total / n)
+       << "ms, max " << ms((double)resources.cpu_usec_max)
+       << "ms. Memory peak: avg " << mib((double)resources.memory_peak_total / n)
+       << "MiB, max " << mib((double)resources.memory_peak_max) << "MiB";
+  if (resources.from_cgroups) {
+    _out << comment_color << " (cgroup)" << reset << std::endl;
+  } else {
+    _out << comment_color
+         << " (getrusage: largest process only. cgroup v2 unavailable, only "
+            "the memory limit was applied, to each bot)"
+         << reset << std::endl;
+  }
+}
+
+void presenter::print_profile(const profile_report &profile) {
+  using namespace dpsg::vt100;
+  _out << "Profile: ";
+  for (int player = 0; player < 2; ++player) {
+    _out << (player == 0 ? "" : ", ") << profile.samples[player]
+         << " samples of player " << player + 1 << " in "
+         << profile.files[player].string();
+  }
+  if (profile.lost > 0) {
+    _out << orange << " (" << profile.lost << " lost)" << reset;
+  }
+  _out << std::endl;
+  if (profile.missed > 0) {
+    _out << orange << profile.missed << " of " << profile.games
+         << " games ended before their players could be sampled" << reset
+         << std::endl;
+  }
+}
+
+void presenter::print_class_data(const class_data_statistics &startup) {
+  using namespace dpsg::vt100;
+  _out.precision(4);
+  _out << "Class data sharing: ";
+  if (startup.games[1] == 0) {
+    _out << "no game used the archive yet" << comment_color << " ("
+         << startup.archive.string() << ", for the next runs)" << reset
+         << std::endl;
+    return;
+  }
+  _out << "games took " << startup.average_ms(true) << "ms on average with the "
+       << "archive (" << startup.games[1] << " games)";
+  if (startup.games[0] > 0) {
+    _out << ", " << startup.average_ms(false) << "ms without ("
+         << startup.games[0] << " games): " << orange
+         << startup.average_ms(false) - startup.average_ms(true)
+         << "ms saved per game" << reset;
+  } else {
+    _out << comment_color << ", run with --no-cds for a comparison" << reset;
+  }
+  _out << std::endl;
+}
 
+void presenter::print_budget(int64_t budget_seconds, size_t cancelled,
+                             bool killed, const statistics_t &stats,
+                             double elapsed_seconds) {
+  using namespace dpsg::vt100;
+  const auto [low, high] = stats.p1_score_interval();
   _out.precision(3);
-  _out << "Player 1 point difference average: " << p1_color << std::setw(6)
-       << point_difference_avg[0] << white
-       << "  standard deviation: " << p1_color << deviation[0] << white << std::endl;
-  _out << "Player 2 point difference average: " << p2_color << std::setw(6)
-       << point_difference_avg[1] << white
-       << "  standard deviation: " << p2_color << deviation[1] << white << std::endl;
+  _out << "Budget: " << stats.run_games() << " games in " << elapsed_seconds
+       << "s of " << budget_seconds << 's';
+  if (cancelled > 0) {
+    _out << " (" << cancelled << (killed ? " killed" : " cancelled")
+         << " at the deadline)";
+  }
+  _out << ", player 1 scored " << p1_color << 100 * stats.p1_score_share()
+       << '%' << reset << comment_color << " (95% interval " << 100 * low
+       << "% to " << 100 * high << "%, ±" << 50 * (high - low) << "%)" << reset
+       << std::endl;
+}
+
+void presenter::print_watching() {
+  using namespace dpsg::vt100;
+  _out << comment_color << "Waiting for a player to change..." << reset
+       << std::endl;
+}
+
+void presenter::print_schedule(const launch_plan &plan, double makespan_ms) {
+  using namespace dpsg::vt100;
+  _out.precision(3);
+  _out << "Schedule: longest games first, expected to end after "
+       << plan.makespan_ms / 1000 << "s (" << plan.unordered_makespan_ms / 1000
+       << "s in seed order), took " << makespan_ms / 1000 << 's' << std::endl;
+}
+
+void presenter::print_stderr_tails(const std::vector<stderr_tail> &tails,
+                                   size_t overflow) {
+  using namespace dpsg::vt100;
+  for (auto &t : tails) {
+    _out << red << t.label << reset << " stderr";
+    if (t.dropped > 0) {
+      _out << comment_color << " (" << t.dropped << " bytes dropped)" << reset;
+    }
+    _out << ":\n" << faint;
+    if (t.text.empty()) {
+      _out << "  (empty)\n";
+    }
+    std::string_view text = t.text;
+    while (!text.empty()) {
+      auto newline = text.find('\n');
+      _out << "  " << text.substr(0, newline) << '\n';
+      text = newline == std::string_view::npos ? "" : text.substr(newline + 1);
+    }
+    _out << reset;
+  }
+  if (overflow > 0) {
+    _out << comment_color << "stderr of " << overflow
+         << " more failed games not shown" << reset << '\n';
+  }
+  _out.flush();
 }
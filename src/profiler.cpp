@@ -0,0 +1,534 @@
+#include "profiler.hpp"
+#include "hash.hpp"
+#include "symbols.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <linux/perf_event.h>
+
+using namespace dpsg::posix;
+
+namespace {
+namespace fs = std::filesystem;
+
+// Frames outside of any known mapping
+constexpr uint32_t unknown_module = (1u << 24) - 1;
+constexpr int module_shift = 40;
+
+std::string read_file(const fs::path &path) {
+  std::ifstream in{path};
+  std::ostringstream s;
+  s << in.rdbuf();
+  return s.str();
+}
+
+fs::path proc(uint32_t pid) { return fs::path{"/proc"} / std::to_string(pid); }
+
+// Arguments separated by single spaces, as the referee splitting a command on
+// whitespace passes them
+std::string normalize(std::string_view command) {
+  std::istringstream s{std::string{command}};
+  std::string result, argument;
+  while (s >> argument) {
+    if (!result.empty()) {
+      result += ' ';
+    }
+    result += argument;
+  }
+  return result;
+}
+
+std::string command_line(uint32_t pid) {
+  auto arguments = read_file(proc(pid) / "cmdline");
+  std::replace(arguments.begin(), arguments.end(), '\0', ' ');
+  return normalize(arguments);
+}
+
+int perf_event_open(uint32_t tid) {
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_SOFTWARE;
+  attr.config = PERF_COUNT_SW_TASK_CLOCK;
+  attr.freq = 1;
+  attr.sample_freq = player_profiler::frequency;
+  attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.exclude_callchain_kernel = 1;
+  // New mappings of executables and libraries, new tasks and exec are
+  // reported along with the samples
+  attr.mmap = 1;
+  attr.mmap2 = 1;
+  attr.comm = 1;
+  attr.comm_exec = 1;
+  attr.task = 1;
+  return (int)native::syscall(SYS_perf_event_open, &attr, (int)tid, -1, -1,
+                              PERF_FLAG_FD_CLOEXEC);
+}
+
+template <class T> T load(const char *record, size_t offset) {
+  T value;
+  std::memcpy(&value, record + offset, sizeof(T));
+  return value;
+}
+
+// Replaces what `m` covers in `maps`, keeping them sorted
+template <class Mapping>
+void insert(std::vector<Mapping> &maps, const Mapping &m) {
+  std::erase_if(maps,
+                [&](auto &o) { return o.start < m.end && m.start < o.end; });
+  maps.insert(std::upper_bound(
+                  maps.begin(), maps.end(), m,
+                  [](auto &a, auto &b) { return a.start < b.start; }),
+              m);
+}
+} // namespace
+
+size_t player_profiler::stack_hash::operator()(
+    const std::vector<uint64_t> &frames) const {
+  return dpsg::fnv1a({reinterpret_cast<const char *>(frames.data()),
+                      frames.size() * sizeof(uint64_t)});
+}
+
+player_profiler::player_profiler(std::filesystem::path directory)
+    : _directory(std::move(directory)),
+      _page_size((size_t)native::sysconf(_SC_PAGESIZE)) {
+  std::filesystem::create_directories(_directory);
+  // Fails early rather than with the first game when sampling isn't allowed
+  int probe = perf_event_open((uint32_t)native::getpid());
+  if (probe == -1) {
+    perror("Failed to open a perf event (see "
+           "/proc/sys/kernel/perf_event_paranoid)");
+    exit(1);
+  }
+  native::close(probe);
+  _thread = std::thread{[this] { _work(); }};
+}
+
+player_profiler::~player_profiler() {
+  {
+    std::lock_guard lock{_mutex};
+    _stopping = true;
+  }
+  _wakeup.notify_one();
+  _thread.join();
+  for (auto &[id, g] : _games) {
+    for (auto &s : g.sessions) {
+      _close(*s);
+    }
+  }
+}
+
+void player_profiler::watch(game_id id, dpsg::posix::pid_t referee,
+                            const std::array<std::string, 2> &commands,
+                            bool proxied) {
+  std::lock_guard lock{_mutex};
+  auto &g = _games[id];
+  g.referee = (uint32_t)referee;
+  g.commands = {normalize(commands[0]), normalize(commands[1])};
+  g.proxied = proxied;
+}
+
+void player_profiler::attach(game_id id, int player, dpsg::posix::pid_t pid,
+                             bool proxied) {
+  {
+    std::lock_guard lock{_mutex};
+    auto &g = _games[id];
+    g.players[player] = (uint32_t)pid;
+    g.proxied = proxied;
+  }
+  _wakeup.notify_one();
+}
+
+void player_profiler::release(game_id id) {
+  std::lock_guard lock{_mutex};
+  auto it = _games.find(id);
+  if (it == _games.end()) {
+    return;
+  }
+  for (auto &s : it->second.sessions) {
+    _drain(*s);
+    _close(*s);
+  }
+  _released++;
+  if (it->second.sessions.size() < 2) {
+    _missed++;
+  }
+  _games.erase(it);
+}
+
+// All processes, from /proc/<pid>/stat: the children files of the tasks
+// depend on the kernel configuration
+std::vector<player_profiler::process> player_profiler::_scan() {
+  std::vector<process> processes;
+  std::error_code error;
+  for (auto &entry : fs::directory_iterator{"/proc", error}) {
+    const auto name = entry.path().filename().string();
+    if (name.empty() || !std::all_of(name.begin(), name.end(), ::isdigit)) {
+      continue;
+    }
+    const auto stat = read_file(entry.path() / "stat");
+    // The command name, between parentheses, may contain anything
+    const auto end = stat.rfind(')');
+    if (end == std::string::npos) {
+      continue;
+    }
+    std::istringstream fields{stat.substr(end + 1)};
+    std::string state;
+    process p{.pid = (uint32_t)std::stoul(name), .parent = 0, .start = 0};
+    fields >> state >> p.parent;
+    // The start time is the 22nd field, the state the 3rd
+    std::string skipped;
+    for (int i = 0; i < 17 && fields >> skipped; ++i) {
+    }
+    if (fields >> p.start) {
+      processes.push_back(p);
+    }
+  }
+  return processes;
+}
+
+void player_profiler::_work() {
+  std::unique_lock lock{_mutex};
+  while (!_stopping) {
+    const bool searching =
+        std::any_of(_games.begin(), _games.end(), [](auto &g) {
+          return !g.second.attached[0] || !g.second.attached[1];
+        });
+    std::vector<process> processes;
+    if (searching) {
+      lock.unlock();
+      processes = _scan();
+      lock.lock();
+    }
+    for (auto &[id, g] : _games) {
+      _find_players(g, processes);
+      for (int player = 0; player < 2; ++player) {
+        if (g.players[player] != 0 && !g.attached[player]) {
+          _attach(g, player, processes);
+        }
+      }
+      for (auto &s : g.sessions) {
+        _drain(*s);
+      }
+    }
+    _wakeup.wait_for(lock, interval);
+  }
+}
+
+void player_profiler::_find_players(game &g,
+                                    const std::vector<process> &processes) {
+  if (g.referee == 0 || (g.players[0] != 0 && g.players[1] != 0)) {
+    return;
+  }
+  std::vector<process> children;
+  std::copy_if(processes.begin(), processes.end(), std::back_inserter(children),
+               [&](auto &p) {
+                 return p.parent == g.referee && p.pid != g.players[0] &&
+                        p.pid != g.players[1];
+               });
+  std::sort(children.begin(), children.end(), [](auto &a, auto &b) {
+    return std::tie(a.start, a.pid) < std::tie(b.start, b.pid);
+  });
+  for (auto &child : children) {
+    // Until it executes the player, the child runs the referee (or java's
+    // spawn helper). Interpreters started by a shebang come first.
+    const auto command = command_line(child.pid);
+    const auto runs = [&](const std::string &player) {
+      return command == player || command.ends_with(' ' + player);
+    };
+    for (int p = 0; p < 2; ++p) {
+      if (g.players[p] == 0 && runs(g.commands[p])) {
+        g.players[p] = child.pid;
+        break;
+      }
+    }
+  }
+}
+
+void player_profiler::_attach(game &g, int player,
+                              const std::vector<process> &processes) {
+  g.attached[player] = true;
+  auto s = std::make_unique<session>();
+  s->player = player;
+  s->root = g.players[player];
+  s->skip_root = g.proxied;
+
+  // The processes it started already, the next ones are reported
+  std::vector<uint32_t> pids{s->root};
+  for (size_t i = 0; i < pids.size(); ++i) {
+    for (auto &p : processes) {
+      if (p.parent == pids[i]) {
+        pids.push_back(p.pid);
+      }
+    }
+  }
+  for (auto pid : pids) {
+    _open(*s, pid);
+  }
+  // Over before it could be sampled
+  if (s->events.empty()) {
+    return;
+  }
+  g.sessions.push_back(std::move(s));
+}
+
+bool player_profiler::_open(session &s, uint32_t pid) {
+  std::error_code error;
+  for (auto &task : fs::directory_iterator{proc(pid) / "task", error}) {
+    _open_task(s, (uint32_t)std::stoul(task.path().filename().string()));
+  }
+
+  // Mapped before the events were opened: taken from /proc, the next ones are
+  // reported in the buffers
+  std::ifstream maps{proc(pid) / "maps"};
+  std::string line;
+  while (std::getline(maps, line)) {
+    std::istringstream fields{line};
+    std::string range, permissions, device, path;
+    uint64_t offset = 0, inode = 0;
+    fields >> range >> permissions >> std::hex >> offset >> device >>
+        std::dec >> inode;
+    std::getline(fields >> std::ws, path);
+    if (permissions.size() < 3 || permissions[2] != 'x') {
+      continue;
+    }
+    const auto dash = range.find('-');
+    mapping m{
+        .start = std::stoull(range.substr(0, dash), nullptr, 16),
+        .end = std::stoull(range.substr(dash + 1), nullptr, 16),
+        .offset = offset,
+        .module = _module(path.empty() ? "[anon]" : path),
+    };
+    insert(s.maps[pid], m);
+  }
+  return !s.events.empty();
+}
+
+bool player_profiler::_open_task(session &s, uint32_t tid) {
+  if (std::any_of(s.events.begin(), s.events.end(),
+                  [&](auto &e) { return e.tid == tid; })) {
+    return true;
+  }
+  const int fd = perf_event_open(tid);
+  if (fd == -1) {
+    return false;
+  }
+  void *buffer = native::mmap(nullptr, (1 + buffer_pages) * _page_size,
+                              PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (buffer == MAP_FAILED) {
+    native::close(fd);
+    return false;
+  }
+  s.events.push_back({tid, fd, static_cast<char *>(buffer)});
+  return true;
+}
+
+void player_profiler::_drain(session &s) {
+  // Opening the events of new tasks adds to the list
+  for (size_t i = 0; i < s.events.size(); ++i) {
+    _drain(s, s.events[i].buffer);
+  }
+}
+
+void player_profiler::_drain(session &s, char *buffer) {
+  auto *page = reinterpret_cast<perf_event_mmap_page *>(buffer);
+  const char *data = buffer + _page_size;
+  const uint64_t size = buffer_pages * _page_size;
+  const uint64_t head = __atomic_load_n(&page->data_head, __ATOMIC_ACQUIRE);
+  uint64_t tail = page->data_tail;
+
+  while (tail < head) {
+    // Records are 8 bytes aligned, the header never wraps
+    const uint64_t offset = tail % size;
+    const auto header = load<perf_event_header>(data, offset);
+    if (header.size == 0) {
+      break;
+    }
+    const char *record = data + offset;
+    if (offset + header.size > size) {
+      s.record.resize(header.size);
+      const size_t first = size - offset;
+      std::memcpy(s.record.data(), record, first);
+      std::memcpy(s.record.data() + first, data, header.size - first);
+      record = s.record.data();
+    }
+
+    switch (header.type) {
+    case PERF_RECORD_SAMPLE:
+      _sample(s, record);
+      break;
+    case PERF_RECORD_MMAP2: {
+      const auto pid = load<uint32_t>(record, 8);
+      const auto address = load<uint64_t>(record, 16);
+      const auto length = load<uint64_t>(record, 24);
+      const auto prot = load<uint32_t>(record, 64);
+      if (prot & PROT_EXEC) {
+        insert(s.maps[pid],
+               mapping{
+                   .start = address,
+                   .end = address + length,
+                   .offset = load<uint64_t>(record, 32),
+                   .module = _module(record + 72),
+               });
+      }
+      break;
+    }
+    case PERF_RECORD_FORK: {
+      // Inherited events can't be mapped: new tasks get their own. The
+      // mappings of a new process are read once its event is open, in case
+      // it executed something else in between.
+      const auto pid = load<uint32_t>(record, 8);
+      if (pid != load<uint32_t>(record, 12)) {
+        _open(s, pid);
+      } else {
+        _open_task(s, load<uint32_t>(record, 16));
+      }
+      break;
+    }
+    case PERF_RECORD_COMM:
+      if (header.misc & PERF_RECORD_MISC_COMM_EXEC) {
+        s.maps[load<uint32_t>(record, 8)].clear();
+      }
+      break;
+    case PERF_RECORD_EXIT:
+      if (load<uint32_t>(record, 8) == load<uint32_t>(record, 16)) {
+        s.maps.erase(load<uint32_t>(record, 8));
+      }
+      break;
+    case PERF_RECORD_LOST:
+      _lost += load<uint64_t>(record, 16);
+      break;
+    }
+    tail += header.size;
+  }
+  __atomic_store_n(&page->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+void player_profiler::_sample(session &s, const char *record) {
+  const auto pid = load<uint32_t>(record, 8);
+  if (s.skip_root && pid == s.root) {
+    return;
+  }
+  const auto count = load<uint64_t>(record, 16);
+  std::vector<uint64_t> frames;
+  frames.reserve(count);
+  for (uint64_t i = 0; i < count; ++i) {
+    auto ip = load<uint64_t>(record, 24 + i * sizeof(uint64_t));
+    // Markers of the kernel and user parts of the chain
+    if (ip >= PERF_CONTEXT_MAX) {
+      continue;
+    }
+    // Return addresses are after the call, possibly in the next function
+    if (!frames.empty()) {
+      ip--;
+    }
+    frames.push_back(_frame(s, pid, ip));
+  }
+  if (frames.empty()) {
+    frames.push_back((uint64_t)unknown_module << module_shift);
+  }
+  _stacks[s.player][frames]++;
+  _samples[s.player]++;
+}
+
+uint64_t player_profiler::_frame(const session &s, uint32_t pid,
+                                 uint64_t ip) const {
+  auto maps = s.maps.find(pid);
+  if (maps == s.maps.end()) {
+    maps = s.maps.find(s.root);
+  }
+  if (maps != s.maps.end()) {
+    auto it = std::upper_bound(
+        maps->second.begin(), maps->second.end(), ip,
+        [](uint64_t a, const mapping &m) { return a < m.start; });
+    if (it != maps->second.begin() && ip < (--it)->end) {
+      return (uint64_t)it->module << module_shift |
+             (ip - it->start + it->offset);
+    }
+  }
+  return (uint64_t)unknown_module << module_shift;
+}
+
+void player_profiler::_close(session &s) {
+  for (auto &e : s.events) {
+    native::munmap(e.buffer, (1 + buffer_pages) * _page_size);
+    native::close(e.fd);
+  }
+  s.events.clear();
+}
+
+uint32_t player_profiler::_module(const std::string &path) {
+  auto [it, inserted] = _module_ids.emplace(path, (uint32_t)_modules.size());
+  if (inserted) {
+    _modules.push_back(path);
+  }
+  return it->second;
+}
+
+profile_report player_profiler::finish() {
+  std::lock_guard lock{_mutex};
+  std::vector<std::unique_ptr<elf_symbols>> symbols(_modules.size());
+  std::unordered_map<uint64_t, std::string> names;
+  const auto name = [&](uint64_t frame) -> const std::string & {
+    auto [it, inserted] = names.emplace(frame, "");
+    if (!inserted) {
+      return it->second;
+    }
+    const auto module = (uint32_t)(frame >> module_shift);
+    if (module == unknown_module) {
+      return it->second = "[unknown]";
+    }
+    std::string path = _modules[module];
+    if (path.starts_with('[')) {
+      return it->second = path;
+    }
+    if (path.ends_with(" (deleted)")) {
+      path.resize(path.size() - 10);
+    }
+    if (!symbols[module]) {
+      symbols[module] = std::make_unique<elf_symbols>(path);
+    }
+    const auto function = symbols[module]->function_at(
+        frame & (((uint64_t)1 << module_shift) - 1));
+    return it->second = function.empty()
+                            ? '[' + fs::path{path}.filename().string() + ']'
+                            : std::string{function};
+  };
+
+  profile_report r;
+  for (int player = 0; player < 2; ++player) {
+    std::map<std::string, size_t> folded;
+    for (auto &[frames, count] : _stacks[player]) {
+      std::string stack;
+      for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+        if (!stack.empty()) {
+          stack += ';';
+        }
+        stack += name(*it);
+      }
+      folded[stack] += count;
+    }
+    r.files[player] =
+        _directory / ("player" + std::to_string(player + 1) + ".folded");
+    std::ofstream out{r.files[player]};
+    for (auto &[stack, count] : folded) {
+      out << stack << ' ' << count << '\n';
+    }
+    if (!out) {
+      std::cerr << "Failed to write " << r.files[player] << std::endl;
+    }
+    r.samples[player] = _samples[player];
+    _stacks[player].clear();
+    _samples[player] = 0;
+  }
+  r.lost = std::exchange(_lost, 0);
+  r.games = std::exchange(_released, 0);
+  r.missed = std::exchange(_missed, 0);
+  return r;
+}
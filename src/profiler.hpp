@@ -0,0 +1,145 @@
+#ifndef HEADER_GUARD_DPSG_PROFILER_HPP
+#define HEADER_GUARD_DPSG_PROFILER_HPP
+
+#include "engine.hpp"
+#include "posix.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct profile_report {
+  // Folded stacks of each player
+  std::filesystem::path files[2];
+  size_t samples[2] = {0, 0};
+  // Samples dropped by the kernel, the buffers being full
+  size_t lost = 0;
+  size_t games = 0;
+  // Games over before their players could be found
+  size_t missed = 0;
+};
+
+// Where the players spend their CPU time during real games (--profile).
+//
+// Each player process is sampled with perf_event_open (task clock, user space
+// call chains), along with the threads and processes it starts. The players
+// of a java referee are found among its children: by command line, in
+// launch order when both players run the same command. Behind the proxy
+// (latency, --record), only its child is counted.
+//
+// Samples are only mapped to (file, offset) frames while the game runs,
+// symbols are looked up once at the end of the run. The stacks of all games
+// are merged into one file per player, in the folded format of flame graph
+// tools (`frame;frame;...;leaf count` lines).
+class player_profiler {
+public:
+  constexpr static inline int frequency = 999;
+  // Ring buffer of each thread, in pages: about 20 samples come in between
+  // two reads
+  constexpr static inline size_t buffer_pages = 8;
+  // How often the buffers are read and new players looked for
+  constexpr static inline std::chrono::milliseconds interval{20};
+
+  explicit player_profiler(std::filesystem::path directory);
+  player_profiler(const player_profiler &) = delete;
+  player_profiler &operator=(const player_profiler &) = delete;
+  ~player_profiler();
+
+  // The players of game `id` are started by `referee`, with `commands` as
+  // given to it. Thread safe.
+  void watch(game_id id, dpsg::posix::pid_t referee,
+             const std::array<std::string, 2> &commands, bool proxied);
+  // Player `player` (0 or 1) of game `id` is `pid`. Thread safe.
+  void attach(game_id id, int player, dpsg::posix::pid_t pid, bool proxied);
+  // Stops sampling game `id`, once its processes are over. Thread safe.
+  void release(game_id id);
+
+  // Symbolizes the samples of the games released so far and writes them,
+  // starting over for the next ones
+  profile_report finish();
+
+private:
+  struct mapping {
+    uint64_t start;
+    uint64_t end;
+    uint64_t offset;
+    uint32_t module;
+  };
+  // Sampling of one player and the processes it starts
+  struct session {
+    int player;
+    uint32_t root;
+    // The root is the proxy, whose samples aren't the player's
+    bool skip_root;
+    // One per thread: the kernel doesn't map events inherited by new tasks
+    struct event {
+      uint32_t tid;
+      int fd;
+      char *buffer;
+    };
+    std::vector<event> events;
+    // Executable mappings of each process, sorted
+    std::unordered_map<uint32_t, std::vector<mapping>> maps;
+    // A record split by the end of the ring is copied here
+    std::vector<char> record;
+  };
+  struct game {
+    uint32_t referee = 0;
+    std::string referee_command;
+    std::array<std::string, 2> commands;
+    bool proxied = false;
+    // Given by attach, or found among the children of the referee
+    uint32_t players[2] = {0, 0};
+    bool attached[2] = {false, false};
+    std::vector<std::unique_ptr<session>> sessions;
+  };
+  struct process {
+    uint32_t pid;
+    uint32_t parent;
+    uint64_t start;
+  };
+  struct stack_hash {
+    size_t operator()(const std::vector<uint64_t> &frames) const;
+  };
+
+  static std::vector<process> _scan();
+  void _work();
+  void _find_players(game &g, const std::vector<process> &processes);
+  void _attach(game &g, int player, const std::vector<process> &processes);
+  bool _open(session &s, uint32_t pid);
+  bool _open_task(session &s, uint32_t tid);
+  void _drain(session &s);
+  void _drain(session &s, char *buffer);
+  void _sample(session &s, const char *record);
+  void _close(session &s);
+  uint32_t _module(const std::string &path);
+  uint64_t _frame(const session &s, uint32_t pid, uint64_t ip) const;
+
+  std::filesystem::path _directory;
+  size_t _page_size;
+
+  std::mutex _mutex;
+  std::condition_variable _wakeup;
+  std::unordered_map<game_id, game> _games;
+  std::vector<std::string> _modules;
+  std::unordered_map<std::string, uint32_t> _module_ids;
+  // Frames, leaf first: module << 40 | offset in the file
+  std::unordered_map<std::vector<uint64_t>, size_t, stack_hash> _stacks[2];
+  size_t _samples[2] = {0, 0};
+  size_t _lost = 0;
+  size_t _released = 0;
+  size_t _missed = 0;
+
+  bool _stopping = false;
+  std::thread _thread;
+};
+
+#endif // HEADER_GUARD_DPSG_PROFILER_HPP
@@ -0,0 +1,256 @@
+#include "proxy.hpp"
+#include "cgroup.hpp"
+#include "posix.hpp"
+#include "transcript.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+using namespace dpsg::posix;
+
+enum RW { Read = 0, Write = 1 };
+constexpr size_t relay_chunk = 1 << 16;
+
+bool is_safe(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || std::string_view{"/._-+,:@"}.find(c) !=
+                                        std::string_view::npos;
+}
+
+int hex_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Inverse of proxy_argument
+std::string decode_argument(std::string_view argument) {
+  std::string decoded;
+  for (size_t i = 0; i < argument.size(); ++i) {
+    const int high = argument[i] == '%' && i + 2 < argument.size()
+                         ? hex_digit(argument[i + 1])
+                         : -1;
+    const int low = high >= 0 ? hex_digit(argument[i + 2]) : -1;
+    if (low >= 0) {
+      decoded += (char)(high << 4 | low);
+      i += 2;
+    } else {
+      decoded += argument[i];
+    }
+  }
+  return decoded;
+}
+
+// Moves whatever is available from `in` to `out`, using splice when possible.
+// Returns the number of bytes transferred, 0 on end of file. The bytes are
+// passed to `observe` when given, which rules out splice. `can_splice` is
+// cleared once splice fails on this pair of descriptors.
+template <class F = std::nullptr_t>
+long relay(fd_t in, fd_t out, bool &can_splice, F &&observe = nullptr) {
+  if (can_splice && std::is_null_pointer_v<F>) {
+    auto r = splice(in, out, relay_chunk, SPLICE_F_MOVE);
+    if (r.is_value()) {
+      return r.value();
+    }
+    if ((int)r.error() != EINVAL) {
+      return -1;
+    }
+    can_splice = false;
+  }
+
+  char buffer[relay_chunk];
+  auto r = read(in, buffer);
+  if (r.is_error() || r.value() == 0) {
+    return r.is_error() ? -1 : 0;
+  }
+  if constexpr (!std::is_null_pointer_v<F>) {
+    observe(std::string_view{buffer, (size_t)r.value()});
+  }
+  for (long written = 0; written < r.value();) {
+    auto w = write(out, buffer + written, r.value() - written);
+    if (w.is_error()) {
+      return -1;
+    }
+    written += w.value();
+  }
+  return r.value();
+}
+
+} // namespace
+
+std::string proxy_argument(std::string_view argument) {
+  constexpr char digits[] = "0123456789abcdef";
+  std::string escaped;
+  for (char c : argument) {
+    if (is_safe(c)) {
+      escaped += c;
+    } else {
+      escaped += '%';
+      escaped += digits[(unsigned char)c >> 4];
+      escaped += digits[(unsigned char)c & 15];
+    }
+  }
+  return escaped;
+}
+
+int run_proxy(int argc, const char **argv) {
+  std::unique_ptr<transcript_writer> transcript;
+  resource_limits limits;
+  while (argc >= 2 && std::string_view{argv[0]}.starts_with("--")) {
+    const std::string_view option{argv[0]};
+    if (option == "--record") {
+      const int file = native::open(decode_argument(argv[1]).c_str(),
+                                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                    0644);
+      if (file == -1) {
+        perror("Failed to open transcript file");
+        return 1;
+      }
+      transcript = std::make_unique<transcript_writer>((fd_t)file);
+    } else if (option == "--memory-max") {
+      limits.memory_max = std::strtoull(argv[1], nullptr, 10);
+    } else {
+      break;
+    }
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc < 2) {
+    std::cerr << "Usage: runner proxy [--record <transcript file>] "
+                 "[--memory-max <bytes>] <latency file|-> <command...>"
+              << std::endl;
+    return 1;
+  }
+  // Samples are written as soon as they are measured: the referee may kill
+  // us without notice once the game is over, and the runner reads the file as
+  // soon as the referee has printed the result.
+  const bool measures_latency = std::string_view{argv[0]} != "-";
+  const auto latency_file =
+      measures_latency
+          ? (fd_t)native::open(decode_argument(argv[0]).c_str(),
+                               O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+          : (fd_t)-1;
+  if (measures_latency && (int)latency_file == -1) {
+    perror("Failed to open latency file");
+    return 1;
+  }
+
+  // Termination requests from the referee are handled in the poll loop so
+  // that the measurements get saved
+  native::sigset_t mask;
+  native::sigemptyset(&mask);
+  native::sigaddset(&mask, SIGTERM);
+  native::sigaddset(&mask, SIGINT);
+  native::sigaddset(&mask, SIGHUP);
+  native::sigaddset(&mask, SIGPIPE);
+  native::sigprocmask(SIG_BLOCK, &mask, nullptr);
+  const auto signals = (fd_t)native::signalfd(-1, &mask, SFD_CLOEXEC);
+
+  int to_bot[2], from_bot[2];
+  if (native::pipe2(to_bot, O_CLOEXEC) == -1 ||
+      native::pipe2(from_bot, O_CLOEXEC) == -1) {
+    perror("Pipe opening failed");
+    return 1;
+  }
+
+  auto bot = fork([&]() {
+    native::sigprocmask(SIG_UNBLOCK, &mask, nullptr);
+    if (native::dup2(to_bot[Read], STDIN_FILENO) == -1 ||
+        native::dup2(from_bot[Write], STDOUT_FILENO) == -1) {
+      perror("Failed to rebind bot stdio");
+      _exit(1);
+    }
+    apply_rlimits(limits);
+    native::execvp(argv[1], (char **)(argv + 1));
+    perror("Failed to launch bot");
+    _exit(127);
+  });
+  native::close(to_bot[Read]);
+  native::close(from_bot[Write]);
+
+  // Each direction falls back to read and write on its own
+  bool splice_to_bot = true;
+  bool splice_from_bot = true;
+  std::chrono::nanoseconds turn_start{};
+  bool waiting_for_reply = false;
+
+  enum { Referee = 0, Bot = 1, Signal = 2 };
+  dpsg::posix::pollfd fds[] = {
+      {(fd_t)STDIN_FILENO, poll_event_t::read_ready},
+      {(fd_t)from_bot[Read], poll_event_t::read_ready},
+      {signals, poll_event_t::read_ready},
+  };
+
+  bool running = true;
+  while (running) {
+    auto r = poll(std::span{fds});
+    if (r.is_error()) {
+      if (r.error() == poll_error::interrupted || r.error() == poll_error::again)
+        continue;
+      break;
+    }
+
+    if (fds[Referee].revents != 0) {
+      // The first chunk of input after a reply marks the start of a turn
+      if (!waiting_for_reply) {
+        turn_start = monotonic_now();
+        waiting_for_reply = true;
+      }
+      const auto relayed =
+          transcript ? relay((fd_t)STDIN_FILENO, (fd_t)to_bot[Write],
+                             splice_to_bot,
+                             [&](std::string_view data) {
+                               transcript->input(data);
+                             })
+                     : relay((fd_t)STDIN_FILENO, (fd_t)to_bot[Write],
+                             splice_to_bot);
+      if (relayed <= 0) {
+        // Let the bot see the end of its input, and keep relaying its output
+        native::close(to_bot[Write]);
+        fds[Referee].invalidate();
+        waiting_for_reply = false;
+      }
+    }
+
+    if (fds[Bot].revents != 0) {
+      if (waiting_for_reply && measures_latency) {
+        auto elapsed = monotonic_now() - turn_start;
+        auto us = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                      elapsed)
+                      .count();
+        write(latency_file, (const char *)&us, sizeof(us));
+      }
+      waiting_for_reply = false;
+      const auto relayed =
+          transcript ? relay((fd_t)from_bot[Read], (fd_t)STDOUT_FILENO,
+                             splice_from_bot,
+                             [&](std::string_view data) {
+                               transcript->reply(data);
+                             })
+                     : relay((fd_t)from_bot[Read], (fd_t)STDOUT_FILENO,
+                             splice_from_bot);
+      if (relayed <= 0) {
+        running = false;
+      }
+    }
+
+    if (fds[Signal].revents != 0) {
+      native::signalfd_siginfo info;
+      read(signals, (char *)&info, sizeof(info));
+      running = false;
+    }
+  }
+
+  native::kill((int)bot, SIGTERM);
+  native::waitpid((int)bot, nullptr, 0);
+  return 0;
+}
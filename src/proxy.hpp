@@ -0,0 +1,27 @@
+#ifndef HEADER_GUARD_DPSG_PROXY_HPP
+#define HEADER_GUARD_DPSG_PROXY_HPP
+
+#include <string>
+#include <string_view>
+
+// Entry point of `runner proxy [--record <transcript file>]
+// [--memory-max <bytes>] <latency file|-> <command...>`.
+//
+// The proxy is handed to the referee in place of a player command. It launches
+// the actual bot and relays the referee's input and the bot's replies between
+// the two, timestamping them to measure how long the bot takes to answer each
+// turn. The response times are appended to the latency file as they are
+// measured (as an array of native uint32_t, in microseconds), unless the file
+// is `-`. With --record, the input of the bot is also saved turn by turn (see
+// transcript.hpp), to be replayed by `runner replay`. --memory-max limits the
+// address space of the bot when cgroups can't limit the game (see
+// `apply_rlimits`).
+int run_proxy(int argc, const char **argv);
+
+// Escapes a path given to the proxy on its command line. The referee splits
+// player commands on whitespace without honouring quotes, so every byte but
+// the few that are safe both there and for `sh -c` becomes `%XX`, which the
+// proxy decodes.
+std::string proxy_argument(std::string_view argument);
+
+#endif // HEADER_GUARD_DPSG_PROXY_HPP
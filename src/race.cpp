@@ -0,0 +1,244 @@
+#include "race.hpp"
+#include "statistics.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <unordered_set>
+
+race::race(size_t candidate_count)
+    : _candidates(candidate_count),
+      _z(-normal_quantile(risk / (2.0 * (double)candidate_count))) {}
+
+void race::add(size_t candidate, double score) {
+  _candidates[candidate].scores.add(score);
+}
+
+double race::mean(size_t candidate) const {
+  return _candidates[candidate].scores.mean();
+}
+
+double race::standard_error(size_t candidate) const {
+  return _candidates[candidate].scores.standard_error();
+}
+
+double race::lower(size_t candidate) const {
+  return std::max(0.0, mean(candidate) - _z * standard_error(candidate));
+}
+
+double race::upper(size_t candidate) const {
+  return std::min(1.0, mean(candidate) + _z * standard_error(candidate));
+}
+
+size_t race::survivors() const {
+  return std::count_if(_candidates.begin(), _candidates.end(),
+                       [](auto &c) { return c.dropped_at == 0; });
+}
+
+size_t race::leader() const {
+  size_t best = 0;
+  double best_mean = -1;
+  for (size_t i = 0; i < size(); ++i) {
+    if (alive(i) && mean(i) > best_mean) {
+      best = i;
+      best_mean = mean(i);
+    }
+  }
+  return best;
+}
+
+bool race::round_complete() const {
+  for (size_t i = 0; i < size(); ++i) {
+    if (alive(i) && pairs(i) < _round * round_pairs) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<size_t> race::end_round() {
+  std::vector<size_t> dropped;
+  if (_round >= warmup_rounds) {
+    double best_lower = 0;
+    for (size_t i = 0; i < size(); ++i) {
+      if (alive(i)) {
+        best_lower = std::max(best_lower, lower(i));
+      }
+    }
+    for (size_t i = 0; i < size(); ++i) {
+      if (alive(i) && upper(i) < best_lower) {
+        dropped.push_back(i);
+      }
+    }
+    for (auto i : dropped) {
+      _candidates[i].dropped_at = _round;
+    }
+  }
+  _round++;
+  return dropped;
+}
+
+std::vector<size_t> race::ranking() const {
+  std::vector<size_t> order(size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    // Survivors (0) first, then from the last dropped
+    const auto key = [this](size_t c) {
+      return dropped_at(c) == 0 ? std::numeric_limits<int>::max()
+                                : dropped_at(c);
+    };
+    if (key(a) != key(b)) {
+      return key(a) > key(b);
+    }
+    return mean(a) > mean(b);
+  });
+  return order;
+}
+
+namespace {
+void print_candidate(const race &r, size_t c, std::string_view name) {
+  std::cout << std::fixed << std::setprecision(3) << r.mean(c) << " ["
+            << r.lower(c) << ", " << r.upper(c) << "] " << std::defaultfloat
+            << std::setprecision(6) << name;
+}
+} // namespace
+
+int run_race(int argc, const char **argv) {
+  using namespace dpsg;
+  auto opts = parse_options(argc, argv);
+  const auto &candidates = opts.arguments;
+  if (candidates.size() < 2 || opts.p2.empty() || opts.referee.empty()) {
+    std::cerr << "Usage: runner race -2 <baseline> -r <referee> "
+                 "[-c <max games>] [options] <candidates...>\n"
+                 "  -c defaults to every candidate playing every seed"
+              << std::endl;
+    return 1;
+  }
+
+  const std::string baseline{opts.p2};
+  const auto read = read_pair_seeds(opts, 2 * candidates.size(), 2);
+  if (!read) {
+    return 1;
+  }
+  const auto &seeds = *read;
+
+  race estimate{candidates.size()};
+  // Pairs started by each candidate, which is also the index of its next seed:
+  // all candidates play the same seeds in the same order
+  std::vector<size_t> started(candidates.size(), 0);
+  // Games of each candidate without a result yet, cancelled when it's dropped
+  std::vector<std::unordered_set<game_id>> unfinished(candidates.size());
+
+  size_t played = 0;
+  size_t submitted = 0;
+  bool finished = false;
+
+  const auto on_round = [&](const std::vector<size_t> &dropped) {
+    const auto leader = estimate.leader();
+    std::cout << vt100::cyan << "Round " << std::setw(3) << estimate.round() - 1
+              << vt100::reset << " (" << played << " games) "
+              << estimate.survivors() << " left, leader ";
+    print_candidate(estimate, leader, candidates[leader]);
+    if (!dropped.empty()) {
+      std::cout << vt100::red << ", dropped" << vt100::reset;
+      for (auto c : dropped) {
+        std::cout << ' ' << candidates[c];
+      }
+    }
+    std::cout << std::endl;
+  };
+
+  with_pair_engine(opts, [&](auto &games) {
+    // The slots of a dropped candidate go to the survivors
+    const auto drop = [&](size_t candidate) {
+      for (auto id : unfinished[candidate]) {
+        games.cancel(id);
+      }
+      unfinished[candidate].clear();
+    };
+
+    const auto on_pair = [&](size_t candidate, double score) {
+      if (finished || !estimate.alive(candidate)) {
+        return;
+      }
+      estimate.add(candidate, score);
+      if (!estimate.round_complete()) {
+        return;
+      }
+      const auto dropped = estimate.end_round();
+      on_round(dropped);
+      for (auto c : dropped) {
+        drop(c);
+      }
+      if (estimate.survivors() == 1) {
+        finished = true;
+        games.cancel();
+      }
+    };
+
+    const auto start_pair = [&](size_t candidate) {
+      const auto &seed = seeds[started[candidate]++ % seeds.size()];
+      const auto ids = submit_pair(
+          games, std::string{candidates[candidate]}, baseline, opts.referee,
+          seed,
+          [&on_pair, candidate](double score) { on_pair(candidate, score); },
+          [&played, &unfinished, candidate](game_id id, int, run_result &) {
+            played++;
+            unfinished[candidate].erase(id);
+          });
+      unfinished[candidate].insert(ids.begin(), ids.end());
+      submitted += 2;
+    };
+
+    // Slots go round-robin to the survivors, at most a round ahead of the
+    // current one so that they don't sit idle while a round completes
+    const auto refill = [&] {
+      const size_t horizon =
+          (size_t)(estimate.round() + 1) * (size_t)race::round_pairs;
+      while (!finished && (int)games.pending() < games.slot_count() &&
+             submitted + 2 <= (size_t)opts.process_count) {
+        std::optional<size_t> next;
+        for (size_t c = 0; c < candidates.size(); ++c) {
+          if (estimate.alive(c) && started[c] < horizon &&
+              (!next || started[c] < started[*next])) {
+            next = c;
+          }
+        }
+        if (!next) {
+          break;
+        }
+        start_pair(*next);
+      }
+    };
+
+    refill();
+    while (!games.idle()) {
+      games.poll();
+      refill();
+    }
+  });
+
+  std::cout << '\n';
+  for (auto c : estimate.ranking()) {
+    std::cout << (estimate.alive(c) ? vt100::green : vt100::reset)
+              << std::setw(4) << c << vt100::reset << "  " << std::setw(5)
+              << estimate.pairs(c) << " pairs  ";
+    if (estimate.alive(c)) {
+      std::cout << "survivor        ";
+    } else {
+      std::cout << "dropped round " << std::setw(2) << estimate.dropped_at(c);
+    }
+    std::cout << "  ";
+    print_candidate(estimate, c, candidates[c]);
+    std::cout << '\n';
+  }
+  std::cout << '\n'
+            << played << " games played, " << estimate.survivors()
+            << " candidates left (intervals at " << std::setprecision(3)
+            << estimate.z() << " standard errors)" << std::setprecision(6)
+            << std::endl;
+  return 0;
+}
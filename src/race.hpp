@@ -0,0 +1,78 @@
+#ifndef HEADER_GUARD_DPSG_RACE_HPP
+#define HEADER_GUARD_DPSG_RACE_HPP
+
+#include "pairs.hpp"
+
+#include <cstddef>
+#include <vector>
+
+// Which of many candidates plays best against a baseline, without giving every
+// candidate the full budget. The candidates play side-swapped pairs on the same
+// seeds in rounds, scoring the average points of the pair (0 to 1). After each
+// round, the candidates whose score is confidently below the leader's are
+// dropped: their upper bound is below the highest lower bound.
+//
+// The bounds are normal intervals around the mean score, widened for the
+// number of candidates (Bonferroni) so that the best one is dropped with
+// probability `risk` at most.
+class race {
+public:
+  // Pairs each candidate plays per round
+  constexpr static inline int round_pairs = 4;
+  // Rounds played by every candidate before any is dropped
+  constexpr static inline int warmup_rounds = 2;
+  constexpr static inline double risk = 0.05;
+
+  explicit race(size_t candidate_count);
+
+  void add(size_t candidate, double score);
+
+  size_t size() const { return _candidates.size(); }
+  int pairs(size_t candidate) const {
+    return _candidates[candidate].scores.n;
+  }
+  double mean(size_t candidate) const;
+  double standard_error(size_t candidate) const;
+  // Half width of the intervals, in standard errors
+  double z() const { return _z; }
+  double lower(size_t candidate) const;
+  double upper(size_t candidate) const;
+
+  bool alive(size_t candidate) const {
+    return _candidates[candidate].dropped_at == 0;
+  }
+  size_t survivors() const;
+  // Survivor with the best mean
+  size_t leader() const;
+  // Round in progress, from 1
+  int round() const { return _round; }
+  // Round in which a candidate was dropped, 0 for the survivors
+  int dropped_at(size_t candidate) const {
+    return _candidates[candidate].dropped_at;
+  }
+
+  // Whether every survivor played the pairs of the current round
+  bool round_complete() const;
+  // Moves on to the next round, returning the candidates dropped
+  std::vector<size_t> end_round();
+
+  // Survivors by decreasing mean, then the dropped candidates, the last ones
+  // dropped first
+  std::vector<size_t> ranking() const;
+
+private:
+  struct candidate_scores {
+    pair_scores scores;
+    int dropped_at = 0;
+  };
+
+  std::vector<candidate_scores> _candidates;
+  double _z;
+  int _round = 1;
+};
+
+// Entry point of `runner race -2 <baseline> <candidates...> <options...>`,
+// argv[0] being "race".
+int run_race(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_RACE_HPP
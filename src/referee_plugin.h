@@ -0,0 +1,58 @@
+#ifndef HEADER_GUARD_DPSG_REFEREE_PLUGIN_H
+#define HEADER_GUARD_DPSG_REFEREE_PLUGIN_H
+
+/* C interface of referee plugins: shared objects the runner loads with
+ * dlopen to play games in-process instead of starting a referee per game.
+ *
+ * The runner starts both players, hands their pipes to `cg_referee_play` and
+ * kills them once it returns. Games are played concurrently on several
+ * threads, with the same state.
+ *
+ *   cc -shared -fPIC -o my_referee.so my_referee.c
+ *   runner -r ./my_referee.so -1 ./bot -2 ./other
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CG_REFEREE_ABI_VERSION 1
+
+struct cg_referee_game {
+  /* Write end of the players' standard input. Writing to a player that
+   * exited fails with EPIPE, SIGPIPE being blocked in the threads playing
+   * the games. */
+  int player_input[2];
+  /* Read end of the players' standard output */
+  int player_output[2];
+  /* NULL to let the referee pick one */
+  const char *seed;
+  /* Where to write the game log, NULL when not wanted */
+  const char *log_file;
+};
+
+struct cg_referee_result {
+  /* Negative for a player in error (timeout, invalid output...) */
+  int scores[2];
+  /* Seed of the game, NUL-terminated */
+  char seed[64];
+};
+
+/* Called once after loading. Returns the state given to the other functions,
+ * or NULL when the plugin can't be used (e.g. `abi_version` is not the one it
+ * was built for). */
+void *cg_referee_init(int abi_version);
+
+/* Plays a game to the end. Must be thread-safe. Returns 0 on success,
+ * anything else when the game couldn't be played. */
+int cg_referee_play(void *state, const struct cg_referee_game *game,
+                    struct cg_referee_result *result);
+
+/* Called once before unloading. */
+void cg_referee_shutdown(void *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEADER_GUARD_DPSG_REFEREE_PLUGIN_H */
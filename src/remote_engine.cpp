@@ -0,0 +1,166 @@
+#include "remote_engine.hpp"
+
+#include <cstring>
+#include <iostream>
+
+using namespace dpsg::posix;
+
+remote_engine::remote_engine(const std::filesystem::path &socket) {
+  native::sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (socket.native().size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path too long: " << socket << std::endl;
+    exit(1);
+  }
+  std::strcpy(address.sun_path, socket.c_str());
+  int s = native::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (s == -1 || native::connect(s, reinterpret_cast<sockaddr *>(&address),
+                                 sizeof(address)) == -1) {
+    std::cerr << "No daemon listening on " << socket << " ("
+              << std::strerror(errno) << "), start one with `runner daemon`"
+              << std::endl;
+    exit(1);
+  }
+  _socket = (fd_t)s;
+
+  _send(message_writer{daemon_message::job}.string(
+      std::filesystem::current_path().native()));
+  while (_slot_count == 0) {
+    if (!_input.receive(_socket)) {
+      std::cerr << "The daemon closed the connection" << std::endl;
+      exit(1);
+    }
+    if (auto message = _input.next()) {
+      message_reader fields{message->second};
+      if (message->first == daemon_message::welcome) {
+        _slot_count = (int)fields.integer();
+      }
+    }
+  }
+}
+
+remote_engine::~remote_engine() { native::close((int)_socket); }
+
+void remote_engine::_send(const message_writer &message) {
+  if (!message.send(_socket)) {
+    std::cerr << "Lost the connection to the daemon" << std::endl;
+    exit(1);
+  }
+}
+
+game_id remote_engine::submit(game_t game, callback on_done) {
+  const auto id = _next_id++;
+  _send(message_writer{daemon_message::game}
+            .integer(id)
+            .string(game.player1)
+            .string(game.player2)
+            .string(game.referee)
+            .string(game.seed)
+            .string(game.output_file));
+  _games.emplace(id, remote_game{std::move(game), std::move(on_done)});
+  _pending++;
+  return id;
+}
+
+size_t remote_engine::_dispatch() {
+  size_t finished = 0;
+  while (auto message = _input.next()) {
+    message_reader fields{message->second};
+    const auto id = (game_id)fields.integer();
+    switch (message->first) {
+    case daemon_message::launched: {
+      // Games cancelled meanwhile are killed by the daemon, and still exit
+      _unfinished.insert(id);
+      auto it = _games.find(id);
+      if (it != _games.end() && !it->second.launched) {
+        it->second.launched = true;
+        _pending--;
+        if (_on_launch) {
+          _on_launch(id, it->second.game);
+        }
+      }
+      break;
+    }
+    case daemon_message::result: {
+      auto node = _games.extract(id);
+      if (node.empty()) {
+        break;
+      }
+      auto &g = node.mapped();
+      run_result result{};
+      result.output_file = g.game.output_file;
+      result.p1_score = (int)fields.signed_integer();
+      result.p2_score = (int)fields.signed_integer();
+      result.seed = fields.string();
+      result.duration = std::chrono::nanoseconds(fields.integer());
+      aggregate(result, _statistics);
+      finished++;
+      if (g.on_done) {
+        g.on_done(id, g.game, result);
+      }
+      break;
+    }
+    case daemon_message::exited: {
+      _unfinished.erase(id);
+      // What the engines get from wait4, from what the daemon measured
+      const auto cpu_usec = fields.integer();
+      struct rusage usage {};
+      usage.ru_utime.tv_sec = (time_t)(cpu_usec / 1000000);
+      usage.ru_utime.tv_usec = (suseconds_t)(cpu_usec % 1000000);
+      usage.ru_maxrss = (long)(fields.integer() / 1024);
+      if (_on_exit) {
+        _on_exit(id, usage);
+      }
+      break;
+    }
+    default:
+      break;
+    }
+  }
+  return finished;
+}
+
+size_t remote_engine::poll(std::chrono::milliseconds timeout) {
+  dpsg::posix::pollfd fd{_socket, poll_event_t::read_ready};
+  auto r = ::dpsg::posix::poll(std::span{&fd, 1}, timeout);
+  if (r.is_error()) {
+    auto e = r.error();
+    if (e == poll_error::interrupted || e == poll_error::again) {
+      return 0;
+    }
+    perror("Poll failed");
+    exit(1);
+  }
+  if (fd.revents == 0) {
+    return 0;
+  }
+  if (!_input.receive(_socket)) {
+    std::cerr << "Lost the connection to the daemon" << std::endl;
+    exit(1);
+  }
+  return _dispatch();
+}
+
+void remote_engine::run() {
+  while (!idle() || !_unfinished.empty()) {
+    poll();
+  }
+}
+
+bool remote_engine::cancel(game_id id) {
+  auto node = _games.extract(id);
+  if (node.empty()) {
+    return false;
+  }
+  _send(message_writer{daemon_message::cancel_game}.integer(id));
+  if (!node.mapped().launched) {
+    _pending--;
+  }
+  return node.mapped().launched;
+}
+
+void remote_engine::cancel() {
+  _send(message_writer{daemon_message::cancel});
+  _games.clear();
+  _pending = 0;
+}
@@ -0,0 +1,81 @@
+#ifndef HEADER_GUARD_DPSG_REMOTE_ENGINE_HPP
+#define HEADER_GUARD_DPSG_REMOTE_ENGINE_HPP
+
+#include "daemon_protocol.hpp"
+#include "engine.hpp"
+#include "statistics.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+// Same interface as `engine`, the games being played by `runner daemon` (see
+// daemon.hpp) alongside those of its other clients. Games are sent as they
+// are submitted, and the daemon decides when to launch them: the slot count
+// is that of the daemon. `on_exit` receives the CPU time and memory peak of
+// the game as measured by the daemon.
+class remote_engine {
+public:
+  using callback = engine::callback;
+
+  // Connects to the daemon listening on `socket`, games being started in the
+  // current directory. Exits the program when there is no daemon.
+  explicit remote_engine(const std::filesystem::path &socket);
+  remote_engine(const remote_engine &) = delete;
+  remote_engine &operator=(const remote_engine &) = delete;
+  ~remote_engine();
+
+  game_id submit(game_t game, callback on_done);
+
+  void on_launch(std::function<void(game_id, const game_t &)> f) {
+    _on_launch = std::move(f);
+  }
+  void on_exit(std::function<void(game_id, const struct rusage &)> f) {
+    _on_exit = std::move(f);
+  }
+
+  size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+  void run();
+
+  // Drops the games not launched yet and has the daemon kill the others,
+  // without calling their completion callbacks. They still go through
+  // `on_exit` once launched.
+  void cancel();
+  // Same for game `id` alone. Returns whether it was launched.
+  bool cancel(game_id id);
+
+  size_t pending() const { return _pending; }
+  size_t in_flight() const { return _games.size() - _pending; }
+  bool idle() const { return _games.empty(); }
+  int slot_count() const { return _slot_count; }
+
+  const statistics_t &statistics() const { return _statistics; }
+  void reset_statistics() { _statistics = {}; }
+
+private:
+  struct remote_game {
+    game_t game;
+    callback on_done;
+    bool launched = false;
+  };
+
+  void _send(const message_writer &message);
+  size_t _dispatch();
+
+  dpsg::posix::fd_t _socket;
+  message_stream _input;
+  int _slot_count = 0;
+  game_id _next_id = 0;
+  // Games without a result yet
+  std::unordered_map<game_id, remote_game> _games;
+  size_t _pending = 0;
+  // Games launched whose referee hasn't exited yet
+  std::unordered_set<game_id> _unfinished;
+  std::function<void(game_id, const game_t &)> _on_launch;
+  std::function<void(game_id, const struct rusage &)> _on_exit;
+  statistics_t _statistics;
+};
+
+#endif // HEADER_GUARD_DPSG_REMOTE_ENGINE_HPP
@@ -0,0 +1,257 @@
+#include "replay.hpp"
+#include "latency.hpp"
+#include "options.hpp"
+#include "runner.hpp"
+#include "thread_pool.hpp"
+#include "transcript.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace dpsg::posix;
+
+namespace {
+// A bot that doesn't answer within this time is considered stuck
+constexpr std::chrono::seconds turn_timeout{10};
+// Slowest turns listed for each bot
+constexpr size_t slowest_count = 5;
+
+constexpr uint32_t not_timed = UINT32_MAX;
+
+// Bots are launched through the runner concurrently, which it supports, but
+// releasing them isn't: the cgroups keep the leaves left to remove
+std::mutex release_mutex;
+
+struct replay_result {
+  size_t transcript;
+  int bot;
+  // Response time of each turn in microseconds, `not_timed` for the turns
+  // without reply
+  std::vector<uint32_t> turns;
+  std::string error;
+};
+
+bool write_all(fd_t fd, std::string_view data) {
+  while (!data.empty()) {
+    auto w = write(fd, data.data(), data.size());
+    if (w.is_error()) {
+      return false;
+    }
+    data.remove_prefix(w.value());
+  }
+  return true;
+}
+
+replay_result replay(runner &r, const std::string &command,
+                     const transcript &t, game_id id) {
+  replay_result result;
+  game_t game;
+  game.player1 = command;
+  auto bot = r.spawn_player(game, id, 0);
+  dpsg::posix::pollfd reply{bot.stdout, poll_event_t::read_ready};
+
+  for (size_t turn = 0; turn < t.turns.size() && result.error.empty();
+       ++turn) {
+    const auto &input = t.turns[turn];
+    const auto start = monotonic_now();
+    if (!write_all(bot.stdin, input.input)) {
+      result.error = "exited before turn " + std::to_string(turn + 1);
+      break;
+    }
+    if (input.reply_lines == 0) {
+      result.turns.push_back(not_timed);
+      continue;
+    }
+
+    uint32_t lines = 0;
+    bool replied = false;
+    while (lines < input.reply_lines) {
+      const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          turn_timeout - (monotonic_now() - start));
+      auto p = ::dpsg::posix::poll(
+          std::span{&reply, 1}, std::max(left, std::chrono::milliseconds{0}));
+      if (p.is_error()) {
+        if (p.error() == poll_error::interrupted ||
+            p.error() == poll_error::again) {
+          continue;
+        }
+        result.error = "poll failed";
+        break;
+      }
+      if (reply.revents == 0) {
+        result.error = "timed out on turn " + std::to_string(turn + 1);
+        break;
+      }
+      char buffer[4096];
+      auto n = read(bot.stdout, buffer);
+      if (n.is_error() || n.value() == 0) {
+        result.error = "exited on turn " + std::to_string(turn + 1);
+        break;
+      }
+      if (!replied) {
+        replied = true;
+        result.turns.push_back(
+            (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                monotonic_now() - start)
+                .count());
+      }
+      lines += (uint32_t)std::count(buffer, buffer + n.value(), '\n');
+    }
+  }
+
+  native::close((int)bot.stdin);
+  native::close((int)bot.stdout);
+  native::kill((int)bot.pid, SIGKILL);
+  int status;
+  struct rusage usage;
+  native::wait4((int)bot.pid, &status, 0, &usage);
+  std::lock_guard lock{release_mutex};
+  r.release(id, usage);
+  return result;
+}
+
+void print_percentiles(std::string_view label,
+                       const latency_statistics::percentiles &p,
+                       std::string_view unit = "turns") {
+  using namespace dpsg;
+  const auto ms = [](uint32_t us) { return (double)us / 1000.0; };
+  std::cout << label << "p50 " << std::setw(7) << ms(p.p50) << "  p99 "
+            << std::setw(7) << ms(p.p99) << "  max " << std::setw(7)
+            << ms(p.max) << vt100::setf(165, 165, 165) << " (" << p.count
+            << ' ' << unit << ')' << vt100::reset;
+}
+} // namespace
+
+int run_replay(int argc, const char **argv) {
+  using namespace dpsg;
+  auto opts = parse_options(argc, argv);
+  const auto &paths = opts.arguments;
+  if (paths.empty() || opts.p1.empty()) {
+    std::cerr << "Usage: runner replay -1 <bot> [-2 <bot>] [-c replays] "
+                 "[-p parallel] <transcripts...>"
+              << std::endl;
+    return 1;
+  }
+  if (opts.parallel_processes <= 0 || opts.process_count <= 0) {
+    std::cerr << "-c and -p must be > 0" << std::endl;
+    return 1;
+  }
+
+  std::vector<transcript> transcripts;
+  for (auto path : paths) {
+    auto t = read_transcript(path);
+    if (!t) {
+      std::cerr << "Cannot read transcript " << path << std::endl;
+      return 1;
+    }
+    transcripts.push_back(std::move(*t));
+  }
+  std::vector<std::string> bots{std::string{opts.p1}};
+  if (!opts.p2.empty()) {
+    bots.emplace_back(opts.p2);
+  }
+
+  // The bots are started alone, without proxy
+  opts.measure_latency = false;
+  opts.record = {};
+  auto runner = make_runner(opts);
+  // A bot exiting early must not take the runner down
+  ::signal(SIGPIPE, SIG_IGN);
+
+  // The bots take turns on each replay, so that they run under the same load
+  const size_t replays = std::max((size_t)opts.process_count, paths.size());
+  std::vector<replay_result> results(replays * bots.size());
+  std::atomic<game_id> next_id = 0;
+  const auto started = monotonic_now();
+  {
+    thread_pool pool{(unsigned)opts.parallel_processes};
+    for (size_t i = 0; i < results.size(); ++i) {
+      pool.submit([&, i] {
+        const size_t transcript = i / bots.size() % transcripts.size();
+        const int bot = (int)(i % bots.size());
+        results[i] = replay(runner, bots[bot], transcripts[transcript],
+                            next_id++);
+        results[i].transcript = transcript;
+        results[i].bot = bot;
+      });
+    }
+    pool.wait();
+  }
+  const std::chrono::duration<double> elapsed = monotonic_now() - started;
+
+  latency_statistics stats;
+  // Samples of each turn of each transcript, by bot
+  using samples = std::vector<uint32_t>;
+  std::vector<std::vector<std::vector<samples>>> by_turn(
+      bots.size(), std::vector<std::vector<samples>>(transcripts.size()));
+  size_t failures = 0;
+  for (auto &r : results) {
+    if (!r.error.empty()) {
+      if (failures++ < slowest_count) {
+        std::cout << vt100::red << "Bot " << (r.bot + 1) << vt100::reset
+                  << " " << r.error << " of " << paths[r.transcript]
+                  << std::endl;
+      }
+    }
+    auto &turns = by_turn[r.bot][r.transcript];
+    turns.resize(std::max(turns.size(), r.turns.size()));
+    for (size_t turn = 0; turn < r.turns.size(); ++turn) {
+      if (r.turns[turn] == not_timed) {
+        continue;
+      }
+      (turn == 0 ? stats.first_turn : stats.turns)[r.bot].push_back(
+          r.turns[turn]);
+      turns[turn].push_back(r.turns[turn]);
+    }
+  }
+
+  std::cout << "Replayed " << paths.size() << " transcripts, " << replays
+            << " replays per bot";
+  if (failures > 0) {
+    std::cout << ", " << vt100::red << failures << " failed" << vt100::reset;
+  }
+  std::cout << std::setprecision(3) << " in " << elapsed.count() << "s"
+            << std::endl;
+
+  for (size_t bot = 0; bot < bots.size(); ++bot) {
+    std::cout << (bot == 0 ? vt100::yellow : vt100::cyan) << "Bot "
+              << (bot + 1) << " response time (ms): " << vt100::reset;
+    print_percentiles("first turn ",
+                      latency_statistics::compute(stats.first_turn[bot]));
+    print_percentiles(" | other turns ",
+                      latency_statistics::compute(stats.turns[bot]));
+    std::cout << std::endl;
+
+    // Where the time goes: the turns with the highest median
+    struct slow_turn {
+      size_t transcript;
+      size_t turn;
+      latency_statistics::percentiles p;
+    };
+    std::vector<slow_turn> slowest;
+    for (size_t t = 0; t < transcripts.size(); ++t) {
+      for (size_t turn = 0; turn < by_turn[bot][t].size(); ++turn) {
+        if (!by_turn[bot][t][turn].empty()) {
+          slowest.push_back(
+              {t, turn, latency_statistics::compute(by_turn[bot][t][turn])});
+        }
+      }
+    }
+    const auto shown = std::min(slowest.size(), slowest_count);
+    std::partial_sort(
+        slowest.begin(), slowest.begin() + shown, slowest.end(),
+        [](auto &a, auto &b) { return a.p.p50 > b.p.p50; });
+    for (size_t i = 0; i < shown; ++i) {
+      std::cout << "  " << paths[slowest[i].transcript] << " turn "
+                << std::setw(3) << slowest[i].turn + 1 << ": ";
+      print_percentiles("", slowest[i].p, "replays");
+      std::cout << std::endl;
+    }
+  }
+  return failures > 0 ? 1 : 0;
+}
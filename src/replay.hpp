@@ -0,0 +1,16 @@
+#ifndef HEADER_GUARD_DPSG_REPLAY_HPP
+#define HEADER_GUARD_DPSG_REPLAY_HPP
+
+// Entry point of `runner replay -1 <bot> [-2 <bot>] [-c n] [-p n]
+// transcripts...`.
+//
+// Feeds the input recorded with --record (see transcript.hpp) to a bot, turn
+// by turn and as fast as it answers, without referee nor opponent: each turn
+// is sent once the bot has replied with as many lines as during the game. The
+// response times are measured as by the proxy, from the input to the first
+// byte of the reply. `-c` replays are run in total, cycling through the
+// transcripts, `-p` at a time. With `-2`, both bots replay the same
+// transcripts, for comparison.
+int run_replay(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_REPLAY_HPP
@@ -0,0 +1,223 @@
+#include "result_store.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+result_summary summary_of(size_t games, int64_t draws, const int64_t count[2],
+                          const int64_t sum[2], const int64_t sum_sq[2],
+                          const size_t errors[2]) {
+  result_summary r{.games = games, .draws = (size_t)draws};
+  for (int x = 0; x < 2; ++x) {
+    r.victories[x] = (size_t)count[x];
+    r.errors[x] = errors[x];
+    if (count[x] == 0) {
+      r.point_difference_avg[x] = NAN;
+      r.point_difference_deviation[x] = NAN;
+      continue;
+    }
+    const double avg = (double)sum[x] / (double)count[x];
+    const double variance = (double)sum_sq[x] / (double)count[x] - avg * avg;
+    r.point_difference_avg[x] = avg;
+    r.point_difference_deviation[x] = std::sqrt(std::max(variance, 0.0));
+  }
+  return r;
+}
+
+int histogram_bucket(int difference, int bucket_width, int buckets) {
+  const int d = difference + bucket_width / 2;
+  // Floor division, so that buckets are all `bucket_width` wide
+  const int q = (d >= 0 ? d : d - bucket_width + 1) / bucket_width;
+  return std::clamp(q + buckets / 2, 0, buckets - 1);
+}
+} // namespace
+
+uint8_t result_store::outcome_of(const run_result &result) {
+  auto err = (uint8_t)result.get_error();
+  if (err != 0) {
+    return err;
+  }
+  switch (result.winner()) {
+  case run_result::winner::p1:
+    return p1_wins;
+  case run_result::winner::p2:
+    return p2_wins;
+  default:
+    return draw;
+  }
+}
+
+void result_store::reserve(size_t count) {
+  _run_counts.reserve(count);
+  _p1_scores.reserve(count);
+  _p2_scores.reserve(count);
+  _outcomes.reserve(count);
+  _seed_ids.reserve(count);
+}
+
+void result_store::clear(std::string output_prefix) {
+  _output_prefix = std::move(output_prefix);
+  _run_counts.clear();
+  _p1_scores.clear();
+  _p2_scores.clear();
+  _outcomes.clear();
+  _seed_ids.clear();
+  _seed_index.clear();
+  _seed_arena.clear();
+  _seed_offsets.assign(1, 0);
+}
+
+void result_store::push_back(uint32_t run_count, const run_result &result) {
+  _run_counts.push_back(run_count);
+  _p1_scores.push_back(result.p1_score);
+  _p2_scores.push_back(result.p2_score);
+  _outcomes.push_back(outcome_of(result));
+  _seed_ids.push_back(_intern(result.seed));
+}
+
+std::string result_store::output_file(size_t idx) const {
+  return _output_prefix + std::to_string(_run_counts[idx]) + ".json";
+}
+
+uint32_t result_store::_intern(std::string_view seed) {
+  if (auto it = _seed_index.find(seed); it != _seed_index.end()) {
+    return *it;
+  }
+  auto id = (uint32_t)seed_count();
+  _seed_arena.append(seed);
+  _seed_offsets.push_back((uint32_t)_seed_arena.size());
+  _seed_index.insert(id);
+  return id;
+}
+
+// The kernels below avoid branches in their loop bodies so that they compile
+// to SIMD code at -O2 and above.
+
+size_t result_store::count(uint8_t outcome) const {
+  const uint8_t *o = _outcomes.data();
+  const size_t n = _outcomes.size();
+  size_t r = 0;
+  for (size_t i = 0; i < n; ++i) {
+    r += o[i] == outcome;
+  }
+  return r;
+}
+
+size_t result_store::count_errors(uint8_t player_error) const {
+  const uint8_t *o = _outcomes.data();
+  const size_t n = _outcomes.size();
+  size_t r = 0;
+  for (size_t i = 0; i < n; ++i) {
+    r += (o[i] & player_error) != 0;
+  }
+  return r;
+}
+
+result_summary result_store::summarize() const {
+  const uint8_t *o = _outcomes.data();
+  const int32_t *s1 = _p1_scores.data();
+  const int32_t *s2 = _p2_scores.data();
+  const size_t n = _outcomes.size();
+
+  // Raw moments of the score difference for each winner, everything else
+  // being masked out
+  int64_t count[2] = {0, 0};
+  int64_t sum[2] = {0, 0};
+  int64_t sum_sq[2] = {0, 0};
+  int64_t draws = 0, errors[2] = {0, 0};
+  for (size_t i = 0; i < n; ++i) {
+    const int64_t d = (int64_t)s1[i] - (int64_t)s2[i];
+    const int64_t w1 = o[i] == p1_wins;
+    const int64_t w2 = o[i] == p2_wins;
+    count[0] += w1;
+    count[1] += w2;
+    sum[0] += w1 * d;
+    sum[1] -= w2 * d;
+    sum_sq[0] += w1 * d * d;
+    sum_sq[1] += w2 * d * d;
+    draws += o[i] == draw;
+    errors[0] += (o[i] & p1_error) != 0;
+    errors[1] += (o[i] & p2_error) != 0;
+  }
+
+  const size_t error_counts[2] = {(size_t)errors[0], (size_t)errors[1]};
+  return summary_of(n, draws, count, sum, sum_sq, error_counts);
+}
+
+std::vector<size_t>
+result_store::score_difference_histogram(int bucket_width, int buckets) const {
+  std::vector<size_t> histogram(buckets, 0);
+  const uint8_t *o = _outcomes.data();
+  const int32_t *s1 = _p1_scores.data();
+  const int32_t *s2 = _p2_scores.data();
+  const size_t n = _outcomes.size();
+
+  for (size_t i = 0; i < n; ++i) {
+    const int b = histogram_bucket(s1[i] - s2[i], bucket_width, buckets);
+    histogram[b] += (o[i] & both_error) == 0;
+  }
+  return histogram;
+}
+
+std::vector<std::string_view>
+result_store::error_seeds(uint8_t player_error) const {
+  std::vector<std::string_view> seeds;
+  for (size_t i = 0; i < size(); ++i) {
+    if ((_outcomes[i] & player_error) != 0) {
+      seeds.push_back(seed(i));
+    }
+  }
+  return seeds;
+}
+
+int result_store::max_score_difference() const {
+  int r = 0;
+  for (size_t i = 0; i < size(); ++i) {
+    r = std::max(r, std::abs(_p1_scores[i] - _p2_scores[i]));
+  }
+  return r;
+}
+
+void result_tally::push_back(const run_result &result) {
+  const auto outcome = result_store::outcome_of(result);
+  const int64_t d = (int64_t)result.p1_score - (int64_t)result.p2_score;
+  _games++;
+  _max_difference = std::max(_max_difference, (int)std::abs(d));
+  for (int x = 0; x < 2; ++x) {
+    const auto error = x == 0 ? result_store::p1_error : result_store::p2_error;
+    if ((outcome & error) != 0 && _errors[x]++ < kept_error_seeds) {
+      _error_seeds[x].push_back(result.seed);
+    }
+  }
+  if ((outcome & result_store::both_error) != 0) {
+    return;
+  }
+  _differences[(int)d]++;
+  if (outcome == result_store::draw) {
+    _draws++;
+    return;
+  }
+  const int x = outcome == result_store::p1_wins ? 0 : 1;
+  _count[x]++;
+  _sum[x] += x == 0 ? d : -d;
+  _sum_sq[x] += d * d;
+}
+
+result_summary result_tally::summarize() const {
+  return summary_of(_games, _draws, _count, _sum, _sum_sq, _errors);
+}
+
+std::vector<std::string_view>
+result_tally::error_seeds(uint8_t player_error) const {
+  const int x = player_error == result_store::p1_error ? 0 : 1;
+  return {_error_seeds[x].begin(), _error_seeds[x].end()};
+}
+
+std::vector<size_t>
+result_tally::score_difference_histogram(int bucket_width, int buckets) const {
+  std::vector<size_t> histogram(buckets, 0);
+  for (auto [difference, games] : _differences) {
+    histogram[histogram_bucket(difference, bucket_width, buckets)] += games;
+  }
+  return histogram;
+}
@@ -0,0 +1,153 @@
+#ifndef HEADER_GUARD_DPSG_RESULT_STORE_HPP
+#define HEADER_GUARD_DPSG_RESULT_STORE_HPP
+
+#include "statistics.hpp"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Aggregated figures computed over every result of a `result_store`.
+struct result_summary {
+  size_t games = 0;
+  size_t draws = 0;
+  size_t victories[2] = {0, 0};
+  size_t errors[2] = {0, 0};
+  // Point difference (winner - loser) over the games won by each player
+  double point_difference_avg[2] = {0, 0};
+  double point_difference_deviation[2] = {0, 0};
+};
+
+// Results of a run, stored column-wise so that summaries over hundreds of
+// thousands of games are a handful of tight loops the compiler can vectorize.
+//
+// Each result takes 17 bytes plus its seed, which is only stored once however
+// many games were played with it. The output file of a game is not stored,
+// it's derived from the run number.
+class result_store {
+public:
+  // Packed outcome of a game. The low bits match `run_result::error`, the
+  // winner is only meaningful when there is no error.
+  enum outcome : uint8_t {
+    draw = 0,
+    p1_error = 1,
+    p2_error = 2,
+    both_error = p1_error | p2_error,
+    p1_wins = 1 << 2,
+    p2_wins = 2 << 2,
+  };
+
+  static uint8_t outcome_of(const run_result &result);
+
+  explicit result_store(std::string output_prefix = "")
+      : _output_prefix(std::move(output_prefix)),
+        _seed_index(0, seed_hash{this}, seed_equal{this}) {}
+  result_store(const result_store &) = delete;
+  result_store &operator=(const result_store &) = delete;
+
+  void reserve(size_t count);
+  // Forgets every result, for a new run writing its logs under
+  // `output_prefix`
+  void clear(std::string output_prefix);
+
+  void push_back(uint32_t run_count, const run_result &result);
+
+  size_t size() const { return _outcomes.size(); }
+
+  uint32_t run_count(size_t idx) const { return _run_counts[idx]; }
+  int32_t p1_score(size_t idx) const { return _p1_scores[idx]; }
+  int32_t p2_score(size_t idx) const { return _p2_scores[idx]; }
+  uint8_t get_outcome(size_t idx) const { return _outcomes[idx]; }
+  uint32_t seed_id(size_t idx) const { return _seed_ids[idx]; }
+  std::string_view seed(size_t idx) const { return seed_of(_seed_ids[idx]); }
+  std::string output_file(size_t idx) const;
+
+  // Number of distinct seeds
+  size_t seed_count() const { return _seed_offsets.size() - 1; }
+  std::string_view seed_of(uint32_t id) const {
+    return std::string_view{_seed_arena}.substr(
+        _seed_offsets[id], _seed_offsets[id + 1] - _seed_offsets[id]);
+  }
+
+  // Summary kernels
+  size_t count(uint8_t outcome) const;
+  size_t count_errors(uint8_t player_error) const;
+  result_summary summarize() const;
+  // Seeds of the games where `player_error` is set, in order
+  std::vector<std::string_view> error_seeds(uint8_t player_error) const;
+  // Largest score difference, in absolute value
+  int max_score_difference() const;
+  // Distribution of the score difference (p1 - p2) of the games without
+  // errors, in `buckets` buckets of `bucket_width` points centered on 0.
+  // Out of range differences land in the first/last buckets.
+  std::vector<size_t> score_difference_histogram(int bucket_width,
+                                                 int buckets) const;
+
+private:
+  uint32_t _intern(std::string_view seed);
+
+  struct seed_hash {
+    using is_transparent = void;
+    const result_store *store;
+    size_t operator()(std::string_view s) const {
+      return std::hash<std::string_view>{}(s);
+    }
+    size_t operator()(uint32_t id) const { return (*this)(store->seed_of(id)); }
+  };
+  struct seed_equal {
+    using is_transparent = void;
+    const result_store *store;
+    std::string_view view(std::string_view s) const { return s; }
+    std::string_view view(uint32_t id) const { return store->seed_of(id); }
+    bool operator()(auto l, auto r) const { return view(l) == view(r); }
+  };
+
+  std::string _output_prefix;
+  std::vector<uint32_t> _run_counts;
+  std::vector<int32_t> _p1_scores;
+  std::vector<int32_t> _p2_scores;
+  std::vector<uint8_t> _outcomes;
+  std::vector<uint32_t> _seed_ids;
+
+  std::string _seed_arena;
+  std::vector<uint32_t> _seed_offsets{0};
+  std::unordered_set<uint32_t, seed_hash, seed_equal> _seed_index;
+};
+
+// The figures of a `result_store` accumulated one result at a time instead,
+// for more results than fit in memory (`runner merge`). Only a count by score
+// difference is kept, and the seeds of the first games in error.
+class result_tally {
+public:
+  // Seeds of games in error kept for each player, the others only counted
+  constexpr static inline size_t kept_error_seeds = 100;
+
+  void push_back(const run_result &result);
+
+  size_t size() const { return _games; }
+
+  result_summary summarize() const;
+  // The first kept_error_seeds of them
+  std::vector<std::string_view> error_seeds(uint8_t player_error) const;
+  int max_score_difference() const { return _max_difference; }
+  std::vector<size_t> score_difference_histogram(int bucket_width,
+                                                 int buckets) const;
+
+private:
+  size_t _games = 0;
+  int64_t _draws = 0;
+  // Moments of the score difference by winner, as in summarize()
+  int64_t _count[2] = {0, 0};
+  int64_t _sum[2] = {0, 0};
+  int64_t _sum_sq[2] = {0, 0};
+  size_t _errors[2] = {0, 0};
+  std::vector<std::string> _error_seeds[2];
+  // Games without error by score difference (p1 - p2)
+  std::map<int, size_t> _differences;
+  int _max_difference = 0;
+};
+
+#endif // HEADER_GUARD_DPSG_RESULT_STORE_HPP
@@ -0,0 +1,122 @@
+#ifndef HEADER_GUARD_DPSG_RUN_DRIVER_HPP
+#define HEADER_GUARD_DPSG_RUN_DRIVER_HPP
+
+#include "engine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <optional>
+
+// How a run hands its games to an engine (anything with the interface of
+// `engine`) and drives it until they are played. The runner drives the real
+// engines with it, and `runner simulate` a simulated_engine on its virtual
+// clock, so that what is simulated is what the runner does.
+//
+// Without a time budget, every game is submitted up front. With one
+// (--budget), only as many games as there are slots are queued, so that the
+// decision to launch one is taken as late as possible, and a game is only
+// submitted when it should end before the deadline. With `kill_at_deadline`,
+// the games still running at the deadline are cancelled.
+template <class Engine> class run_driver {
+public:
+  using clock_time = std::chrono::nanoseconds;
+
+  struct settings {
+    // Games to play at most
+    int games = 0;
+    // No deadline when 0
+    std::chrono::seconds budget{0};
+    bool kill_at_deadline = false;
+  };
+
+  // `submit(n)` submits the n-th game of the run (from 0), and
+  // `expected_ms(n)` tells how long it should last, if anything is known.
+  run_driver(Engine &games, settings s, std::function<clock_time()> now,
+             std::function<void(int)> submit,
+             std::function<std::optional<double>(int)> expected_ms)
+      : _games(games), _settings(s), _now(std::move(now)),
+        _submit(std::move(submit)), _expected_ms(std::move(expected_ms)) {}
+
+  // Plays the games of a run until the engine is idle. `stop` is called after
+  // each poll, and at least every `interval` when it isn't negative: when it
+  // returns true, the games left are cancelled and `run` returns false.
+  bool run(std::function<bool()> stop = nullptr,
+           std::chrono::milliseconds interval = std::chrono::milliseconds(-1)) {
+    _submitted = 0;
+    _cancelled = false;
+    _deadline = _now() + _settings.budget;
+
+    if (_settings.budget.count() == 0) {
+      while (_submitted < _settings.games) {
+        _submit(_submitted++);
+      }
+    }
+    _refill();
+
+    while (!_games.idle()) {
+      auto timeout = std::chrono::milliseconds(-1);
+      if (_settings.kill_at_deadline && !_cancelled) {
+        timeout = std::max(std::chrono::milliseconds(0),
+                           std::chrono::ceil<std::chrono::milliseconds>(
+                               _deadline - _now()));
+      }
+      if (stop && interval.count() >= 0) {
+        timeout = timeout.count() < 0 ? interval : std::min(timeout, interval);
+      }
+      _games.poll(timeout);
+      if (_settings.kill_at_deadline && !_cancelled && _now() >= _deadline) {
+        _games.cancel();
+        _cancelled = true;
+      }
+      if (stop && stop()) {
+        _games.cancel();
+        return false;
+      }
+      _refill();
+    }
+    return true;
+  }
+
+  // Games submitted by the last call to `run`
+  int submitted() const { return _submitted; }
+  // Whether the games in flight at the deadline were cancelled
+  bool cancelled() const { return _cancelled; }
+  clock_time deadline() const { return _deadline; }
+
+private:
+  // A game is only launched when it should end before the deadline. Until
+  // anything is known of the durations, a first wave of games has to do.
+  bool _fits() const {
+    const auto now = _now();
+    if (now >= _deadline) {
+      return false;
+    }
+    const auto expected_ms = _expected_ms(_submitted);
+    if (!expected_ms) {
+      return _submitted < _games.slot_count();
+    }
+    return now + std::chrono::duration<double, std::milli>(*expected_ms) <=
+           _deadline;
+  }
+
+  void _refill() {
+    while (_settings.budget.count() > 0 && _submitted < _settings.games &&
+           (int)(_games.pending() + _games.in_flight()) <
+               _games.slot_count() &&
+           _fits()) {
+      _submit(_submitted++);
+    }
+  }
+
+  Engine &_games;
+  settings _settings;
+  std::function<clock_time()> _now;
+  std::function<void(int)> _submit;
+  std::function<std::optional<double>(int)> _expected_ms;
+  int _submitted = 0;
+  bool _cancelled = false;
+  clock_time _deadline{};
+};
+
+#endif // HEADER_GUARD_DPSG_RUN_DRIVER_HPP
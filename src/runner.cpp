@@ -1,20 +1,172 @@
 #include "runner.hpp"
+#include "latency.hpp"
+#include "proxy.hpp"
+#include "transcript.hpp"
+
 
 runner make_runner(const option_t &opts) {
   runner r{};
-  r.cmd_args[runner::Player1] = opts.p1.data();
-  r.cmd_args[runner::Player2] = opts.p2.data();
-  r.cmd_args[runner::Referee] = opts.referee.data();
-  if (opts.generate_output) {
-    r.cmd_args[runner::GenerateFlag] = "-l";
+
+  if (opts.measure_latency) {
+    r.latency_directory =
+        std::filesystem::temp_directory_path() /
+        ("cg-runner-" + std::to_string((uint64_t)dpsg::posix::getpid()));
+    std::filesystem::create_directories(r.latency_directory);
+  }
+  if (!opts.record.empty()) {
+    r.record_directory = std::filesystem::absolute(opts.record);
+    std::filesystem::create_directories(r.record_directory);
+  }
+
+  r.jvm_flags.assign(opts.jvm_flags.begin(), opts.jvm_flags.end());
+  if (opts.class_data_sharing && !opts.referee.empty() &&
+      !opts.referee.ends_with(".so")) {
+    r.class_data = std::make_shared<class_data_archive>(opts.referee);
+  }
+
+  r.stderr_logs = std::make_shared<stderr_capture>(opts.stderr_tail);
+  if (!opts.profile.empty()) {
+    r.profiler = std::make_shared<player_profiler>(opts.profile);
+  }
+
+  if (!opts.preload.empty()) {
+    r.preload = std::make_shared<preloaded_data>(opts.preload, opts.huge_pages);
+  }
+
+
+  r.limits = resource_limits{
+      .memory_max = opts.memory_max,
+      .cpu_max = opts.cpu_max,
+      .pids_max = opts.pids_max,
+  };
+  if (r.limits.any()) {
+    r.cgroups = std::make_shared<cgroup_manager>(r.limits);
+  }
+
+  if (r.proxies()) {
+    r.self_path = std::filesystem::read_symlink("/proc/self/exe");
+    // The path of the runner can't be escaped, but this link to it can stand
+    // in for it: the runner outlives its games
+    if (proxy_argument(r.self_path) != r.self_path) {
+      r.self_path =
+          "/proc/" + std::to_string((uint64_t)dpsg::posix::getpid()) + "/exe";
+    }
   }
 
   return r;
 }
 
-dpsg::posix::process_t runner::operator()(std::string_view output_file) {
-  if (cmd_args[GenerateFlag] != nullptr) {
-    cmd_args[OutputName] = output_file.data();
+std::string runner::player_command(const game_t &game, game_id id,
+                                  int player) const {
+  const std::string &command = player == 0 ? game.player1 : game.player2;
+  if (!proxies()) {
+    return command;
+  }
+  std::string proxy = self_path + " proxy ";
+  if (limits_players()) {
+    proxy += "--memory-max " + std::to_string(limits.memory_max) + ' ';
+  }
+  if (records()) {
+    proxy += "--record " +
+             proxy_argument(
+                 (record_directory / transcript_name(game.seed, id, player, command))
+                     .string()) +
+             ' ';
+  }
+  proxy += measures_latency()
+               ? proxy_argument(
+                     latency_file(latency_directory, (int)id, player).string())
+               : "-";
+  return proxy + ' ' + command;
+}
+
+dpsg::posix::process_t runner::_spawn(const char *const *args,
+                                      game_id id) const {
+  // Only async-signal-safe calls between fork and exec
+  const std::string procs = uses_cgroups() ? cgroups->prepare(id) : "";
+  auto p = dpsg::posix::run_external(args[0], args, [&] {
+    // A group of its own, which the bots join, killed whole (see kill_game)
+    dpsg::posix::native::setpgid(0, 0);
+    if (!working_directory.empty() &&
+        dpsg::posix::native::chdir(working_directory.c_str()) == -1) {
+      constexpr char msg[] = "Failed to enter the working directory\n";
+      dpsg::posix::native::write(STDERR_FILENO, msg, sizeof(msg) - 1);
+      _exit(1);
+    }
+    if (!procs.empty()) {
+      join_cgroup(procs.c_str());
+    }
+  });
+  if (stderr_logs) {
+    stderr_logs->add(id, p.stderr);
+    p.stderr = (dpsg::posix::fd_t)-1;
+  }
+  return p;
+}
+
+// Called concurrently by the I/O threads of parallel_engine: the class data
+// archive, the stderr rings and the profiler lock what the launches share,
+// and a cgroup leaf belongs to a single game. `release` isn't meant for
+// concurrent calls: the engines make them from the thread polling them.
+dpsg::posix::process_t runner::operator()(const game_t &game,
+                                          game_id id) const {
+  std::string players[] = {player_command(game, id, 0),
+                           player_command(game, id, 1)};
+  std::string class_data_flag =
+      uses_class_data() ? class_data->flag_for(id) : "";
+  std::string seed_arg = "seed=" + game.seed;
+
+  std::vector<const char *> args;
+  args.reserve(jvm_flags.size() + 12);
+  args.push_back("java");
+  for (auto &flag : jvm_flags) {
+    args.push_back(flag.c_str());
+  }
+  if (!class_data_flag.empty()) {
+    args.push_back(class_data_flag.c_str());
+  }
+  args.insert(args.end(), {"-jar", game.referee.c_str(), "-p1",
+                           players[0].c_str(), "-p2", players[1].c_str()});
+  if (!game.output_file.empty()) {
+    args.insert(args.end(), {"-l", game.output_file.c_str()});
+  }
+  if (!game.seed.empty()) {
+    args.insert(args.end(), {"-d", seed_arg.c_str()});
+  }
+  args.push_back(nullptr);
+
+  auto p = _spawn(args.data(), id);
+  if (profiler) {
+    profiler->watch(id, p.pid, {players[0], players[1]},
+                    proxies());
+  }
+  return p;
+}
+
+dpsg::posix::process_t runner::spawn_player(const game_t &game, game_id id,
+                                            int player) const {
+  // exec, so that killing the process kills the bot rather than the shell
+  auto command = "exec " + player_command(game, id, player);
+  const char *args[] = {"sh", "-c", command.c_str(), nullptr};
+  auto p = _spawn(args, id);
+  if (profiler) {
+    profiler->attach(id, player, p.pid, proxies());
+  }
+  return p;
+}
+
+resource_usage runner::release(game_id id, const struct rusage &referee_usage) {
+  if (stderr_logs) {
+    stderr_logs->release(id);
+  }
+  if (profiler) {
+    profiler->release(id);
+  }
+  if (uses_class_data()) {
+    class_data->release(id);
+  }
+  if (uses_cgroups()) {
+    return cgroups->release(id);
   }
-  return dpsg::posix::run_external("java", cmd_args);
+  return usage_from(referee_usage);
 }
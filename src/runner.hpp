@@ -1,35 +1,84 @@
 #ifndef HEADER_GUARD_DPSG_RUNNER_HPP
 #define HEADER_GUARD_DPSG_RUNNER_HPP
 
+#include "cgroup.hpp"
+#include "class_data.hpp"
+#include "engine.hpp"
 #include "options.hpp"
+#include "preload.hpp"
+#include "profiler.hpp"
+#include "stderr_capture.hpp"
+#include <filesystem>
+#include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
 
+// Launches CodinGame referees with `java -jar`, or the players alone when the
+// referee is a plugin (see plugin_engine.hpp), each in a process group of its
+// own (see kill_game).
 struct runner {
 
-  enum POSITIONS {
-    Referee = 2,
-    Player1 = 4,
-    Player2 = 6,
-    GenerateFlag = 7,
-    OutputName = 8,
-  };
-
-  const char *cmd_args[12] = {
-      "java",  // 0
-      "-jar",  // 1
-      nullptr, // 2
-      "-p1",   // 3
-      nullptr, // 4
-      "-p2",   // 5
-      nullptr, // 6
-      nullptr, // 7
-      nullptr, // 8
-      nullptr, // 9
-      nullptr, // 10
-      nullptr, // 11
-  };
-
-  dpsg::posix::process_t operator()(std::string_view output_file);
+  // Given to java before `-jar`
+  std::vector<std::string> jvm_flags;
+  // Empty when class data sharing is disabled or unavailable
+  std::shared_ptr<class_data_archive> class_data;
+
+  // When measuring latencies, the players are wrapped in a proxy command
+  // (`runner proxy <latency file> <player command>`) writing the response
+  // times of each turn to the given directory.
+  std::filesystem::path latency_directory;
+  std::string self_path;
+  // The proxy also records the input of the players into this directory
+  // (--record), one transcript per player and game
+  std::filesystem::path record_directory;
+
+  // Takes the stderr of every process started. Without it, the stderr pipes
+  // are left to the caller.
+  std::shared_ptr<stderr_capture> stderr_logs;
+
+  // Samples the players of every game (--profile)
+  std::shared_ptr<player_profiler> profiler;
+
+  // Data files every player can map (--preload), listed in the environment
+  std::shared_ptr<preloaded_data> preload;
+
+  // Directory the games are started in (for `runner daemon`, that of the
+  // client), the current one when empty
+  std::filesystem::path working_directory;
+
+  // Each game goes into its own cgroup when possible, otherwise the memory
+  // limit is applied to the players with setrlimit, by their proxy
+  resource_limits limits;
+  std::shared_ptr<cgroup_manager> cgroups;
+
+  dpsg::posix::process_t operator()(const game_t &game, game_id id) const;
+
+  // Starts player `player` (0 or 1) of a game, through `sh -c`.
+  dpsg::posix::process_t spawn_player(const game_t &game, game_id id,
+                                      int player) const;
+
+  // Command line of a player, as given to the referee
+  std::string player_command(const game_t &game, game_id id, int player) const;
+
+  // To be called once the referee of the game has exited
+  resource_usage release(game_id id, const struct rusage &referee_usage);
+
+  bool measures_latency() const { return !latency_directory.empty(); }
+  bool records() const { return !record_directory.empty(); }
+  bool limits_players() const {
+    return limits.memory_max > 0 && !uses_cgroups();
+  }
+  // Whether the players are wrapped in `runner proxy`
+  bool proxies() const {
+    return measures_latency() || records() || limits_players();
+  }
+  bool uses_cgroups() const { return cgroups && cgroups->available(); }
+  bool uses_class_data() const { return class_data && class_data->enabled(); }
+
+private:
+  // Starts a process of the game, in its cgroup if there is one
+  dpsg::posix::process_t _spawn(const char *const *args, game_id id) const;
 };
 
 runner make_runner(const option_t &opts);
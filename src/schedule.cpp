@@ -0,0 +1,224 @@
+#include "schedule.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> read_seed_file(const fs::path &path) {
+  std::ifstream in{path};
+  if (!in) {
+    std::cerr << "Cannot open seed file " << path << std::endl;
+    exit(1);
+  }
+  std::vector<std::string> seeds;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (auto comment = line.find('#'); comment != std::string::npos) {
+      line.resize(comment);
+    }
+    std::istringstream fields{line};
+    std::string seed;
+    if (fields >> seed) {
+      seeds.push_back(std::move(seed));
+    }
+  }
+  if (seeds.empty()) {
+    std::cerr << "No seed in " << path << std::endl;
+    exit(1);
+  }
+  return seeds;
+}
+
+std::vector<std::string> read_seeds(std::string_view path, size_t count) {
+  if (!path.empty()) {
+    return read_seed_file(path);
+  }
+  std::vector<std::string> seeds;
+  std::random_device entropy;
+  std::mt19937_64 random{((uint64_t)entropy() << 32) | entropy()};
+  for (size_t i = 0; i < count; ++i) {
+    seeds.push_back(std::to_string(random() & 0x7fffffff));
+  }
+  return seeds;
+}
+
+void duration_history::average::add(double x) {
+  games = std::min(games + 1, memory);
+  ms += (x - ms) / games;
+}
+
+void duration_history::_add(const std::string &matchup,
+                            const std::string &seed, const average &a,
+                            int sign) {
+  _seeds[seed].add(a, sign);
+  _matchups[matchup].add(a, sign);
+  _all.add(a, sign);
+}
+
+duration_history::duration_history(fs::path path) : _path(std::move(path)) {
+  if (_path.empty()) {
+    return;
+  }
+  std::ifstream in{_path};
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.starts_with('#')) {
+      continue;
+    }
+    std::istringstream fields{line};
+    std::string matchup, seed;
+    average a;
+    if (!(fields >> matchup >> seed >> a.games >> a.ms) || a.games <= 0) {
+      continue;
+    }
+    a.games = std::min(a.games, memory);
+    _games[matchup + ' ' + seed] = a;
+    _add(matchup, seed, a);
+  }
+}
+
+std::string duration_history::matchup(std::string_view referee,
+                                      std::string_view p1,
+                                      std::string_view p2) {
+  auto hash = dpsg::fnv1a(referee);
+  hash = dpsg::fnv1a({"", 1}, hash);
+  hash = dpsg::fnv1a(p1, hash);
+  hash = dpsg::fnv1a({"", 1}, hash);
+  hash = dpsg::fnv1a(p2, hash);
+  char key[17];
+  std::snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+  return key;
+}
+
+void duration_history::record(const std::string &matchup,
+                              const std::string &seed, double ms) {
+  if (seed.empty() ||
+      std::any_of(seed.begin(), seed.end(),
+                  [](unsigned char c) { return std::isspace(c); })) {
+    return;
+  }
+  auto &game = _games[matchup + ' ' + seed];
+  _add(matchup, seed, game, -1);
+  game.add(ms);
+  _add(matchup, seed, game);
+}
+
+std::optional<double>
+duration_history::predict(const std::string &matchup,
+                          const std::string &seed) const {
+  if (auto g = _games.find(matchup + ' ' + seed); g != _games.end()) {
+    return g->second.ms;
+  }
+  auto m = _matchups.find(matchup);
+  if (auto s = _seeds.find(seed); s != _seeds.end()) {
+    if (m == _matchups.end() || _all.ms <= 0) {
+      return s->second.mean();
+    }
+    return s->second.mean() * m->second.mean() / _all.mean();
+  }
+  if (m != _matchups.end()) {
+    return m->second.mean();
+  }
+  return std::nullopt;
+}
+
+void duration_history::save() const {
+  if (_path.empty()) {
+    return;
+  }
+  auto temporary = _path;
+  temporary += ".tmp";
+  {
+    std::ofstream out{temporary};
+    if (!out) {
+      std::cerr << "Cannot write duration history " << temporary << std::endl;
+      return;
+    }
+    out << "# <matchup> <seed> <games> <mean ms>\n";
+    for (auto &[key, a] : _games) {
+      out << key << ' ' << a.games << ' ' << a.ms << '\n';
+    }
+  }
+  std::error_code ec;
+  fs::rename(temporary, _path, ec);
+  if (ec) {
+    std::cerr << "Cannot write duration history " << _path << ": "
+              << ec.message() << std::endl;
+  }
+}
+
+double makespan(const std::vector<double> &durations_ms,
+                const std::vector<size_t> &order, int slot_count) {
+  // Time at which each slot becomes free
+  std::priority_queue<double, std::vector<double>, std::greater<>> slots;
+  for (int i = 0; i < slot_count; ++i) {
+    slots.push(0);
+  }
+  double end = 0;
+  for (auto game : order) {
+    const double finish = slots.top() + durations_ms[game];
+    slots.pop();
+    slots.push(finish);
+    end = std::max(end, finish);
+  }
+  return end;
+}
+
+launch_plan
+longest_first(const std::vector<std::optional<double>> &expected_ms,
+              int slot_count) {
+  launch_plan plan;
+  plan.order.resize(expected_ms.size());
+  std::iota(plan.order.begin(), plan.order.end(), 0);
+
+  double known = 0;
+  size_t known_count = 0;
+  for (auto &e : expected_ms) {
+    if (e) {
+      known += *e;
+      known_count++;
+    }
+  }
+  if (known_count == 0) {
+    return plan;
+  }
+  std::vector<double> durations;
+  durations.reserve(expected_ms.size());
+  for (auto &e : expected_ms) {
+    durations.push_back(e.value_or(known / (double)known_count));
+  }
+
+  plan.unordered_makespan_ms = makespan(durations, plan.order, slot_count);
+  std::stable_sort(plan.order.begin(), plan.order.end(),
+                   [&](size_t l, size_t r) {
+                     return durations[l] > durations[r];
+                   });
+  plan.makespan_ms = makespan(durations, plan.order, slot_count);
+  return plan;
+}
+
+launch_plan plan_launches(const duration_history &history,
+                          const std::string &matchup,
+                          const std::vector<std::string> &seeds, int count,
+                          int slot_count) {
+  if (seeds.empty()) {
+    return {};
+  }
+  std::vector<std::optional<double>> expected;
+  expected.reserve((size_t)count);
+  for (int i = 0; i < count; ++i) {
+    expected.push_back(
+        history.predict(matchup, seeds[(size_t)i % seeds.size()]));
+  }
+  return longest_first(expected, slot_count);
+}
@@ -0,0 +1,99 @@
+#ifndef HEADER_GUARD_DPSG_SCHEDULE_HPP
+#define HEADER_GUARD_DPSG_SCHEDULE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Seeds to play, one per line, '#' starting a comment. Exits the program when
+// the file can't be read or holds no seed.
+std::vector<std::string> read_seed_file(const std::filesystem::path &path);
+
+// Seeds of the file at `path` (--seeds), else `count` random ones
+std::vector<std::string> read_seeds(std::string_view path, size_t count);
+
+// Game durations of the previous runs, by matchup (referee and players) and
+// seed, kept in a text file of lines `<matchup> <seed> <games> <mean ms>`.
+// Recent games weigh more, so that the predictions follow the players as they
+// get faster or slower.
+class duration_history {
+public:
+  // Games averaged at most, older ones fading out
+  constexpr static inline int memory = 20;
+
+  // Nothing is read nor saved with an empty path
+  explicit duration_history(std::filesystem::path path);
+
+  static std::string matchup(std::string_view referee, std::string_view p1,
+                             std::string_view p2);
+
+  void record(const std::string &matchup, const std::string &seed, double ms);
+
+  // Expected duration of a game: its own history when there is one, else the
+  // seed's in other matchups scaled by how long this matchup's games are
+  // compared to the others, else the matchup's average.
+  std::optional<double> predict(const std::string &matchup,
+                                const std::string &seed) const;
+
+  // Rewrites the file, atomically
+  void save() const;
+
+private:
+  struct average {
+    int games = 0;
+    double ms = 0;
+    void add(double x);
+  };
+  // Average of the averages of several games, weighted by their game counts
+  struct total {
+    double games = 0;
+    double ms = 0;
+    void add(const average &a, int sign = 1) {
+      games += sign * a.games;
+      ms += sign * a.games * a.ms;
+    }
+    double mean() const { return ms / games; }
+  };
+  void _add(const std::string &matchup, const std::string &seed,
+            const average &a, int sign = 1);
+
+  std::filesystem::path _path;
+  std::unordered_map<std::string, average> _games;
+  std::unordered_map<std::string, total> _seeds;
+  std::unordered_map<std::string, total> _matchups;
+  total _all;
+};
+
+// Order in which to launch games of known durations on `slot_count` slots:
+// longest first (LPT), so that the run doesn't end with a single slot busy on
+// a long game. Unknown durations are taken as the average of the known ones.
+struct launch_plan {
+  // Indices of the games, in launch order
+  std::vector<size_t> order;
+  // Expected time until the last game ends, in that order and in the
+  // original one
+  double makespan_ms = 0;
+  double unordered_makespan_ms = 0;
+};
+
+launch_plan
+longest_first(const std::vector<std::optional<double>> &expected_ms,
+              int slot_count);
+
+// Plan of a run of `count` games cycling through `seeds`, from the durations
+// `history` expects for `matchup`. Empty without seeds.
+launch_plan plan_launches(const duration_history &history,
+                          const std::string &matchup,
+                          const std::vector<std::string> &seeds, int count,
+                          int slot_count);
+
+// Time until the last game ends when each game starts on the first free slot
+double makespan(const std::vector<double> &durations_ms,
+                const std::vector<size_t> &order, int slot_count);
+
+#endif // HEADER_GUARD_DPSG_SCHEDULE_HPP
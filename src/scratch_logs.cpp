@@ -0,0 +1,147 @@
+#include "scratch_logs.hpp"
+#include "posix.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+keep_policy keep_policy::parse(std::string_view policy) {
+  keep_policy p;
+  const auto number = [&](std::string_view item, std::string_view value,
+                          auto &out) {
+    auto r = std::from_chars(value.data(), value.data() + value.size(), out);
+    if (r.ec != std::errc{} || r.ptr != value.data() + value.size() ||
+        out <= 0) {
+      std::cerr << "Invalid keep policy item '" << item << "'" << std::endl;
+      exit(1);
+    }
+  };
+
+  while (!policy.empty()) {
+    auto comma = policy.find(',');
+    auto item = policy.substr(0, comma);
+    policy = comma == std::string_view::npos ? "" : policy.substr(comma + 1);
+
+    auto eq = item.find('=');
+    auto name = item.substr(0, eq);
+    auto value = eq == std::string_view::npos ? "" : item.substr(eq + 1);
+    if (name == "errors") {
+      p.errors = true;
+    } else if (name == "timeouts") {
+      p.timeouts = true;
+    } else if (name == "draws") {
+      p.draws = true;
+    } else if (name == "extreme") {
+      number(item, value, p.extreme_difference);
+    } else if (name == "sample") {
+      number(item, value, p.sample);
+    } else {
+      std::cerr << "Invalid keep policy item '" << item
+                << "', expected errors, timeouts, draws, extreme=<points> or "
+                   "sample=<n>"
+                << std::endl;
+      exit(1);
+    }
+  }
+  return p;
+}
+
+scratch_logs::scratch_logs(keep_policy policy, log_analyzer *analyzer)
+    : _policy(policy), _analyzer(analyzer) {
+  std::error_code ec;
+  fs::path base = fs::is_directory("/dev/shm", ec) ? fs::path{"/dev/shm"}
+                                                   : fs::temp_directory_path();
+  _directory = base / ("cg-runner-logs-" +
+                       std::to_string((uint64_t)dpsg::posix::getpid()));
+  fs::create_directories(_directory, ec);
+  if (ec) {
+    std::cerr << "Failed to create " << _directory << ": " << ec.message()
+              << std::endl;
+    exit(1);
+  }
+}
+
+scratch_logs::~scratch_logs() {
+  _pool.wait();
+  std::error_code ec;
+  fs::remove_all(_directory, ec);
+}
+
+std::string scratch_logs::scratch_path(std::string_view destination) const {
+  return _directory / fs::path{destination}.filename();
+}
+
+void scratch_logs::finished(game_id id, const run_result &result) {
+  unsigned reasons = 0;
+  if (_policy.errors && result.has_error()) {
+    reasons |= 1 << kept_logs::error;
+  }
+  if (_policy.draws && !result.has_error() &&
+      result.winner() == run_result::winner::draw) {
+    reasons |= 1 << kept_logs::draw;
+  }
+  if (_policy.extreme_difference > 0 && !result.has_error() &&
+      std::abs(result.p1_score - result.p2_score) >=
+          _policy.extreme_difference) {
+    reasons |= 1 << kept_logs::extreme;
+  }
+  if (_policy.sample > 0 && _random() % _policy.sample == 0) {
+    reasons |= 1 << kept_logs::sampled;
+  }
+
+  fs::path scratch = result.output_file;
+  std::lock_guard lock{_mutex};
+  _pending.emplace(id, pending{scratch, scratch.filename(), reasons});
+}
+
+void scratch_logs::release(game_id id) {
+  pending game;
+  {
+    std::lock_guard lock{_mutex};
+    auto it = _pending.find(id);
+    if (it == _pending.end()) {
+      return;
+    }
+    game = std::move(it->second);
+    _pending.erase(it);
+  }
+
+  _pool.submit([this, game = std::move(game)]() mutable {
+    if (_policy.needs_log() || _analyzer != nullptr) {
+      game_metrics metrics;
+      dpsg::posix::mapped_file file{game.scratch.c_str()};
+      bool ok = file.is_open() && extract_metrics(file.view(), metrics);
+      if (ok && _policy.timeouts &&
+          (metrics.faults[0].kind == game_metrics::fault_kind::timeout ||
+           metrics.faults[1].kind == game_metrics::fault_kind::timeout)) {
+        game.reasons |= 1 << kept_logs::timeout;
+      }
+      if (_analyzer != nullptr) {
+        _analyzer->add(game.destination.string(), ok ? &metrics : nullptr);
+      }
+    }
+
+    std::error_code ec;
+    if (game.reasons != 0) {
+      fs::copy_file(game.scratch, game.destination,
+                    fs::copy_options::overwrite_existing, ec);
+    }
+    fs::remove(game.scratch, ec);
+
+    std::lock_guard lock{_mutex};
+    _summary.games++;
+    if (game.reasons != 0) {
+      _summary.kept++;
+      for (int r = 0; r < kept_logs::reason_count; ++r) {
+        _summary.reasons[r] += (game.reasons >> r) & 1;
+      }
+    }
+  });
+}
+
+const kept_logs &scratch_logs::finish() {
+  _pool.wait();
+  return _summary;
+}
@@ -0,0 +1,87 @@
+#ifndef HEADER_GUARD_DPSG_SCRATCH_LOGS_HPP
+#define HEADER_GUARD_DPSG_SCRATCH_LOGS_HPP
+
+#include "engine.hpp"
+#include "game_log.hpp"
+#include "statistics.hpp"
+#include "thread_pool.hpp"
+
+#include <filesystem>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Which game logs to keep (--keep): a comma-separated list of reasons, e.g.
+// `errors,timeouts,extreme=30,sample=100`.
+struct keep_policy {
+  bool errors = false;
+  bool timeouts = false;
+  bool draws = false;
+  // Keep games won by at least that many points, 0 to disable
+  int extreme_difference = 0;
+  // Keep one game in `sample` at random, 0 to disable
+  unsigned sample = 0;
+
+  // Exits the program on an invalid policy
+  static keep_policy parse(std::string_view policy);
+
+  bool needs_log() const { return timeouts; }
+};
+
+// What happened to the logs of a run
+struct kept_logs {
+  enum reason { error, timeout, draw, extreme, sampled, reason_count };
+
+  size_t games = 0;
+  size_t kept = 0;
+  // Games kept for each reason, a game possibly having several
+  size_t reasons[reason_count] = {};
+};
+
+// Game logs written to tmpfs (/dev/shm) first, and only copied to their final
+// place for games matching the keep policy. The other logs never touch the
+// disk.
+class scratch_logs {
+public:
+  // `analyzer` (optional) receives the metrics of every log, kept or not.
+  scratch_logs(keep_policy policy, log_analyzer *analyzer = nullptr);
+  scratch_logs(const scratch_logs &) = delete;
+  scratch_logs &operator=(const scratch_logs &) = delete;
+  // Waits for the pending copies
+  ~scratch_logs();
+
+  // Path of the log of the game whose persistent log would be `destination`
+  std::string scratch_path(std::string_view destination) const;
+
+  // To be called with the result of the game, then with its id once its
+  // referee exited and the log is complete.
+  void finished(game_id id, const run_result &result);
+  void release(game_id id);
+
+  // Waits for the pending copies.
+  const kept_logs &finish();
+
+private:
+  struct pending {
+    std::filesystem::path scratch;
+    std::filesystem::path destination;
+    // Reasons known from the result alone
+    unsigned reasons = 0;
+  };
+
+  keep_policy _policy;
+  log_analyzer *_analyzer;
+  std::filesystem::path _directory;
+  std::mt19937 _random{std::random_device{}()};
+
+  std::mutex _mutex;
+  std::unordered_map<game_id, pending> _pending;
+  kept_logs _summary;
+
+  // Last, so that the workers are done before the rest goes away
+  thread_pool _pool{1};
+};
+
+#endif // HEADER_GUARD_DPSG_SCRATCH_LOGS_HPP
@@ -0,0 +1,216 @@
+#include "shard.hpp"
+#include "options.hpp"
+#include "presentation.hpp"
+#include "result_store.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr std::string_view magic = "# cg-runner results";
+
+const char *outcome_name(uint8_t outcome) {
+  switch (outcome) {
+  case result_store::p1_wins:
+    return "p1";
+  case result_store::p2_wins:
+    return "p2";
+  case result_store::p1_error:
+    return "p1-error";
+  case result_store::p2_error:
+    return "p2-error";
+  case result_store::both_error:
+    return "both-error";
+  default:
+    return "draw";
+  }
+}
+} // namespace
+
+std::vector<std::string> shard_seeds(const std::vector<std::string> &seeds,
+                                     int games, int index, int count) {
+  std::vector<std::string> shard;
+  for (int k = index - 1; k < games; k += count) {
+    if (!seeds.empty()) {
+      shard.push_back(seeds[(size_t)k % seeds.size()]);
+    } else {
+      // An odd multiplier makes the LCG step a bijection modulo 2^31
+      shard.push_back(
+          std::to_string(((uint64_t)k * 1103515245 + 12345) & 0x7fffffff));
+    }
+  }
+  return shard;
+}
+
+int shard_games(int games, int index, int count) {
+  return std::max(0, (games - index + count) / count);
+}
+
+void write_result_header(std::ostream &out, const result_header &header) {
+  out << magic << '\n'
+      << "# referee " << header.referee << '\n'
+      << "# player1 " << header.player1 << '\n'
+      << "# player2 " << header.player2 << '\n'
+      << "# shard " << header.shard_index << '/' << header.shard_count << '\n'
+      << "# games " << header.games << '\n'
+      << "# started " << header.started_ms << '\n'
+      << "# host " << header.host << '\n'
+      << "# <seed> <p1 score> <p2 score> <ms> <outcome>\n";
+}
+
+void write_result(std::ostream &out, const run_result &result) {
+  // Nothing to tell the shards' games apart by
+  if (result.seed.empty()) {
+    return;
+  }
+  out << result.seed << ' ' << result.p1_score << ' ' << result.p2_score
+      << ' '
+      << std::chrono::duration<double, std::milli>(result.duration).count()
+      << ' ' << outcome_name(result_store::outcome_of(result)) << '\n';
+}
+
+bool read_results(const fs::path &path, result_header &header,
+                  const std::function<void(const run_result &)> &on_game) {
+  std::ifstream in{path};
+  if (!in) {
+    std::cerr << "Cannot open results file " << path << std::endl;
+    return false;
+  }
+  std::string line;
+  if (!std::getline(in, line) || line != magic) {
+    std::cerr << path << " isn't a results file" << std::endl;
+    return false;
+  }
+
+  run_result result{};
+  while (std::getline(in, line)) {
+    if (line.starts_with("# ")) {
+      std::istringstream fields{line.substr(2)};
+      std::string field;
+      fields >> field;
+      std::string value;
+      std::getline(fields >> std::ws, value);
+      if (field == "referee") {
+        header.referee = value;
+      } else if (field == "player1") {
+        header.player1 = value;
+      } else if (field == "player2") {
+        header.player2 = value;
+      } else if (field == "shard") {
+        char slash;
+        std::istringstream{value} >> header.shard_index >> slash >>
+            header.shard_count;
+      } else if (field == "games") {
+        header.games = std::atoi(value.c_str());
+      } else if (field == "started") {
+        header.started_ms = std::atoll(value.c_str());
+      } else if (field == "host") {
+        header.host = value;
+      }
+      continue;
+    }
+    // The outcome follows from the scores
+    std::istringstream fields{line};
+    double ms;
+    if (fields >> result.seed >> result.p1_score >> result.p2_score >> ms) {
+      result.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double, std::milli>(ms));
+      on_game(result);
+    }
+  }
+  return true;
+}
+
+int run_merge(int argc, const char **argv) {
+  auto opts = parse_options(argc, argv);
+  if (opts.arguments.empty()) {
+    std::cerr << "Usage: runner merge <results files...>" << std::endl;
+    return 1;
+  }
+
+  statistics_t stats{};
+  result_tally results;
+  std::vector<std::pair<result_header, size_t>> files;
+  // Files of each shard, to tell about the missing and duplicate ones
+  std::map<int, int> shards;
+  for (auto path : opts.arguments) {
+    result_header header;
+    size_t games = 0;
+    if (!read_results(path, header, [&](const run_result &result) {
+          aggregate(result, stats);
+          results.push_back(result);
+          games++;
+        })) {
+      return 1;
+    }
+    if (!files.empty()) {
+      auto &first = files.front().first;
+      if (header.referee != first.referee || header.player1 != first.player1 ||
+          header.player2 != first.player2) {
+        std::cerr << path << " isn't a run of the same referee and players"
+                  << std::endl;
+        return 1;
+      }
+      if (header.shard_count != first.shard_count) {
+        std::cerr << path << " is a shard of " << header.shard_count
+                  << ", not " << first.shard_count << std::endl;
+        return 1;
+      }
+      // The shards of runs of different lengths play different seeds
+      if (header.games != first.games) {
+        std::cerr << path << " is a run of " << header.games << " games, not "
+                  << first.games << std::endl;
+        return 1;
+      }
+    }
+    shards[header.shard_index]++;
+    files.emplace_back(std::move(header), games);
+  }
+  stats.total_games = (int)results.size();
+
+  {
+    presenter p{std::cout};
+    p.update_statistics(stats);
+    p.print_summary(stats, results);
+  }
+
+  namespace vt100 = dpsg::vt100;
+  for (size_t i = 0; i < files.size(); ++i) {
+    auto &[header, games] = files[i];
+    std::cout << vt100::cyan << opts.arguments[i] << vt100::reset << ": "
+              << games << " of "
+              << (header.shard_count > 0
+                      ? shard_games(header.games, header.shard_index,
+                                    header.shard_count)
+                      : header.games)
+              << " games";
+    if (header.shard_count > 0) {
+      std::cout << ", shard " << header.shard_index << '/'
+                << header.shard_count;
+    }
+    if (!header.host.empty()) {
+      std::cout << ", on " << header.host;
+    }
+    std::cout << '\n';
+  }
+  const int count = files.front().first.shard_count;
+  for (int s = 1; s <= count; ++s) {
+    if (shards[s] == 0) {
+      std::cout << vt100::yellow << "Shard " << s << '/' << count
+                << " is missing" << vt100::reset << '\n';
+    } else if (shards[s] > 1) {
+      std::cout << vt100::yellow << "Shard " << s << '/' << count
+                << " was merged " << shards[s] << " times" << vt100::reset
+                << '\n';
+    }
+  }
+  std::cout << std::flush;
+  return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef HEADER_GUARD_DPSG_SHARD_HPP
+#define HEADER_GUARD_DPSG_SHARD_HPP
+
+#include "statistics.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Seeds of shard `index` (from 1) out of `count` in a run of `games` games,
+// spread over machines that don't talk to each other (--shard i/N). The shard
+// plays the games whose number is `index - 1` modulo `count`, game k playing
+// seeds[k % seeds.size()], or without seeds the k-th number of a fixed
+// permutation of [0, 2^31), so that no two shards play the same seed.
+std::vector<std::string> shard_seeds(const std::vector<std::string> &seeds,
+                                     int games, int index, int count);
+// How many of the `games` games of the run shard `index` plays
+int shard_games(int games, int index, int count);
+
+// What a results file says about its run.
+struct result_header {
+  std::string referee;
+  std::string player1;
+  std::string player2;
+  // 0 out of 0 when the run wasn't sharded
+  int shard_index = 0;
+  int shard_count = 0;
+  // Games the run was to play, all shards together, 0 when only bounded by
+  // time
+  int games = 0;
+  // Unix time in milliseconds
+  int64_t started_ms = 0;
+  std::string host;
+};
+
+// A results file (--results, and the default of --shard) starts with
+// `# cg-runner results` and `# <field> <value>` lines describing the run,
+// followed by one line per game: `<seed> <p1 score> <p2 score> <ms>
+// <outcome>`. Games lines are those of a trace, so `runner simulate` reads
+// results files too.
+void write_result_header(std::ostream &out, const result_header &header);
+void write_result(std::ostream &out, const run_result &result);
+
+// Reads a results file one game at a time, whatever its size. Returns false
+// with a message on stderr when it isn't one.
+bool read_results(const std::filesystem::path &path, result_header &header,
+                  const std::function<void(const run_result &)> &on_game);
+
+// Entry point of `runner merge <results files...>`, argv[0] being "merge":
+// the summary of the games of every file, as if played by a single run.
+int run_merge(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_SHARD_HPP
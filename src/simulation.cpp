@@ -0,0 +1,353 @@
+#include "simulation.hpp"
+#include "options.hpp"
+#include "posix.hpp"
+#include "run_driver.hpp"
+#include "schedule.hpp"
+#include "throughput.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+void write_trace(std::ostream &out, const run_result &result) {
+  // Nothing to look the game up by when replaying
+  if (result.seed.empty()) {
+    return;
+  }
+  out << result.seed << ' ' << result.p1_score << ' ' << result.p2_score
+      << ' '
+      << std::chrono::duration<double, std::milli>(result.duration).count()
+      << '\n';
+}
+
+std::vector<trace_game> read_trace(const fs::path &path) {
+  std::ifstream in{path};
+  if (!in) {
+    std::cerr << "Cannot open trace " << path << std::endl;
+    exit(1);
+  }
+  std::vector<trace_game> trace;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.starts_with('#')) {
+      continue;
+    }
+    std::istringstream fields{line};
+    trace_game g;
+    if (fields >> g.seed >> g.p1_score >> g.p2_score >> g.ms && g.ms >= 0) {
+      trace.push_back(std::move(g));
+    }
+  }
+  if (trace.empty()) {
+    std::cerr << "No game in trace " << path << std::endl;
+    exit(1);
+  }
+  return trace;
+}
+
+simulated_engine::simulated_engine(int slot_count,
+                                   const std::vector<trace_game> &trace)
+    : _slot_count(slot_count), _trace(trace) {
+  for (size_t i = 0; i < _trace.size(); ++i) {
+    _by_seed[_trace[i].seed].first.push_back(i);
+  }
+}
+
+game_id simulated_engine::submit(game_t game, callback on_done) {
+  const auto id = _next_id++;
+  _pending.push_back(pending_game{id, std::move(game), std::move(on_done)});
+  return id;
+}
+
+const trace_game &simulated_engine::_next_game(const std::string &seed) {
+  auto it = _by_seed.find(seed);
+  if (it == _by_seed.end()) {
+    return _trace[_next_unknown++ % _trace.size()];
+  }
+  auto &[games, used] = it->second;
+  return _trace[games[used++ % games.size()]];
+}
+
+void simulated_engine::_fill_slots() {
+  while ((int)_active.size() < _slot_count && !_pending.empty()) {
+    auto game = std::move(_pending.front());
+    _pending.pop_front();
+    const auto &played = _next_game(game.game.seed);
+    _active.push_back(slot{std::move(game), &played, _now_ms,
+                           _now_ms + played.ms});
+    if (_on_launch) {
+      _on_launch(_active.back().game.id, _active.back().game.game);
+    }
+  }
+}
+
+void simulated_engine::_exit(const slot &s) {
+  _busy_ms += _now_ms - s.started_ms;
+  if (_on_exit) {
+    struct rusage usage {};
+    _on_exit(s.game.id, usage);
+  }
+}
+
+size_t simulated_engine::poll(std::chrono::milliseconds timeout) {
+  _fill_slots();
+  if (_active.empty()) {
+    return 0;
+  }
+  // Games ending at the same time end in launch order
+  auto first = std::min_element(
+      _active.begin(), _active.end(),
+      [](const slot &l, const slot &r) { return l.ends_ms < r.ends_ms; });
+  if (timeout.count() >= 0 && first->ends_ms > _now_ms + timeout.count()) {
+    _now_ms += (double)timeout.count();
+    return 0;
+  }
+  slot s = std::move(*first);
+  _active.erase(first);
+  _now_ms = s.ends_ms;
+
+  run_result result{};
+  result.output_file = s.game.game.output_file;
+  result.p1_score = s.played->p1_score;
+  result.p2_score = s.played->p2_score;
+  result.seed = s.played->seed;
+  result.duration =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::duration<double, std::milli>(s.played->ms));
+  aggregate(result, _statistics);
+  if (s.game.on_done) {
+    s.game.on_done(s.game.id, s.game.game, result);
+  }
+  _exit(s);
+  return 1;
+}
+
+void simulated_engine::run() {
+  while (!idle()) {
+    poll();
+  }
+}
+
+void simulated_engine::cancel() {
+  _pending.clear();
+  auto killed = std::move(_active);
+  _active.clear();
+  for (auto &s : killed) {
+    _exit(s);
+  }
+}
+
+namespace {
+namespace vt100 = dpsg::vt100;
+
+enum class policy { barrier, refill, longest_first, early_stop };
+
+struct policy_outcome {
+  const char *name;
+  double makespan_ms = 0;
+  // Share of the slot time spent on games
+  double utilisation = 0;
+  int games = 0;
+  // When player 1's score was first known to be above or below 50%, 0 games
+  // if never
+  int decision_games = 0;
+  double decision_ms = 0;
+};
+
+// Half width of the interval at each look, in standard deviations. Looking
+// after every game, 3 keeps the odds of a wrong decision close to those of a
+// single look at 95% (Haybittle-Peto)
+constexpr double decision_z = 3;
+
+bool decided(const statistics_t &stats) {
+  if (stats.significant_games() == 0) {
+    return false;
+  }
+  const auto [low, high] = stats.p1_score_interval(decision_z);
+  return high < 0.5 || low > 0.5;
+}
+
+// Drives the simulated engine with the driver of the runner, but for the
+// batches of the barrier policy
+policy_outcome simulate(policy p, const char *name,
+                        const std::vector<trace_game> &trace,
+                        const std::vector<std::string> &seeds,
+                        const launch_plan &plan,
+                        const duration_history &history,
+                        const option_t &opts) {
+  simulated_engine games{opts.parallel_processes, trace};
+  policy_outcome outcome{.name = name};
+  const bool planned = p == policy::longest_first || p == policy::early_stop;
+  const auto now = [&games] {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double, std::milli>(games.now_ms()));
+  };
+  throughput_statistics speed{now()};
+
+  const auto on_result = [&](game_id, const game_t &, run_result &result) {
+    outcome.games++;
+    speed.add(now(), result.duration);
+    if (outcome.decision_games == 0 && decided(games.statistics())) {
+      outcome.decision_games = outcome.games;
+      outcome.decision_ms = games.now_ms();
+    }
+  };
+  const auto seed_of = [&](int run_count) {
+    const auto index =
+        planned ? plan.order[(size_t)run_count % plan.order.size()]
+                : (size_t)run_count;
+    return seeds[index % seeds.size()];
+  };
+  const auto submit = [&](int run_count) {
+    game_t g;
+    g.seed = seed_of(run_count);
+    games.submit(std::move(g), on_result);
+  };
+
+  if (p == policy::barrier) {
+    // A batch of as many games as slots, waited for before the next one. With
+    // --at-deadline kill, the batch in flight at the deadline is cancelled.
+    const double deadline_ms = 1000.0 * opts.budget;
+    const bool kill = opts.budget > 0 && opts.kill_at_deadline;
+    int submitted = 0;
+    while (submitted < opts.process_count &&
+           (opts.budget == 0 || games.now_ms() < deadline_ms)) {
+      while (submitted < opts.process_count &&
+             (int)games.pending() < games.slot_count()) {
+        submit(submitted++);
+      }
+      while (!games.idle()) {
+        if (!kill) {
+          games.poll();
+        } else if (games.now_ms() >= deadline_ms) {
+          games.cancel();
+        } else {
+          games.poll(std::chrono::milliseconds(
+              (long)std::ceil(deadline_ms - games.now_ms())));
+        }
+      }
+    }
+  } else {
+    const auto matchup = duration_history::matchup("", "", "");
+    run_driver driver{
+        games,
+        {.games = opts.process_count,
+         .budget = std::chrono::seconds(opts.budget),
+         .kill_at_deadline = opts.kill_at_deadline},
+        now,
+        submit,
+        [&](int run_count) -> std::optional<double> {
+          if (speed.count > 0) {
+            return speed.duration_quantile_ms(0.9);
+          }
+          return history.predict(matchup, seed_of(run_count));
+        }};
+    std::function<bool()> stop;
+    if (p == policy::early_stop) {
+      stop = [&outcome] { return outcome.decision_games > 0; };
+    }
+    driver.run(stop);
+  }
+
+  outcome.makespan_ms = games.now_ms();
+  if (outcome.makespan_ms > 0) {
+    outcome.utilisation = games.busy_ms() / (outcome.makespan_ms *
+                                             (double)opts.parallel_processes);
+  }
+  return outcome;
+}
+
+void print_outcome(const policy_outcome &o) {
+  std::cout << vt100::cyan << std::left << std::setw(20) << o.name
+            << vt100::reset << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << o.makespan_ms / 1000 << 's' << std::setw(11)
+            << o.utilisation * 100 << '%' << std::setw(8) << o.games;
+  if (o.decision_games > 0) {
+    std::cout << std::setw(12) << o.decision_games << " games after "
+              << o.decision_ms / 1000 << 's';
+  } else {
+    std::cout << std::setw(12) << "undecided";
+  }
+  std::cout << std::defaultfloat << std::setprecision(6) << '\n';
+}
+} // namespace
+
+int run_simulation(int argc, const char **argv) {
+  auto opts = parse_options(argc, argv);
+  if (opts.arguments.size() != 1) {
+    std::cerr << "Usage: runner simulate [-c games] [-p slots] [--budget "
+                 "<time>] <trace>"
+              << std::endl;
+    return 1;
+  }
+  // As in a run, -c only caps the games played within a budget
+  if (opts.budget > 0 && !opts.process_count_given) {
+    opts.process_count = statistics_t::unbounded;
+  }
+  const bool unbounded = opts.process_count == statistics_t::unbounded;
+  if (opts.process_count <= 0) {
+    std::cerr << "-c must be > 0" << std::endl;
+    return 1;
+  }
+  if (opts.parallel_processes <= 0) {
+    std::cerr << "-p must be > 0" << std::endl;
+    return 1;
+  }
+  const auto started = dpsg::posix::monotonic_now();
+  const auto trace = read_trace(opts.arguments[0]);
+
+  // The seeds in the order they were first played, and the plan the runner
+  // would make with the trace as its history
+  std::vector<std::string> seeds;
+  std::unordered_set<std::string> seen;
+  duration_history history{""};
+  const auto matchup = duration_history::matchup("", "", "");
+  for (auto &g : trace) {
+    if (seen.insert(g.seed).second) {
+      seeds.push_back(g.seed);
+    }
+    history.record(matchup, g.seed, g.ms);
+  }
+  const auto plan = plan_launches(
+      history, matchup, seeds,
+      unbounded ? (int)seeds.size() : opts.process_count,
+      opts.parallel_processes);
+
+  if (unbounded) {
+    std::cout << opts.budget << "s of games";
+  } else {
+    std::cout << opts.process_count << " games";
+    if (opts.budget > 0) {
+      std::cout << " within " << opts.budget << 's';
+    }
+  }
+  std::cout << " on " << opts.parallel_processes << " slots, from "
+            << trace.size() << " games on " << seeds.size()
+            << " seeds\n\n"
+            << vt100::faint << std::left << std::setw(20) << "Policy"
+            << std::right << std::setw(11) << "Makespan" << std::setw(12)
+            << "Utilisation" << std::setw(8) << "Games" << std::setw(12)
+            << "Decision" << vt100::reset << '\n';
+  const std::pair<policy, const char *> policies[] = {
+      {policy::barrier, "batch barrier"},
+      {policy::refill, "continuous refill"},
+      {policy::longest_first, "longest first"},
+      {policy::early_stop, "early stopping"},
+  };
+  for (auto [p, name] : policies) {
+    print_outcome(simulate(p, name, trace, seeds, plan, history, opts));
+  }
+  std::cout << "\nSimulated in "
+            << std::chrono::duration<double, std::milli>(
+                   dpsg::posix::monotonic_now() - started)
+                   .count()
+            << "ms" << std::endl;
+  return 0;
+}
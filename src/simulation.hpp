@@ -0,0 +1,117 @@
+#ifndef HEADER_GUARD_DPSG_SIMULATION_HPP
+#define HEADER_GUARD_DPSG_SIMULATION_HPP
+
+#include "engine.hpp"
+#include "statistics.hpp"
+
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A game of a trace (--trace): its seed, result and duration, on lines
+// `<seed> <p1 score> <p2 score> <ms>`.
+struct trace_game {
+  std::string seed;
+  int p1_score = 0;
+  int p2_score = 0;
+  double ms = 0;
+};
+
+void write_trace(std::ostream &out, const run_result &result);
+
+// Exits the program when the file can't be read or holds no game
+std::vector<trace_game> read_trace(const std::filesystem::path &path);
+
+// Plays the games of a trace against a virtual clock, with the interface of
+// `engine` so that it is driven as the runner drives the real one. A game
+// takes the duration and result recorded for its seed, the games recorded
+// with the same seed being used in turn; games whose seed isn't in the trace
+// take the trace in order. Each `poll` jumps to the end of the next game, or
+// by its timeout when shorter.
+class simulated_engine {
+public:
+  using callback = engine::callback;
+
+  simulated_engine(int slot_count, const std::vector<trace_game> &trace);
+
+  game_id submit(game_t game, callback on_done);
+
+  void on_launch(std::function<void(game_id, const game_t &)> f) {
+    _on_launch = std::move(f);
+  }
+  void on_exit(std::function<void(game_id, const struct rusage &)> f) {
+    _on_exit = std::move(f);
+  }
+
+  size_t poll(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1));
+  void run();
+
+  // Ends the games in flight now, and drops the pending ones
+  void cancel();
+
+  size_t pending() const { return _pending.size(); }
+  size_t in_flight() const { return _active.size(); }
+  bool idle() const { return _pending.empty() && _active.empty(); }
+  int slot_count() const { return _slot_count; }
+
+  const statistics_t &statistics() const { return _statistics; }
+  void reset_statistics() { _statistics = {}; }
+
+  // Virtual time since the first launch
+  double now_ms() const { return _now_ms; }
+  // Sum over the slots of the time they spent on games
+  double busy_ms() const { return _busy_ms; }
+
+private:
+  struct pending_game {
+    game_id id;
+    game_t game;
+    callback on_done;
+  };
+  struct slot {
+    pending_game game;
+    const trace_game *played;
+    double started_ms;
+    double ends_ms;
+  };
+
+  const trace_game &_next_game(const std::string &seed);
+  void _fill_slots();
+  void _exit(const slot &s);
+
+  int _slot_count;
+  const std::vector<trace_game> &_trace;
+  // Indices in the trace of the games of each seed, and how many were used
+  std::unordered_map<std::string, std::pair<std::vector<size_t>, size_t>>
+      _by_seed;
+  size_t _next_unknown = 0;
+
+  std::function<void(game_id, const game_t &)> _on_launch;
+  std::function<void(game_id, const struct rusage &)> _on_exit;
+  game_id _next_id = 0;
+  std::deque<pending_game> _pending;
+  std::vector<slot> _active;
+  statistics_t _statistics;
+  double _now_ms = 0;
+  double _busy_ms = 0;
+};
+
+// Entry point of `runner simulate [-c n] [-p n] [--budget t] <trace>`, argv[0]
+// being "simulate".
+//
+// Replays a trace under the scheduling policies of the runner and compares
+// them: batches separated by a barrier (as the rounds of `race`), continuous
+// refill of the slots, longest games first (the launch plan of --seeds with a
+// history holding the trace) and the latter stopping as soon as player 1's
+// score is known to be above or below 50%. But for the batches, the games go
+// through the driver of the runner (see run_driver.hpp), time budget
+// included; the batches stop at the deadline too, the one in flight being
+// cancelled with --at-deadline kill.
+int run_simulation(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_SIMULATION_HPP
@@ -1,12 +1,30 @@
 #ifndef HEADER_GUARD_DPSG_STATISTICS_HPP
 #define HEADER_GUARD_DPSG_STATISTICS_HPP
 
+#include <chrono>
 #include <cstddef>
+#include <limits>
 #include <string>
 #include <span>
+#include <utility>
 #include <numeric>
 #include <cmath>
 
+// Standard normal distribution function
+inline double normal_cdf(double x) {
+  return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+// Inverse of `normal_cdf`, for 0 < p < 1
+inline double normal_quantile(double p) {
+  double low = -40, high = 40;
+  for (int i = 0; i < 100; ++i) {
+    const double mid = (low + high) / 2;
+    (normal_cdf(mid) < p ? low : high) = mid;
+  }
+  return (low + high) / 2;
+}
+
 // Holder for statistics about the game.
 struct statistics_t {
   enum class player: int {
@@ -38,6 +56,10 @@ struct statistics_t {
   int total_games = 0;
   int draws = 0;
 
+  // total_games of the runs only bounded by time (--budget without -c)
+  constexpr static inline int unbounded = std::numeric_limits<int>::max();
+  bool bounded() const { return total_games != unbounded; }
+
   int left_to_run() const { return total_games - run_games(); }
 
   int significant_games() const {
@@ -57,6 +79,24 @@ struct statistics_t {
 
   double p2_win_ratio() const { return win_ratio(player::p2); }
 
+  // Share of the games won by player 1, a draw counting half, and its Wilson
+  // score interval at `z` standard deviations (1.96 for 95%)
+  double p1_score_share() const {
+    const double n = significant_games();
+    return n == 0 ? 0.5 : (player1_victory + draws / 2.0) / n;
+  }
+  std::pair<double, double> p1_score_interval(double z = 1.96) const {
+    const double n = significant_games();
+    if (n == 0) {
+      return {0, 1};
+    }
+    const double p = p1_score_share();
+    const double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+    const double half = z / (1 + z * z / n) *
+                        std::sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+    return {center - half, center + half};
+  }
+
   void draw(int p1_score, int p2_score) {
     _add_points(p1_score, p2_score);
     draws++;
@@ -71,6 +111,23 @@ struct statistics_t {
     _add_player_victory(1);
   }
 
+  // Adds the games counted in `other`, e.g. by another thread.
+  void merge(const statistics_t &other) {
+    double n = significant_games();
+    double m = other.significant_games();
+    for (int x = 0; x < 2; ++x) {
+      if (n + m > 0) {
+        player_point_avg[x] =
+            (player_point_avg[x] * n + other.player_point_avg[x] * m) /
+            (n + m);
+      }
+      player_victory[x] += other.player_victory[x];
+      player_errors[x] += other.player_errors[x];
+    }
+    draws += other.draws;
+    total_games += other.total_games;
+  }
+
   static double moving_average(double current, auto score, auto n) {
     return ((current * n) + score) / (n + 1);
   }
@@ -117,6 +174,8 @@ struct run_result {
     int scores[2];
   };
   std::string seed;
+  // From the launch of the game to its result
+  std::chrono::nanoseconds duration{};
 
   enum class error {
     none = 0,
@@ -148,6 +207,22 @@ struct run_result {
   }
   bool has_error() const { return get_error() != error::none; }
 
+  // Points earned by player `x` (0 or 1): 1 for a win, 0.5 for a draw, 0 for
+  // a loss. A player in error loses, unless both players are.
+  double points(int x) const {
+    auto e = get_error();
+    if (e == error::both_error) {
+      return 0.5;
+    } else if (e != error::none) {
+      return has_error(x == 0 ? error::p1_error : error::p2_error) ? 0 : 1;
+    }
+    auto w = winner();
+    if (w == winner::draw) {
+      return 0.5;
+    }
+    return (w == winner::p1) == (x == 0) ? 1 : 0;
+  }
+
   winner winner() const {
     if (p1_score > p2_score) {
       return winner::p1;
@@ -0,0 +1,187 @@
+#include "stderr_capture.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+using namespace dpsg::posix;
+
+namespace {
+// Room for bursts while the drain thread is busy with other pipes. Above
+// /proc/sys/fs/pipe-max-size the kernel refuses, and the default stays.
+constexpr int pipe_size = 256 << 10;
+} // namespace
+
+stderr_capture::stderr_capture(size_t capacity) : _capacity(capacity) {
+  _epoll = native::epoll_create1(EPOLL_CLOEXEC);
+  int wakeup = native::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (_epoll == -1 || wakeup == -1) {
+    perror("Failed to set up the stderr capture");
+    exit(1);
+  }
+  _wakeup = (fd_t)wakeup;
+  native::epoll_event event{.events = EPOLLIN, .data = {.fd = wakeup}};
+  native::epoll_ctl(_epoll, EPOLL_CTL_ADD, wakeup, &event);
+  _thread = std::thread{[this] { _work(); }};
+}
+
+stderr_capture::~stderr_capture() {
+  _stopping = true;
+  native::eventfd_write((int)_wakeup, 1);
+  _thread.join();
+  for (auto &[source, id] : _sources) {
+    native::close(source);
+  }
+  for (auto &[id, r] : _rings) {
+    native::close(r.file);
+  }
+  native::close((int)_wakeup);
+  native::close(_epoll);
+}
+
+void stderr_capture::add(game_id id, fd_t pipe) {
+  const int source = (int)pipe;
+  native::fcntl(source, F_SETFL, native::fcntl(source, F_GETFL) | O_NONBLOCK);
+  native::fcntl(source, F_SETPIPE_SZ, pipe_size);
+
+  std::lock_guard lock{_mutex};
+  auto &r = _rings[id];
+  if (r.file == -1) {
+    r.file = native::memfd_create("cg-runner-stderr", MFD_CLOEXEC);
+    if (r.file == -1) {
+      perror("Failed to create a stderr buffer");
+      exit(1);
+    }
+  }
+  r.sources.push_back(source);
+  _sources.emplace(source, id);
+  native::epoll_event event{.events = EPOLLIN, .data = {.fd = source}};
+  native::epoll_ctl(_epoll, EPOLL_CTL_ADD, source, &event);
+}
+
+void stderr_capture::keep(game_id id, std::string label) {
+  std::lock_guard lock{_mutex};
+  if (auto it = _rings.find(id); it != _rings.end()) {
+    it->second.keep = true;
+    it->second.label = std::move(label);
+  }
+}
+
+bool stderr_capture::_drain(ring &r, int source) {
+  for (;;) {
+    const size_t offset = r.written % _capacity;
+    loff_t file_offset = (loff_t)offset;
+    auto n = native::splice(source, nullptr, r.file, &file_offset,
+                            _capacity - offset,
+                            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n == -1 && errno == EINVAL) {
+      // Kernels that can't splice into the memfd: through user space then
+      char buffer[4096];
+      n = native::read(source, buffer,
+                       std::min(sizeof(buffer), _capacity - offset));
+      if (n > 0) {
+        native::pwrite(r.file, buffer, n, (off_t)offset);
+      }
+    }
+    if (n > 0) {
+      r.written += n;
+      continue;
+    }
+    if (n == -1 && errno == EINTR) {
+      continue;
+    }
+    return n == -1 && errno == EAGAIN;
+  }
+}
+
+void stderr_capture::_close_source(int source) {
+  native::epoll_ctl(_epoll, EPOLL_CTL_DEL, source, nullptr);
+  native::close(source);
+  _sources.erase(source);
+}
+
+std::string stderr_capture::_read(const ring &r) const {
+  const size_t size = std::min(r.written, _capacity);
+  std::string text(size, '\0');
+  // The oldest byte is right after the last one written once the ring wrapped
+  const size_t start = r.written > _capacity ? r.written % _capacity : 0;
+  const size_t first = size - start;
+  native::pread(r.file, text.data(), first, (off_t)start);
+  native::pread(r.file, text.data() + first, start, 0);
+  return text;
+}
+
+void stderr_capture::release(game_id id) {
+  std::lock_guard lock{_mutex};
+  auto it = _rings.find(id);
+  if (it == _rings.end()) {
+    return;
+  }
+  auto &r = it->second;
+  for (int source : r.sources) {
+    if (_sources.contains(source)) {
+      _drain(r, source);
+      _close_source(source);
+    }
+  }
+
+  if (r.keep) {
+    if (_kept.size() < max_kept) {
+      stderr_tail t{.label = std::move(r.label), .text = _read(r)};
+      t.dropped = r.written - t.text.size();
+      // Starting mid-line would be confusing
+      if (t.dropped > 0) {
+        auto newline = t.text.find('\n');
+        if (newline != std::string::npos) {
+          t.dropped += newline + 1;
+          t.text.erase(0, newline + 1);
+        }
+      }
+      _kept.push_back(std::move(t));
+    } else {
+      _overflow++;
+    }
+  }
+  native::close(r.file);
+  _rings.erase(it);
+}
+
+std::vector<stderr_tail> stderr_capture::take_kept(size_t &overflow) {
+  std::lock_guard lock{_mutex};
+  overflow = std::exchange(_overflow, 0);
+  return std::exchange(_kept, {});
+}
+
+void stderr_capture::_work() {
+  native::epoll_event events[64];
+  while (!_stopping) {
+    int n = native::epoll_wait(_epoll, events, std::size(events), -1);
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("epoll_wait failed");
+      exit(1);
+    }
+
+    std::lock_guard lock{_mutex};
+    for (int i = 0; i < n; ++i) {
+      const int source = events[i].data.fd;
+      if (source == (int)_wakeup) {
+        eventfd_t count;
+        native::eventfd_read(source, &count);
+        continue;
+      }
+      // Released in the meantime
+      auto game = _sources.find(source);
+      if (game == _sources.end()) {
+        continue;
+      }
+      if (!_drain(_rings[game->second], source)) {
+        _close_source(source);
+      }
+    }
+  }
+}
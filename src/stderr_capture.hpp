@@ -0,0 +1,88 @@
+#ifndef HEADER_GUARD_DPSG_STDERR_CAPTURE_HPP
+#define HEADER_GUARD_DPSG_STDERR_CAPTURE_HPP
+
+#include "engine.hpp"
+#include "posix.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// End of the standard error of a game
+struct stderr_tail {
+  std::string label;
+  std::string text;
+  // Bytes written before the kept part
+  size_t dropped = 0;
+};
+
+// Standard error of the processes of the games, drained by a thread of its own
+// so that a chatty child never blocks on a full pipe, and so that nothing
+// reaches the terminal.
+//
+// Each game gets a ring buffer of `capacity` bytes in a memfd, which the pipes
+// are spliced into without going through user space: only the end of the
+// output is kept. The rings of the games marked with `keep` are read back
+// once the game is over, for the summary.
+class stderr_capture {
+public:
+  // Failed games whose output is kept for the summary
+  constexpr static inline size_t max_kept = 5;
+
+  explicit stderr_capture(size_t capacity);
+  stderr_capture(const stderr_capture &) = delete;
+  stderr_capture &operator=(const stderr_capture &) = delete;
+  ~stderr_capture();
+
+  // Takes ownership of the read end of a stderr pipe of game `id`. Thread
+  // safe, games may have several processes.
+  void add(game_id id, dpsg::posix::fd_t pipe);
+
+  // Keeps the output of game `id` when it's released, under `label`
+  void keep(game_id id, std::string label);
+
+  // Drains what's left in the pipes of the game, then forgets it
+  void release(game_id id);
+
+  // Output of the kept games released so far, which are forgotten.
+  // `overflow` receives the number of games beyond `max_kept`.
+  std::vector<stderr_tail> take_kept(size_t &overflow);
+
+  size_t capacity() const { return _capacity; }
+
+private:
+  struct ring {
+    int file = -1;
+    size_t written = 0;
+    std::vector<int> sources;
+    bool keep = false;
+    std::string label;
+  };
+
+  // Moves what's readable from `source` to the ring. False at the end of the
+  // output.
+  bool _drain(ring &r, int source);
+  std::string _read(const ring &r) const;
+  void _close_source(int source);
+  void _work();
+
+  size_t _capacity;
+  int _epoll;
+  dpsg::posix::fd_t _wakeup;
+  std::atomic<bool> _stopping = false;
+
+  std::mutex _mutex;
+  std::unordered_map<game_id, ring> _rings;
+  // Game of each pipe
+  std::unordered_map<int, game_id> _sources;
+  std::vector<stderr_tail> _kept;
+  size_t _overflow = 0;
+
+  std::thread _thread;
+};
+
+#endif // HEADER_GUARD_DPSG_STDERR_CAPTURE_HPP
@@ -0,0 +1,106 @@
+#include "symbols.hpp"
+#include "posix.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cxxabi.h>
+#include <elf.h>
+#include <memory>
+
+namespace {
+std::string demangle(const std::string &name) {
+  int status = 0;
+  std::unique_ptr<char, decltype(&std::free)> demangled{
+      abi::__cxa_demangle(name.c_str(), nullptr, nullptr, &status),
+      &std::free};
+  return status == 0 && demangled ? demangled.get() : name;
+}
+
+// Pointer to a `T` at `offset` in `data`, null when it doesn't fit
+template <class T> const T *at(std::string_view data, uint64_t offset) {
+  if (offset > data.size() || data.size() - offset < sizeof(T)) {
+    return nullptr;
+  }
+  return reinterpret_cast<const T *>(data.data() + offset);
+}
+} // namespace
+
+elf_symbols::elf_symbols(const std::filesystem::path &path) {
+  dpsg::posix::mapped_file file{path.c_str()};
+  const auto data = file.view();
+  const auto *header = at<Elf64_Ehdr>(data, 0);
+  if (header == nullptr || std::memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+      header->e_ident[EI_CLASS] != ELFCLASS64) {
+    return;
+  }
+
+  for (int i = 0; i < header->e_phnum; ++i) {
+    const auto *p = at<Elf64_Phdr>(
+        data, header->e_phoff + (uint64_t)i * header->e_phentsize);
+    if (p != nullptr && p->p_type == PT_LOAD) {
+      _segments.push_back({p->p_offset, p->p_filesz, p->p_vaddr});
+    }
+  }
+
+  // .symtab is a superset of .dynsym, which is only read without it
+  const Elf64_Shdr *tables[2] = {nullptr, nullptr};
+  for (int i = 0; i < header->e_shnum; ++i) {
+    const auto *s = at<Elf64_Shdr>(
+        data, header->e_shoff + (uint64_t)i * header->e_shentsize);
+    if (s != nullptr && s->sh_type == SHT_SYMTAB) {
+      tables[0] = s;
+    } else if (s != nullptr && s->sh_type == SHT_DYNSYM) {
+      tables[1] = s;
+    }
+  }
+  const auto *table = tables[0] != nullptr ? tables[0] : tables[1];
+  if (table == nullptr || table->sh_entsize == 0) {
+    return;
+  }
+  const auto *strings = at<Elf64_Shdr>(
+      data, header->e_shoff + (uint64_t)table->sh_link * header->e_shentsize);
+  if (strings == nullptr || strings->sh_offset > data.size()) {
+    return;
+  }
+  const auto names = data.substr(
+      strings->sh_offset,
+      std::min<uint64_t>(strings->sh_size, data.size() - strings->sh_offset));
+
+  for (uint64_t i = 0; i < table->sh_size / table->sh_entsize; ++i) {
+    const auto *symbol =
+        at<Elf64_Sym>(data, table->sh_offset + i * table->sh_entsize);
+    if (symbol == nullptr || ELF64_ST_TYPE(symbol->st_info) != STT_FUNC ||
+        symbol->st_value == 0 || symbol->st_name >= names.size()) {
+      continue;
+    }
+    auto name = names.substr(symbol->st_name);
+    name = name.substr(0, name.find('\0'));
+    _functions.push_back(
+        {symbol->st_value, symbol->st_size, demangle(std::string{name})});
+  }
+  std::sort(_functions.begin(), _functions.end(),
+            [](auto &a, auto &b) { return a.address < b.address; });
+}
+
+std::string_view elf_symbols::function_at(uint64_t file_offset) const {
+  auto segment = std::find_if(_segments.begin(), _segments.end(), [&](auto &s) {
+    return file_offset >= s.offset && file_offset < s.offset + s.size;
+  });
+  if (segment == _segments.end()) {
+    return {};
+  }
+  const uint64_t address = file_offset - segment->offset + segment->address;
+  auto it = std::upper_bound(
+      _functions.begin(), _functions.end(), address,
+      [](uint64_t a, const function &f) { return a < f.address; });
+  if (it == _functions.begin()) {
+    return {};
+  }
+  --it;
+  // Symbols without a size (hand-written assembly) take everything up to the
+  // next one
+  if (it->size != 0 && address >= it->address + it->size) {
+    return {};
+  }
+  return it->name;
+}
@@ -0,0 +1,43 @@
+#ifndef HEADER_GUARD_DPSG_SYMBOLS_HPP
+#define HEADER_GUARD_DPSG_SYMBOLS_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Function symbols of an ELF file (executable or shared object), from its
+// .symtab or, when stripped, its .dynsym. C++ names are demangled.
+class elf_symbols {
+public:
+  // Empty when the file can't be read or isn't a 64 bits ELF file
+  explicit elf_symbols(const std::filesystem::path &path);
+
+  // Name of the function holding the byte at `file_offset` in the file, as
+  // mapped in memory (the offset of the mapping plus the distance to its
+  // start). Empty when unknown.
+  std::string_view function_at(uint64_t file_offset) const;
+
+  bool empty() const { return _functions.empty(); }
+
+private:
+  struct function {
+    uint64_t address;
+    uint64_t size;
+    std::string name;
+  };
+
+  // Loaded segments, to go from file offsets to addresses
+  struct segment {
+    uint64_t offset;
+    uint64_t size;
+    uint64_t address;
+  };
+
+  std::vector<segment> _segments;
+  // Sorted by address
+  std::vector<function> _functions;
+};
+
+#endif // HEADER_GUARD_DPSG_SYMBOLS_HPP
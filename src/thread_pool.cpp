@@ -0,0 +1,57 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+thread_pool::thread_pool(unsigned thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  _workers.reserve(thread_count);
+  for (unsigned i = 0; i < thread_count; ++i) {
+    _workers.emplace_back([this] { _work(); });
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard lock{_mutex};
+    _stopping = true;
+  }
+  _task_available.notify_all();
+  for (auto &w : _workers) {
+    w.join();
+  }
+}
+
+void thread_pool::submit(std::function<void()> task) {
+  {
+    std::lock_guard lock{_mutex};
+    _tasks.push_back(std::move(task));
+  }
+  _task_available.notify_one();
+}
+
+void thread_pool::wait() {
+  std::unique_lock lock{_mutex};
+  _all_done.wait(lock, [this] { return _tasks.empty() && _running == 0; });
+}
+
+void thread_pool::_work() {
+  std::unique_lock lock{_mutex};
+  while (true) {
+    _task_available.wait(lock, [this] { return _stopping || !_tasks.empty(); });
+    if (_tasks.empty()) {
+      return;
+    }
+    auto task = std::move(_tasks.front());
+    _tasks.pop_front();
+    _running++;
+    lock.unlock();
+    task();
+    lock.lock();
+    _running--;
+    if (_tasks.empty() && _running == 0) {
+      _all_done.notify_all();
+    }
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef HEADER_GUARD_DPSG_THREAD_POOL_HPP
+#define HEADER_GUARD_DPSG_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing tasks in submission order.
+class thread_pool {
+public:
+  // 0 threads means one per core
+  explicit thread_pool(unsigned thread_count = 0);
+  thread_pool(const thread_pool &) = delete;
+  thread_pool &operator=(const thread_pool &) = delete;
+  ~thread_pool();
+
+  void submit(std::function<void()> task);
+
+  // Blocks until every task submitted so far has been executed.
+  void wait();
+
+  size_t size() const { return _workers.size(); }
+
+private:
+  void _work();
+
+  std::mutex _mutex;
+  std::condition_variable _task_available;
+  std::condition_variable _all_done;
+  std::deque<std::function<void()>> _tasks;
+  size_t _running = 0;
+  bool _stopping = false;
+  std::vector<std::thread> _workers;
+};
+
+#endif // HEADER_GUARD_DPSG_THREAD_POOL_HPP
@@ -0,0 +1,80 @@
+#include "throughput.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double ewma_weight = 0.1;
+
+double seconds(std::chrono::nanoseconds d) {
+  return std::chrono::duration<double>(d).count();
+}
+} // namespace
+
+void throughput_statistics::add(clock_time now,
+                                std::chrono::nanoseconds duration) {
+  const double ms = std::chrono::duration<double, std::milli>(duration).count();
+  int bucket = ms < 1 ? 0 : (int)(2 * std::log2(ms));
+  buckets[std::min(bucket, bucket_count - 1)]++;
+
+  duration_total_ms += ms;
+  duration_ewma_ms = count == 0 ? ms
+                                : duration_ewma_ms +
+                                      ewma_weight * (ms - duration_ewma_ms);
+
+  // Averaging the intervals rather than their inverse, so that games
+  // completing at once don't make the rate explode
+  const double interval = seconds(now - (count == 0 ? started : last_completion));
+  interval_ewma = count == 0 ? interval
+                             : interval_ewma +
+                                   ewma_weight * (interval - interval_ewma);
+
+  completions[count % window] = now;
+  last_completion = now;
+  count++;
+}
+
+double throughput_statistics::rate() const {
+  if (count < 2) {
+    return count == 0 ? 0 : 1 / std::max(seconds(last_completion - started), 1e-9);
+  }
+  const size_t n = std::min<size_t>(count, window);
+  const auto oldest = completions[(count - n) % window];
+  const double elapsed = seconds(last_completion - oldest);
+  return elapsed <= 0 ? 0 : (double)(n - 1) / elapsed;
+}
+
+double throughput_statistics::bucket_upper_ms(int bucket) {
+  return std::exp2((bucket + 1) / 2.0);
+}
+
+double throughput_statistics::duration_quantile_ms(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  const auto target = (uint64_t)std::ceil(q * (double)count);
+  uint64_t seen = 0;
+  for (int b = 0; b < bucket_count; ++b) {
+    seen += buckets[b];
+    if (seen >= target) {
+      return bucket_upper_ms(b);
+    }
+  }
+  return bucket_upper_ms(bucket_count - 1);
+}
+
+double throughput_statistics::eta_seconds(size_t remaining,
+                                          int slot_count) const {
+  if (remaining == 0 || count == 0 || slot_count <= 0) {
+    return 0;
+  }
+  const double waves =
+      (double)(remaining > (size_t)slot_count ? remaining - slot_count : 0) /
+      slot_count;
+  return (waves * mean_duration_ms() + duration_quantile_ms(0.9)) / 1000;
+}
+
+double throughput_statistics::occupancy(clock_time now, int slot_count) const {
+  const double elapsed = seconds(now - started) * slot_count;
+  return elapsed <= 0 ? 0 : std::min(1.0, duration_total_ms / 1000 / elapsed);
+}
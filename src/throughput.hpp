@@ -0,0 +1,61 @@
+#ifndef HEADER_GUARD_DPSG_THROUGHPUT_HPP
+#define HEADER_GUARD_DPSG_THROUGHPUT_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Speed of a run: completion rate, game durations and slot occupancy. Fixed
+// size and allocation-free, so that updating it costs the same at the first
+// game and at the millionth.
+struct throughput_statistics {
+  using clock_time = std::chrono::nanoseconds;
+
+  // Half-octave buckets of game wall time, from 1ms to ~65s
+  constexpr static inline int bucket_count = 32;
+  // Completions used for the instantaneous rate
+  constexpr static inline int window = 16;
+
+  explicit throughput_statistics(clock_time start) : started(start) {}
+
+  // To be called when a game completes, `now` being on the same clock as the
+  // start of the run (see `dpsg::posix::monotonic_now`).
+  void add(clock_time now, std::chrono::nanoseconds duration);
+
+  // Games per second over the last `window` completions
+  double rate() const;
+  // Exponentially weighted games per second (each completion weighs 1/10)
+  double average_rate() const {
+    return interval_ewma <= 0 ? 0 : 1 / interval_ewma;
+  }
+
+  double mean_duration_ms() const {
+    return count == 0 ? 0 : duration_total_ms / (double)count;
+  }
+  // Upper bound of the bucket containing the `q` quantile of durations
+  double duration_quantile_ms(double q) const;
+
+  // Seconds until `remaining` games complete on `slot_count` slots: full waves
+  // at the mean duration, the last one ending with its slowest game (p90).
+  double eta_seconds(size_t remaining, int slot_count) const;
+
+  // Fraction of the slot time since the start spent playing games
+  double occupancy(clock_time now, int slot_count) const;
+
+  static double bucket_upper_ms(int bucket);
+
+  clock_time started;
+  clock_time last_completion{};
+  size_t count = 0;
+  double duration_total_ms = 0;
+  // Exponentially weighted duration, to notice games getting slower
+  double duration_ewma_ms = 0;
+  // Exponentially weighted time between completions, in seconds
+  double interval_ewma = 0;
+  std::array<uint32_t, bucket_count> buckets{};
+  // Ring of the last completion times
+  std::array<clock_time, window> completions{};
+};
+
+#endif // HEADER_GUARD_DPSG_THROUGHPUT_HPP
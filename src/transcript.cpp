@@ -0,0 +1,90 @@
+#include "transcript.hpp"
+#include "hash.hpp"
+#include "varint.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace dpsg::posix;
+using dpsg::get_varint;
+using dpsg::put_varint;
+
+namespace {
+void write_all(fd_t file, std::string_view data) {
+  while (!data.empty()) {
+    auto w = write(file, data.data(), data.size());
+    if (w.is_error()) {
+      return;
+    }
+    data.remove_prefix(w.value());
+  }
+}
+} // namespace
+
+std::optional<transcript> read_transcript(const std::filesystem::path &path) {
+  mapped_file file{path.c_str()};
+  std::string_view data = file.view();
+  if (!data.starts_with(transcript_magic)) {
+    return std::nullopt;
+  }
+  data.remove_prefix(transcript_magic.size());
+
+  transcript t;
+  while (!data.empty()) {
+    auto size = get_varint(data);
+    auto lines = get_varint(data);
+    if (!size || !lines || *size > data.size()) {
+      return std::nullopt;
+    }
+    t.turns.push_back({.input = std::string{data.substr(0, *size)},
+                       .reply_lines = (uint32_t)*lines});
+    data.remove_prefix(*size);
+  }
+  return t;
+}
+
+std::string transcript_name(std::string_view seed, uint32_t id, int player,
+                            std::string_view command) {
+  char hash[9];
+  std::snprintf(hash, sizeof(hash), "%08x",
+                (uint32_t)(dpsg::fnv1a(command) >> 32));
+  return (seed.empty() ? "game" : std::string{seed}) + '-' + hash + '-' +
+         std::to_string(id) + '-' + std::to_string(player + 1) + ".cgt";
+}
+
+transcript_writer::transcript_writer(fd_t file) : _file(file) {
+  write_all(_file, transcript_magic);
+}
+
+transcript_writer::~transcript_writer() {
+  finish();
+  native::close((int)_file);
+}
+
+void transcript_writer::input(std::string_view data) {
+  if (_replied) {
+    _write_turn();
+  }
+  _input.append(data);
+}
+
+void transcript_writer::reply(std::string_view data) {
+  _replied = true;
+  _reply_lines += (uint32_t)std::count(data.begin(), data.end(), '\n');
+}
+
+void transcript_writer::finish() { _write_turn(); }
+
+void transcript_writer::_write_turn() {
+  // Replies before any input have no turn to belong to
+  if (!_input.empty()) {
+    std::string record;
+    put_varint(record, _input.size());
+    put_varint(record, _reply_lines);
+    record.append(_input);
+    write_all(_file, record);
+  }
+  _input.clear();
+  _reply_lines = 0;
+  _replied = false;
+}
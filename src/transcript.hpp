@@ -0,0 +1,67 @@
+#ifndef HEADER_GUARD_DPSG_TRANSCRIPT_HPP
+#define HEADER_GUARD_DPSG_TRANSCRIPT_HPP
+
+#include "posix.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Input a player received from the referee during a game, turn by turn, as
+// recorded by the proxy with --record (see proxy.hpp) and played back by
+// `runner replay`.
+//
+// File format: the magic "CGT1", then for each turn the size of its input and
+// the number of lines the player replied with, both as LEB128 varints, then
+// the input itself.
+struct transcript {
+  struct turn {
+    std::string input;
+    // Lines of the reply, after which the next input was sent
+    uint32_t reply_lines = 0;
+  };
+  std::vector<turn> turns;
+};
+
+constexpr std::string_view transcript_magic = "CGT1";
+
+// Reads a whole transcript, nothing when the file can't be read or isn't one
+std::optional<transcript> read_transcript(const std::filesystem::path &path);
+
+// Name of the transcript of `player` (0 or 1) in game `id`, playing `command`:
+// `<seed>-<command hash>-<id>-<player>.cgt`, `game` standing for the seed when
+// it is left to the referee. Games sharing a seed (seeds cycled, or several
+// players as with bisect, race and ab) get transcripts of their own.
+std::string transcript_name(std::string_view seed, uint32_t id, int player,
+                            std::string_view command);
+
+// Writes a transcript as the game goes. A turn starts with the first input
+// following a reply, and is written once the next one starts or on `finish`:
+// the proxy may be killed at any time, so that at most the last turn is lost.
+class transcript_writer {
+public:
+  explicit transcript_writer(dpsg::posix::fd_t file);
+  transcript_writer(const transcript_writer &) = delete;
+  transcript_writer &operator=(const transcript_writer &) = delete;
+  ~transcript_writer();
+
+  // Bytes sent by the referee to the player
+  void input(std::string_view data);
+  // Bytes sent by the player to the referee
+  void reply(std::string_view data);
+  // Writes the turn in progress
+  void finish();
+
+private:
+  void _write_turn();
+
+  dpsg::posix::fd_t _file;
+  std::string _input;
+  uint32_t _reply_lines = 0;
+  bool _replied = false;
+};
+
+#endif // HEADER_GUARD_DPSG_TRANSCRIPT_HPP
@@ -0,0 +1,328 @@
+#include "tuning.hpp"
+#include "engine.hpp"
+#include "engine_choice.hpp"
+#include "runner.hpp"
+#include "vt100.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <sstream>
+
+std::string parameter_spec::format(double value) const {
+  double rounded = min + std::round((value - min) / step) * step;
+  rounded = std::clamp(rounded, min, max);
+  std::ostringstream out;
+  out.precision(10);
+  out << rounded;
+  return out.str();
+}
+
+std::vector<parameter_spec>
+read_parameter_spec(const std::filesystem::path &path) {
+  std::ifstream in{path};
+  if (!in) {
+    std::cerr << "Cannot open parameter spec " << path << std::endl;
+    exit(1);
+  }
+
+  std::vector<parameter_spec> specs;
+  std::string line;
+  for (int line_nb = 1; std::getline(in, line); ++line_nb) {
+    if (auto comment = line.find('#'); comment != std::string::npos) {
+      line.resize(comment);
+    }
+    std::istringstream fields{line};
+    parameter_spec spec;
+    if (!(fields >> spec.name)) {
+      continue;
+    }
+    if (!(fields >> spec.min >> spec.max >> spec.step) ||
+        spec.min >= spec.max || spec.step <= 0) {
+      std::cerr << path.string() << ':' << line_nb
+                << ": expected '<name> <min> <max> <step> [initial]' with "
+                   "min < max and step > 0"
+                << std::endl;
+      exit(1);
+    }
+    if (!(fields >> spec.initial)) {
+      spec.initial = (spec.min + spec.max) / 2;
+    }
+    specs.push_back(std::move(spec));
+  }
+
+  if (specs.empty()) {
+    std::cerr << "No parameter to tune in " << path << std::endl;
+    exit(1);
+  }
+  return specs;
+}
+
+std::string instantiate(std::string_view command_template,
+                        const std::vector<parameter_spec> &specs,
+                        const std::vector<double> &values) {
+  std::string command{command_template};
+  std::string environment;
+  for (size_t i = 0; i < specs.size(); ++i) {
+    const auto placeholder = '{' + specs[i].name + '}';
+    const auto value = specs[i].format(values[i]);
+    bool found = false;
+    for (auto pos = command.find(placeholder); pos != std::string::npos;
+         pos = command.find(placeholder, pos + value.size())) {
+      command.replace(pos, placeholder.size(), value);
+      found = true;
+    }
+    if (!found) {
+      environment += specs[i].name + '=' + value + ' ';
+    }
+  }
+  return environment.empty() ? command : "env " + environment + command;
+}
+
+spsa_tuner::spsa_tuner(std::vector<parameter_spec> specs, int iterations,
+                       uint64_t random_seed)
+    : _specs(std::move(specs)), _iterations(iterations),
+      _stability(0.1 * iterations), _rng(random_seed) {
+  _theta.reserve(_specs.size());
+  for (auto &s : _specs) {
+    _theta.push_back((s.initial - s.min) / s.range());
+  }
+  // Sized for steps of about half the initial perturbation on a typical
+  // gradient estimate
+  _a = 0.05 * std::pow(_stability + 1, alpha);
+}
+
+spsa_tuner::perturbation spsa_tuner::next() {
+  perturbation p;
+  p.iteration = _started++;
+  const double ck = c / std::pow(p.iteration + 1, gamma);
+  std::bernoulli_distribution coin;
+
+  for (size_t i = 0; i < _theta.size(); ++i) {
+    // Perturbing by less than a step would evaluate the same values twice
+    const double c_i = std::max(ck, _specs[i].step / _specs[i].range());
+    const int d = coin(_rng) ? 1 : -1;
+    p.delta.push_back(d);
+    p.c.push_back(c_i);
+    p.plus.push_back(std::clamp(_theta[i] + c_i * d, 0.0, 1.0));
+    p.minus.push_back(std::clamp(_theta[i] - c_i * d, 0.0, 1.0));
+  }
+  return p;
+}
+
+void spsa_tuner::update(const perturbation &p, double difference) {
+  const double ak = _a / std::pow(p.iteration + 1 + _stability, alpha);
+  for (size_t i = 0; i < _theta.size(); ++i) {
+    const double gradient = difference / (2 * p.c[i] * p.delta[i]);
+    _theta[i] = std::clamp(_theta[i] + ak * gradient, 0.0, 1.0);
+  }
+  _updates++;
+}
+
+std::vector<double> spsa_tuner::values() const { return values(_theta); }
+
+std::vector<double>
+spsa_tuner::values(const std::vector<double> &normalized) const {
+  std::vector<double> r;
+  r.reserve(normalized.size());
+  for (size_t i = 0; i < normalized.size(); ++i) {
+    r.push_back(_specs[i].min + normalized[i] * _specs[i].range());
+  }
+  return r;
+}
+
+void spsa_tuner::save(const std::filesystem::path &path, size_t games) const {
+  auto tmp = path;
+  tmp += ".tmp";
+  {
+    std::ofstream out{tmp};
+    out.precision(17);
+    out << "# cg-runner tuning checkpoint\n"
+        << "iteration " << _updates << '\n'
+        << "games " << games << '\n';
+    auto v = values();
+    for (size_t i = 0; i < _specs.size(); ++i) {
+      out << "param " << _specs[i].name << ' ' << v[i] << '\n';
+    }
+  }
+  // Never leave a truncated checkpoint behind
+  std::filesystem::rename(tmp, path);
+}
+
+bool spsa_tuner::load(const std::filesystem::path &path) {
+  std::ifstream in{path};
+  if (!in) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields{line};
+    std::string key;
+    fields >> key;
+    if (key == "iteration") {
+      fields >> _updates;
+      _started = _updates;
+    } else if (key == "param") {
+      std::string name;
+      double value;
+      fields >> name >> value;
+      for (size_t i = 0; i < _specs.size(); ++i) {
+        if (_specs[i].name == name) {
+          _theta[i] = std::clamp((value - _specs[i].min) / _specs[i].range(),
+                                 0.0, 1.0);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+namespace {
+
+// Games played for one perturbation, with the points won by each side
+struct evaluation {
+  spsa_tuner::perturbation perturbation;
+  int remaining;
+  double points[2] = {0, 0};
+  int games[2] = {0, 0};
+};
+
+void print_values(std::ostream &out, const spsa_tuner &tuner) {
+  auto v = tuner.values();
+  for (size_t i = 0; i < v.size(); ++i) {
+    out << ' ' << tuner.specs()[i].name << '='
+        << dpsg::vt100::yellow << tuner.specs()[i].format(v[i])
+        << dpsg::vt100::reset;
+  }
+}
+
+} // namespace
+
+int run_tuning(int argc, const char **argv) {
+  using namespace dpsg;
+  auto opts = parse_options(argc, argv);
+  if (opts.arguments.size() != 1) {
+    std::cerr << "Usage: runner tune <parameter spec> -1 <player template> "
+                 "[-2 <baseline>] -r <referee> [options]"
+              << std::endl;
+    return 1;
+  }
+  auto specs = read_parameter_spec(opts.arguments[0]);
+  if (opts.p1.empty() || opts.referee.empty()) {
+    std::cerr << "You must specify a command template for player 1 and the "
+                 "referee!"
+              << std::endl;
+    return 1;
+  }
+  if (opts.parallel_processes <= 0 || opts.tuning_pairs <= 0) {
+    std::cerr << "-p and --pairs must be > 0" << std::endl;
+    return 1;
+  }
+  if (!check_engine_options(opts)) {
+    return 1;
+  }
+
+  // Without a baseline, both perturbations play each other. Otherwise each of
+  // them plays the baseline on both sides.
+  const bool head_to_head = opts.p2.empty();
+  const int games_per_iteration = opts.tuning_pairs * (head_to_head ? 2 : 4);
+  const int iterations = std::max(1, opts.process_count / games_per_iteration);
+
+  std::random_device entropy;
+  spsa_tuner tuner{specs, iterations, ((uint64_t)entropy() << 32) | entropy()};
+  if (tuner.load(opts.checkpoint)) {
+    std::cout << "Resuming from " << opts.checkpoint << " at iteration "
+              << tuner.updates() << ':';
+    print_values(std::cout, tuner);
+    std::cout << std::endl;
+  }
+  std::mt19937_64 seeds{((uint64_t)entropy() << 32) | entropy()};
+
+  size_t played = 0;
+  auto runner = make_runner(opts);
+  with_engine(opts, runner, [&](auto &games) {
+    games.on_exit([&runner](game_id id, const struct rusage &usage) {
+      runner.release(id, usage);
+    });
+
+    const auto on_update = [&](evaluation &e) {
+      const double difference =
+          head_to_head ? 2 * e.points[0] / e.games[0] - 1
+                       : e.points[0] / e.games[0] - e.points[1] / e.games[1];
+      tuner.update(e.perturbation, difference);
+      tuner.save(opts.checkpoint, played);
+
+      std::cout << vt100::cyan << "Iteration " << tuner.updates() << '/'
+                << tuner.iterations() << vt100::reset << " (" << played
+                << " games, difference " << difference << "):";
+      print_values(std::cout, tuner);
+      std::cout << std::endl;
+    };
+
+    const auto start_evaluation = [&] {
+      auto e = std::make_shared<evaluation>(
+          evaluation{tuner.next(), games_per_iteration});
+      const std::string candidates[2] = {
+          instantiate(opts.p1, specs, tuner.values(e->perturbation.plus)),
+          instantiate(opts.p1, specs, tuner.values(e->perturbation.minus)),
+      };
+
+      // `side`: which perturbation the game evaluates, `seat`: where it plays
+      const auto submit = [&](int side, int seat, const std::string &opponent,
+                              const std::string &seed) {
+        games.submit(
+            game_t{
+                .player1 = seat == 0 ? candidates[side] : opponent,
+                .player2 = seat == 0 ? opponent : candidates[side],
+                .referee = std::string{opts.referee},
+                .seed = seed,
+            },
+            [e, side, seat, &played,
+             &on_update](game_id, const game_t &, run_result &r) {
+              played++;
+              e->points[side] += r.points(seat);
+              e->games[side]++;
+              if (--e->remaining == 0) {
+                on_update(*e);
+              }
+            });
+      };
+
+      for (int pair = 0; pair < opts.tuning_pairs; ++pair) {
+        // Both games of a side-swapped pair are played on the same seed
+        const auto seed = std::to_string(seeds() & 0x7fffffff);
+        if (head_to_head) {
+          submit(0, 0, candidates[1], seed);
+          submit(0, 1, candidates[1], seed);
+        } else {
+          const std::string baseline{opts.p2};
+          for (int side = 0; side < 2; ++side) {
+            submit(side, 0, baseline, seed);
+            submit(side, 1, baseline, seed);
+          }
+        }
+      }
+    };
+
+    // Keep enough games queued that slots never wait for an iteration to end
+    const auto refill = [&] {
+      while ((int)games.pending() < games.slot_count() &&
+             tuner.started() < tuner.iterations()) {
+        start_evaluation();
+      }
+    };
+
+    refill();
+    while (!games.idle()) {
+      games.poll();
+      refill();
+    }
+  });
+
+  std::cout << vt100::green << "Tuned parameters" << vt100::reset << " ("
+            << played << " games):";
+  print_values(std::cout, tuner);
+  std::cout << std::endl;
+  return 0;
+}
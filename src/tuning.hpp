@@ -0,0 +1,91 @@
+#ifndef HEADER_GUARD_DPSG_TUNING_HPP
+#define HEADER_GUARD_DPSG_TUNING_HPP
+
+#include "options.hpp"
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// A parameter of player 1 to tune, as read from the spec file:
+//   <name> <min> <max> <step> [initial value]
+struct parameter_spec {
+  std::string name;
+  double min;
+  double max;
+  double step;
+  double initial;
+
+  double range() const { return max - min; }
+  // Value rounded to the step, formatted for the command line
+  std::string format(double value) const;
+};
+
+std::vector<parameter_spec>
+read_parameter_spec(const std::filesystem::path &path);
+
+// Builds the command of player 1 for the given values. `{name}` in the
+// template is replaced by the value of parameter `name`. Parameters that don't
+// appear in the template are passed through the environment instead, by
+// prefixing the command with `env name=value...`.
+std::string instantiate(std::string_view command_template,
+                        const std::vector<parameter_spec> &specs,
+                        const std::vector<double> &values);
+
+// Simultaneous perturbation stochastic approximation. Parameters are handled
+// in a normalized space where each of them ranges over [0, 1].
+//
+// Perturbations are handed out from the current estimate whenever asked for,
+// and the estimate is updated as soon as the result of one comes back, so
+// several of them are usually evaluated concurrently (asynchronous SPSA).
+class spsa_tuner {
+public:
+  struct perturbation {
+    int iteration = 0;
+    std::vector<int> delta;
+    std::vector<double> c;
+    std::vector<double> plus;
+    std::vector<double> minus;
+  };
+
+  spsa_tuner(std::vector<parameter_spec> specs, int iterations,
+             uint64_t random_seed);
+
+  perturbation next();
+  // `difference` is the estimated y(plus) - y(minus), the objective being
+  // maximized
+  void update(const perturbation &p, double difference);
+
+  // Current estimate, in the parameters' units
+  std::vector<double> values() const;
+  std::vector<double> values(const std::vector<double> &normalized) const;
+  const std::vector<parameter_spec> &specs() const { return _specs; }
+  int iterations() const { return _iterations; }
+  int started() const { return _started; }
+  int updates() const { return _updates; }
+
+  void save(const std::filesystem::path &path, size_t games) const;
+  // Resumes from a checkpoint if there is one
+  bool load(const std::filesystem::path &path);
+
+private:
+  constexpr static double alpha = 0.602;
+  constexpr static double gamma = 0.101;
+  constexpr static double c = 0.1;
+
+  std::vector<parameter_spec> _specs;
+  std::vector<double> _theta;
+  int _iterations;
+  int _started = 0;
+  int _updates = 0;
+  double _stability;
+  double _a;
+  std::mt19937_64 _rng;
+};
+
+// Entry point of `runner tune <spec file> <options...>`, argv[0] being
+// "tune".
+int run_tuning(int argc, const char **argv);
+
+#endif // HEADER_GUARD_DPSG_TUNING_HPP
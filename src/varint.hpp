@@ -0,0 +1,34 @@
+#ifndef HEADER_GUARD_DPSG_VARINT_HPP
+#define HEADER_GUARD_DPSG_VARINT_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace dpsg {
+// LEB128 unsigned integers, 7 bits per byte, low bits first
+inline void put_varint(std::string &out, uint64_t x) {
+  while (x >= 0x80) {
+    out.push_back((char)((x & 0x7f) | 0x80));
+    x >>= 7;
+  }
+  out.push_back((char)x);
+}
+
+// Consumes a varint from the front of `in`, nothing when it is truncated
+inline std::optional<uint64_t> get_varint(std::string_view &in) {
+  uint64_t x = 0;
+  for (int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+    auto byte = (unsigned char)in.front();
+    in.remove_prefix(1);
+    x |= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return x;
+    }
+  }
+  return std::nullopt;
+}
+} // namespace dpsg
+
+#endif // HEADER_GUARD_DPSG_VARINT_HPP
@@ -0,0 +1,100 @@
+#include "watch.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace fs = std::filesystem;
+using namespace dpsg::posix;
+
+fs::path command_executable(std::string_view command) {
+  const auto start = command.find_first_not_of(" \t");
+  if (start == std::string_view::npos) {
+    return {};
+  }
+  command = command.substr(start);
+  fs::path executable{command.substr(0, command.find_first_of(" \t"))};
+  std::error_code ec;
+  if (executable.native().find('/') != std::string::npos) {
+    return fs::exists(executable, ec) ? fs::absolute(executable) : fs::path{};
+  }
+
+  std::string_view path = std::getenv("PATH") ? std::getenv("PATH") : "";
+  while (!path.empty()) {
+    auto colon = path.find(':');
+    fs::path candidate = fs::path{path.substr(0, colon)} / executable;
+    if (fs::exists(candidate, ec)) {
+      return fs::absolute(candidate);
+    }
+    path = colon == std::string_view::npos ? "" : path.substr(colon + 1);
+  }
+  return {};
+}
+
+file_watcher::file_watcher(const std::vector<fs::path> &files) {
+  int fd = native::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd == -1) {
+    perror("Failed to initialize inotify");
+    exit(1);
+  }
+  _fd = (fd_t)fd;
+
+  for (auto &file : files) {
+    auto directory = file.parent_path();
+    int wd = native::inotify_add_watch(
+        fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd == -1) {
+      std::cerr << "Cannot watch " << directory << ": " << strerror(errno)
+                << std::endl;
+      exit(1);
+    }
+    _names[wd].insert(file.filename());
+  }
+}
+
+file_watcher::~file_watcher() { native::close((int)_fd); }
+
+bool file_watcher::changed() {
+  alignas(native::inotify_event) char buffer[4096];
+  bool found = false;
+  for (;;) {
+    auto n = native::read((int)_fd, buffer, sizeof(buffer));
+    if (n <= 0) {
+      return found;
+    }
+    for (char *p = buffer; p < buffer + n;) {
+      auto *event = reinterpret_cast<native::inotify_event *>(p);
+      if (event->len > 0) {
+        auto it = _names.find(event->wd);
+        found |= it != _names.end() && it->second.contains(event->name);
+      }
+      p += sizeof(native::inotify_event) + event->len;
+    }
+  }
+}
+
+void file_watcher::wait() {
+  while (!changed()) {
+    dpsg::posix::pollfd ready{_fd, poll_event_t::read_ready};
+    auto r = ::dpsg::posix::poll(std::span{&ready, 1});
+    if (r.is_error() && r.error() != poll_error::interrupted &&
+        r.error() != poll_error::again) {
+      perror("Poll failed");
+      exit(1);
+    }
+  }
+}
+
+void file_watcher::settle(std::chrono::milliseconds quiet) {
+  for (;;) {
+    dpsg::posix::pollfd ready{_fd, poll_event_t::read_ready};
+    auto r = ::dpsg::posix::poll(std::span{&ready, 1}, quiet);
+    if (r.is_value() && ready.revents == 0) {
+      return;
+    }
+    // Events on other files of the directories don't count
+    if (!changed() && r.is_value()) {
+      return;
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef HEADER_GUARD_DPSG_WATCH_HPP
+#define HEADER_GUARD_DPSG_WATCH_HPP
+
+#include "posix.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Executable run by a player command: its first word, looked up in PATH when
+// it has no slash. Empty when it can't be found.
+std::filesystem::path command_executable(std::string_view command);
+
+// Changes to a set of files, through inotify. Their directories are watched
+// rather than the files themselves, since build tools often replace a file by
+// renaming a new one over it.
+class file_watcher {
+public:
+  explicit file_watcher(const std::vector<std::filesystem::path> &files);
+  file_watcher(const file_watcher &) = delete;
+  file_watcher &operator=(const file_watcher &) = delete;
+  ~file_watcher();
+
+  // Whether one of the files changed since the last call, without blocking
+  bool changed();
+  // Blocks until one of the files changes
+  void wait();
+  // Blocks until the files stay untouched for `quiet`, so that a build is
+  // done writing them
+  void settle(std::chrono::milliseconds quiet);
+
+private:
+  dpsg::posix::fd_t _fd;
+  // Watched names, by watch descriptor of their directory
+  std::unordered_map<int, std::unordered_set<std::string>> _names;
+};
+
+#endif // HEADER_GUARD_DPSG_WATCH_HPP